@@ -1,35 +1,92 @@
 #include "../data-analyser/src/core/fpga_logger.h"
 #include "asic_sender.h"
+#include "../intan-reader/async_logger.h"
+#ifdef ASIC_SENDER_EMULATED
+#include "frontpanel_emulator.h"
+#endif
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/select.h>
 #include <cstring>
 #include <chrono>
 #include <iomanip>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
 
 // Static member definitions
 const size_t AsicSender::BUF_LEN = 16384; // Must be multiple of 16 for USB 3.0
+const int AsicSender::MAX_PIPELINE_DEPTH = 4;
+const int AsicSender::MAX_BATCH_FRAMES = 16;
 
-AsicSender::AsicSender() : device_(nullptr), running_(false), initialized_(false), data_analyzer_(nullptr) {
-    device_ = new OpalKellyLegacy::okCFrontPanel();
+namespace {
+constexpr size_t kTransferAlignment = 4096; // Page-aligned for the USB driver
+constexpr int kDefaultPipelineDepth = 2;
+constexpr int kDefaultBatchLatencyMs = 20;
+constexpr int kStatsIntervalSec = 10;
+constexpr size_t kDefaultLogQueueCapacity = 256; // ~0.25 s of frames at 1 kHz
+} // namespace
+
+struct AsicSender::Batch {
+    uint8_t* tx = nullptr;               // Padded waveforms back to back, BUF_LEN bytes
+    uint8_t* rx = nullptr;               // FPGA response, BUF_LEN bytes
+    size_t txLength = 0;
+    size_t frameCount = 0;
+    bool flushedByDeadline = false;
+    uint32_t haloOuts = 0;               // ep30 sampled right after this batch was written
+    std::chrono::steady_clock::time_point deadline;   // Flush a partial batch by then
+    std::vector<size_t> offsets;                      // Start of each frame in tx/rx
+    std::vector<std::chrono::steady_clock::time_point> queuedAt;
+    std::vector<std::vector<uint8_t>> originals;      // Unpadded waveforms for the analyzer
+    std::vector<LatencyTrace> traces;
+
+    Batch(size_t length, int maxFrames)
+        : offsets(maxFrames), queuedAt(maxFrames), originals(maxFrames), traces(maxFrames) {
+        void* p = nullptr;
+        if (posix_memalign(&p, kTransferAlignment, length) == 0) {
+            tx = static_cast<uint8_t*>(p);
+        }
+        p = nullptr;
+        if (posix_memalign(&p, kTransferAlignment, length) == 0) {
+            rx = static_cast<uint8_t*>(p);
+        }
+    }
+    ~Batch() {
+        free(tx);
+        free(rx);
+    }
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+};
+
+AsicSender::AsicSender()
+#ifdef ASIC_SENDER_EMULATED
+    : AsicSender(std::unique_ptr<FrontPanelDevice>(new FrontPanelEmulator())) {
+#else
+    : AsicSender(std::unique_ptr<FrontPanelDevice>(new OkFrontPanelDevice())) {
+#endif
+}
+
+AsicSender::AsicSender(std::unique_ptr<FrontPanelDevice> device)
+    : device_(std::move(device)), running_(false), initialized_(false), verbose_(true), data_analyzer_(nullptr),
+      latencyTracker_(nullptr),
+      pipelineDepth_(kDefaultPipelineDepth), framesPerBatch_(1),
+      maxBatchLatency_(kDefaultBatchLatencyMs), filling_(nullptr), inFlightBytes_(0), writerDone_(true),
+      logQueueCapacity_(kDefaultLogQueueCapacity), logQueuePolicy_(OverflowPolicy::DropOldest) {
 }
 
 AsicSender::~AsicSender() {
     stopSending();
-    if (device_) {
-        delete device_;
-        device_ = nullptr;
-    }
 }
 
 bool AsicSender::initialize(const std::string& deviceSerial, const std::string& bitfilePath) {
     std::cout << "Initializing ASIC Sender..." << std::endl;
     
     // Open device by serial number
-    int error = device_->OpenBySerial(deviceSerial.c_str());
+    int error = device_->OpenBySerial(deviceSerial);
     std::cout << "OpenBySerial ret value: " << error << std::endl;
     
-    if (error != OpalKellyLegacy::okCFrontPanel::NoError) {
+    if (error != FrontPanelDevice::NoError) {
         std::cerr << "Failed to open ASIC device with serial: " << deviceSerial << std::endl;
         return false;
     }
@@ -51,10 +108,10 @@ bool AsicSender::initialize(const std::string& deviceSerial, const std::string&
 bool AsicSender::configureFpga(const std::string& bitfilePath) {
     std::cout << "Configuring ASIC FPGA with bitfile: " << bitfilePath << std::endl;
     
-    int error = device_->ConfigureFPGA(bitfilePath.c_str());
+    int error = device_->ConfigureFPGA(bitfilePath);
     std::cout << "ConfigureFPGA ret value: " << error << std::endl;
     
-    return (error == OpalKellyLegacy::okCFrontPanel::NoError);
+    return (error == FrontPanelDevice::NoError);
 }
 
 void AsicSender::resetFifo() {
@@ -70,25 +127,42 @@ void AsicSender::resetFifo() {
     std::cout << "ASIC FIFO reset complete" << std::endl;
 }
 
-bool AsicSender::writeToFpga(const std::vector<uint8_t>& data) {
-    int writeRet = device_->WriteToPipeIn(0x80, data.size(), data.data());
+bool AsicSender::writeToFpga(const uint8_t* data, size_t length) {
+    int writeRet = device_->WriteToPipeIn(0x80, length, data);
     
     // Return value is the number of bytes written, not an error code
     return (writeRet > 0);
 }
 
-bool AsicSender::readFromFpga(std::vector<uint8_t>& data) {
-    data.resize(BUF_LEN);
-    
-    int readRet = device_->ReadFromPipeOut(0xA0, data.size(), data.data());
-    
+int AsicSender::readFromFpga(uint8_t* data, size_t length) {
     // Return value is the number of bytes read, not an error code
-    if (readRet > 0) {
-        data.resize(readRet); // Resize to actual bytes read
-        return true;
+    return device_->ReadFromPipeOut(0xA0, length, data);
+}
+
+void AsicSender::setPipelineDepth(int depth) {
+    if (running_) {
+        std::cerr << "Pipeline depth must be set before sending starts" << std::endl;
+        return;
     }
-    
-    return false;
+    pipelineDepth_ = std::max(1, std::min(depth, MAX_PIPELINE_DEPTH));
+}
+
+void AsicSender::setBatching(int framesPerBatch, int maxLatencyMs) {
+    if (running_) {
+        std::cerr << "Batching must be set before sending starts" << std::endl;
+        return;
+    }
+    framesPerBatch_ = std::max(1, std::min(framesPerBatch, MAX_BATCH_FRAMES));
+    maxBatchLatency_ = std::chrono::milliseconds(std::max(0, maxLatencyMs));
+}
+
+void AsicSender::setLogQueue(size_t capacity, OverflowPolicy policy) {
+    if (running_) {
+        std::cerr << "Log queue must be set before sending starts" << std::endl;
+        return;
+    }
+    logQueueCapacity_ = std::max<size_t>(1, capacity);
+    logQueuePolicy_ = policy;
 }
 
 void AsicSender::startSending() {
@@ -97,14 +171,74 @@ void AsicSender::startSending() {
         return;
     }
     
-    std::cout << "Starting ASIC data sending..." << std::endl;
-    running_ = true;
+    std::lock_guard<std::mutex> workers(workerMutex_);
+    if (running_) {
+        return;
+    }
+    
+    // One batch being filled by the caller and one being analysed, on top of
+    // the batches the FPGA may hold
+    size_t batchCount = static_cast<size_t>(pipelineDepth_) + 2;
+    batches_.clear();
+    while (batches_.size() < batchCount) {
+        batches_.push_back(std::unique_ptr<Batch>(new Batch(BUF_LEN, framesPerBatch_)));
+        if (!batches_.back()->tx || !batches_.back()->rx) {
+            std::cerr << "Failed to allocate ASIC transfer buffers" << std::endl;
+            batches_.clear();
+            return;
+        }
+    }
+    logQueue_.reset(new ResponseQueue(logQueueCapacity_, BUF_LEN, logQueuePolicy_));
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        freeBatches_.clear();
+        pendingWrites_.clear();
+        inFlight_.clear();
+        inFlightBytes_ = 0;
+        filling_ = nullptr;
+        writerDone_ = false;
+        for (auto& batch : batches_) {
+            freeBatches_.push_back(batch.get());
+        }
+        running_ = true;
+    }
+    stats_ = BatchStats();
+    stats_.since = std::chrono::steady_clock::now();
+    
+    std::cout << "Starting ASIC data sending (pipeline depth " << pipelineDepth_
+              << ", up to " << framesPerBatch_ << " frame(s) per transfer, "
+              << maxBatchLatency_.count() << " ms batch deadline)..." << std::endl;
+    writerThread_ = std::thread(&AsicSender::writerLoop, this);
+    readerThread_ = std::thread(&AsicSender::readerLoop, this);
+    loggerThread_ = std::thread(&AsicSender::loggerLoop, this);
 }
 
 void AsicSender::stopSending() {
-    if (running_) {
-        std::cout << "Stopping ASIC data sending..." << std::endl;
-        running_ = false;
+    std::lock_guard<std::mutex> workers(workerMutex_);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (running_) {
+            std::cout << "Stopping ASIC data sending..." << std::endl;
+            running_ = false;
+        }
+    }
+    queueCv_.notify_all();
+    
+    // Frames already queued (including a partial batch) are still written and
+    // their responses read, so no block is lost and the FPGA FIFOs are empty
+    // on the next start
+    if (writerThread_.joinable()) {
+        writerThread_.join();
+    }
+    if (readerThread_.joinable()) {
+        readerThread_.join();
+    }
+    // Every response is queued by now; the logger writes them out and exits
+    if (logQueue_) {
+        logQueue_->close();
+    }
+    if (loggerThread_.joinable()) {
+        loggerThread_.join();
     }
 }
 
@@ -209,77 +343,260 @@ bool AsicSender::setThresholds(double lowThreshold, double highThreshold) {
     return true;
 }
 
-void AsicSender::sendWaveformData(const std::vector<uint8_t>& waveformData) {
+void AsicSender::sendWaveformData(const std::vector<uint8_t>& waveformData, const LatencyTrace& trace) {
     if (!running_ || !initialized_) {
         return;
     }
     
-    // Ensure data length is multiple of 16 for USB 3.0
-    std::vector<uint8_t> paddedData = waveformData;
-    while (paddedData.size() % 16 != 0) {
-        paddedData.push_back(0);
-    }
+    // Ensure data length is multiple of 16 for USB 3.0, limited to BUF_LEN
+    size_t length = std::min(waveformData.size(), BUF_LEN);
+    size_t paddedLength = std::min((length + 15) & ~static_cast<size_t>(15), BUF_LEN);
     
-    // Limit to BUF_LEN
-    if (paddedData.size() > BUF_LEN) {
-        paddedData.resize(BUF_LEN);
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    if (filling_ && filling_->txLength + paddedLength > BUF_LEN) {
+        // The next frame would overflow the FIFO; send what we have
+        pendingWrites_.push_back(filling_);
+        filling_ = nullptr;
+        queueCv_.notify_all();
+    }
+    if (!filling_) {
+        queueCv_.wait(lock, [this] { return !running_ || !freeBatches_.empty(); });
+        if (!running_) {
+            return;
+        }
+        filling_ = freeBatches_.front();
+        freeBatches_.pop_front();
+        filling_->txLength = 0;
+        filling_->frameCount = 0;
+        filling_->flushedByDeadline = false;
+        filling_->deadline = std::chrono::steady_clock::now() + maxBatchLatency_;
     }
     
-    // Get current timestamp
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto tm = *std::localtime(&time_t);
-    
-    std::cout << "[";
-    std::cout << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    std::cout << "] Sending waveform data to the FPGA..." << std::endl;
-    
-    // Send timestamp to FPGA via ep01wire (input timestamp)
-    uint32_t timestamp = static_cast<uint32_t>(time_t);  // Unix timestamp
-    device_->SetWireInValue(0x01, timestamp, 0xFFFFFFFF);
-    device_->UpdateWireIns();
-    
-    // Send data to FPGA
-    if (!writeToFpga(paddedData)) {
-        std::cerr << "Failed to write waveform data to ASIC FPGA" << std::endl;
-        return;
+    Batch* batch = filling_;
+    size_t index = batch->frameCount++;
+    batch->offsets[index] = batch->txLength;
+    batch->queuedAt[index] = std::chrono::steady_clock::now();
+    std::memcpy(batch->tx + batch->txLength, waveformData.data(), length);
+    std::memset(batch->tx + batch->txLength + length, 0, paddedLength - length);
+    batch->txLength += paddedLength;
+    batch->originals[index].assign(waveformData.begin(), waveformData.end());
+    batch->traces[index] = trace;
+    if (trace.ns[LatencyConsumed] == 0) {
+        // Caller did not trace the frame; queueing starts here
+        batch->traces[index].stamp(LatencyConsumed);
     }
     
-    // Read processed data from FPGA
-    std::vector<uint8_t> processedData;
-    if (!readFromFpga(processedData)) {
-        std::cerr << "Failed to read processed data from ASIC FPGA" << std::endl;
-        return;
-    } else {
-        // Get current timestamp for success message
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        auto tm = *std::localtime(&time_t);
+    if (batch->frameCount == static_cast<size_t>(framesPerBatch_)) {
+        pendingWrites_.push_back(batch);
+        filling_ = nullptr;
+    }
+    lock.unlock();
+    // A new partial batch also needs the writer to arm its deadline
+    queueCv_.notify_all();
+}
+
+void AsicSender::writerLoop() {
+    while (true) {
+        Batch* batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            for (;;) {
+                if (filling_ && (!running_ || std::chrono::steady_clock::now() >= filling_->deadline)) {
+                    // Latency cap (or shutdown): send the partial batch as is
+                    filling_->flushedByDeadline = running_;
+                    pendingWrites_.push_back(filling_);
+                    filling_ = nullptr;
+                }
+                // Keep at most pipelineDepth_ transfers inside the FPGA, and
+                // never more response bytes than its output FIFO holds
+                if (!pendingWrites_.empty() && inFlight_.size() < static_cast<size_t>(pipelineDepth_) &&
+                    inFlightBytes_ + pendingWrites_.front()->txLength <= BUF_LEN) {
+                    break;
+                }
+                if (!running_ && pendingWrites_.empty() && !filling_) {
+                    writerDone_ = true;
+                    break;
+                }
+                if (filling_) {
+                    queueCv_.wait_until(lock, filling_->deadline);
+                } else {
+                    queueCv_.wait(lock);
+                }
+            }
+            if (writerDone_) {
+                break;
+            }
+            batch = pendingWrites_.front();
+            pendingWrites_.pop_front();
+        }
+        
+        if (verbose_) {
+            PLOG_DEBUG("asic", "Sending {} waveform frame(s) ({} bytes) to the FPGA", batch->frameCount, batch->txLength);
+        }
+        
+        bool written;
+        {
+            std::lock_guard<std::mutex> device(deviceMutex_);
+            // Send timestamp to FPGA via ep01wire (input timestamp)
+            uint32_t timestamp = static_cast<uint32_t>(std::time(nullptr));  // Unix timestamp
+            device_->SetWireInValue(0x01, timestamp, 0xFFFFFFFF);
+            device_->UpdateWireIns();
+            
+            // Send all frames of the batch in one transfer
+            written = writeToFpga(batch->tx, batch->txLength);
+            
+            // Sample ep30 (HALO_outs) now: with more than one batch in
+            // flight the next write would update it before this batch's
+            // response is read
+            if (written) {
+                device_->UpdateWireOuts();
+                batch->haloOuts = device_->GetWireOutValue(0x30);
+            }
+        }
+        const uint64_t sentNs = monotonicNowNs();
+        for (size_t i = 0; i < batch->frameCount; ++i) {
+            batch->traces[i].ns[LatencySent] = sentNs;
+        }
         
-        std::cout << "[";
-        std::cout << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-        std::cout << "] Data successfully read from ASIC FPGA!" << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            if (written) {
+                inFlight_.push_back(batch);
+                inFlightBytes_ += batch->txLength;
+            } else {
+                freeBatches_.push_back(batch);
+            }
+        }
+        queueCv_.notify_all();
+        if (!written) {
+            PLOG_ERROR("asic", "Failed to write waveform data to ASIC FPGA");
+        }
     }
-    
-    // Read seizure detection results from WireOut
-    device_->UpdateWireOuts();
-    uint32_t seizureResults = device_->GetWireOutValue(0x30);  // ep30wire contains HALO_outs
-    
+    queueCv_.notify_all();
+}
+
+void AsicSender::readerLoop() {
+    while (true) {
+        Batch* batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueCv_.wait(lock, [this] { return !inFlight_.empty() || writerDone_; });
+            if (inFlight_.empty()) {
+                break; // Writer has flushed and every response is in
+            }
+            batch = inFlight_.front();
+        }
+        
+        // Read the responses for the whole batch in one transfer; the writer
+        // may already be pushing the next batch between these calls. The
+        // FPGA returns one byte per input byte, so read exactly what was
+        // written: a longer read would swallow the next batch's response.
+        int readRet;
+        {
+            std::lock_guard<std::mutex> device(deviceMutex_);
+            readRet = readFromFpga(batch->rx, batch->txLength);
+            const uint64_t respondedNs = monotonicNowNs();
+            for (size_t i = 0; i < batch->frameCount; ++i) {
+                batch->traces[i].ns[LatencyResponded] = respondedNs;
+            }
+        }
+        
+        // The batch leaves the FPGA's window once its response is in; free
+        // the slot so the writer can queue the next one during analysis
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            inFlight_.pop_front();
+            inFlightBytes_ -= batch->txLength;
+        }
+        queueCv_.notify_all();
+        
+        if (readRet > 0) {
+            handleResponse(batch, static_cast<size_t>(readRet), batch->haloOuts);
+        } else {
+            PLOG_ERROR("asic", "Failed to read processed data from ASIC FPGA");
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            freeBatches_.push_back(batch);
+        }
+        queueCv_.notify_all();
+    }
+    reportBatchStats();
+}
+
+void AsicSender::handleResponse(Batch* batch, size_t length, uint32_t seizureResults) {
     // Extract seizure detection results according to corrected FPGA format:
     // HALO_outs[31:2] = seizure_timestamp[29:0]
     // HALO_outs[1] = seizure_result_valid
     // HALO_outs[0] = seizure_detected
+    // With batching this is the state after the last frame of the batch
     bool seizureDetected = (seizureResults & 0x01) != 0;
     bool resultValid = (seizureResults & 0x02) != 0;
     uint32_t seizureTimestamp = (seizureResults >> 2) & 0x3FFFFFFF;  // 30-bit timestamp
+    if (verbose_) {
+        PLOG_DEBUG("asic", "Read {} response bytes: detected {}, valid {}, timestamp {}",
+                   length, seizureDetected, resultValid, seizureTimestamp);
+    }
+    if (seizureDetected && resultValid) {
+        PLOG_INFO("asic", "Seizure detected by the FPGA (timestamp {})", seizureTimestamp);
+    }
     
-    std::cout << "Seizure Detection Results:" << std::endl;
-    std::cout << "  Detected: " << (seizureDetected ? "YES" : "NO") << std::endl;
-    std::cout << "  Valid: " << (resultValid ? "YES" : "NO") << std::endl;
-    std::cout << "  Timestamp: " << seizureTimestamp << std::endl;
+    // Each frame owns the response bytes from its own offset up to the next
+    // frame's. Decoding and disk writes happen on the logging thread.
+    if (data_analyzer_ || latencyTracker_) {
+        for (size_t i = 0; i < batch->frameCount; ++i) {
+            size_t begin = std::min(batch->offsets[i], length);
+            size_t end = i + 1 < batch->frameCount ? std::min(batch->offsets[i + 1], length) : length;
+            logQueue_->push(batch->rx + begin, end - begin, batch->originals[i], batch->traces[i]);
+        }
+    }
     
-    // Analyze FPGA response data with original neural data
-    if (data_analyzer_) {
-        data_analyzer_->analyzeFpgaData(processedData, waveformData);
+    // Latency runs from sendWaveformData() to the hand-off to the logging thread
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < batch->frameCount; ++i) {
+        double latencyMs = std::chrono::duration<double, std::milli>(now - batch->queuedAt[i]).count();
+        stats_.latencySumMs += latencyMs;
+        stats_.latencyMaxMs = std::max(stats_.latencyMaxMs, latencyMs);
+    }
+    stats_.frames += batch->frameCount;
+    stats_.batches++;
+    stats_.deadlineFlushes += batch->flushedByDeadline ? 1 : 0;
+    if (now - stats_.since >= std::chrono::seconds(kStatsIntervalSec)) {
+        reportBatchStats();
+    }
+}
+
+void AsicSender::loggerLoop() {
+    ResponseRecord record;
+    record.response.reserve(BUF_LEN);
+    record.original.reserve(BUF_LEN);
+    while (logQueue_->pop(record)) {
+        if (data_analyzer_ && !record.response.empty()) {
+            data_analyzer_->analyzeFpgaData(record.response, record.original);
+        }
+        if (latencyTracker_) {
+            record.trace.stamp(LatencyAnalyzed);
+            latencyTracker_->record(record.trace);
+        }
+    }
+}
+
+void AsicSender::reportBatchStats() {
+    if (stats_.batches == 0) {
+        return;
+    }
+    PLOG_INFO("asic", "transfers: {}, fill avg {:.2f}/{} frames, deadline flushes: {}, frame latency avg {:.1f} ms, max {:.1f} ms",
+              stats_.batches, (double)stats_.frames / stats_.batches, framesPerBatch_, stats_.deadlineFlushes,
+              stats_.latencySumMs / stats_.frames, stats_.latencyMaxMs);
+    ResponseQueueStats queue = logQueue_->stats(true);
+    if (queue.pushed > 0) {
+        PLOG_INFO("asic", "log queue: max depth {}/{}, dropped {}, blocked {}",
+                  queue.maxDepth, logQueue_->capacity(), queue.dropped, queue.blocked);
+    }
+    if (queue.dropped > 0) {
+        PLOG_WARN("asic", "logging thread fell behind; {} response(s) not logged", queue.dropped);
     }
+    stats_ = BatchStats();
+    stats_.since = std::chrono::steady_clock::now();
 }
@@ -7,14 +7,24 @@
 #include <atomic>
 #include <thread>
 #include <memory>
-#include "okFrontPanel.h"
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include "frontpanel_device.h"
+#include "response_queue.h"
+#include "../intan-reader/latency_tracker.h"
 
 // Forward declaration
 class FpgaLogger;
 
 class AsicSender {
 public:
+    // Talks to the XEM6310, or to FrontPanelEmulator when built with
+    // ASIC_SENDER_EMULATED
     AsicSender();
+    // Uses the given device (e.g. a configured FrontPanelEmulator)
+    explicit AsicSender(std::unique_ptr<FrontPanelDevice> device);
     ~AsicSender();
     
     // Initialize ASIC FPGA connection
@@ -29,12 +39,39 @@ public:
     // Check if running
     bool isRunning() const { return running_; }
     
-    // Send waveform data (called from main pipeline)
-    void sendWaveformData(const std::vector<uint8_t>& waveformData);
+    // Queue waveform data for the FPGA (called from main pipeline). Returns
+    // once the frame is copied into a transfer buffer; blocks only while all
+    // buffers are in flight. trace carries the frame's stamps so far
+    // (SharedMemoryReader::lastTrace()); Sent, Responded and Analyzed are
+    // added here and the result goes to the latency tracker.
+    void sendWaveformData(const std::vector<uint8_t>& waveformData, const LatencyTrace& trace = LatencyTrace());
     
-    // Set FPGA data analyzer for response analysis
+    // Transfers written to the FPGA before the oldest response is read back
+    // (1 = no overlap, 2 = double-buffered). Set before startSending().
+    void setPipelineDepth(int depth);
+    
+    // Pack up to framesPerBatch consecutive frames (as many as fit in
+    // BUF_LEN) into one pipe transfer each way. A partial batch is sent once
+    // its first frame has waited maxLatencyMs. Set before startSending().
+    void setBatching(int framesPerBatch, int maxLatencyMs);
+    
+    // Per-transfer PLOG_DEBUG lines (on by default; benchmarks turn them off).
+    // They are compiled in only with PIPELINE_LOG_LEVEL_DEBUG.
+    void setVerbose(bool verbose) { verbose_ = verbose; }
+    
+    // Set FPGA data analyzer for response analysis. Responses are decoded
+    // and written on a separate logging thread, not on the FPGA reader thread.
     void setDataAnalyzer(FpgaLogger* analyzer);
     
+    // Responses waiting for the logging thread (default 256, DropOldest).
+    // DropOldest discards the oldest unlogged response when the logger falls
+    // behind, so disk stalls never reach the FPGA transfers; Block makes the
+    // reader wait instead and loses nothing. Set before startSending().
+    void setLogQueue(size_t capacity, OverflowPolicy policy);
+    
+    // Per-stage latency of every frame, recorded once it has been analysed
+    void setLatencyTracker(LatencyTracker* tracker) { latencyTracker_ = tracker; }
+    
     // FPGA Configuration methods
     bool configurePipeline(int pipelineId);
     bool enableAnalysisMode();
@@ -42,17 +79,64 @@ public:
     bool setThresholds(double lowThreshold, double highThreshold);
 
 private:
-    OpalKellyLegacy::okCFrontPanel* device_;
+    struct Batch; // Aligned tx/rx transfer buffers for one or more waveform frames
+    
+    struct BatchStats {
+        uint64_t batches = 0;
+        uint64_t frames = 0;
+        uint64_t deadlineFlushes = 0;
+        double latencySumMs = 0.0;
+        double latencyMaxMs = 0.0;
+        std::chrono::steady_clock::time_point since;
+    };
+    
+    std::unique_ptr<FrontPanelDevice> device_;
     std::atomic<bool> running_;
     std::atomic<bool> initialized_;
+    bool verbose_;
     static const size_t BUF_LEN; // Must be multiple of 16 for USB 3.0
+    static const int MAX_PIPELINE_DEPTH; // FPGA input FIFO holds ~4 blocks
+    static const int MAX_BATCH_FRAMES;
     FpgaLogger* data_analyzer_;
+    LatencyTracker* latencyTracker_;
+    
+    // Transfer pipeline: sendWaveformData -> writer thread -> reader thread.
+    // Batches cycle free -> filling -> pending -> inFlight -> free; nothing is
+    // allocated once sending has started.
+    int pipelineDepth_;
+    int framesPerBatch_;
+    std::chrono::milliseconds maxBatchLatency_;
+    std::vector<std::unique_ptr<Batch>> batches_;
+    std::deque<Batch*> freeBatches_;
+    Batch* filling_;                    // Partial batch still accepting frames
+    std::deque<Batch*> pendingWrites_;
+    std::deque<Batch*> inFlight_;       // Written to the FPGA, response not read yet
+    size_t inFlightBytes_;              // Responses the FPGA output FIFO must hold
+    bool writerDone_;                   // Writer has flushed pendingWrites_ and exited
+    std::mutex queueMutex_;
+    std::condition_variable queueCv_;
+    std::mutex deviceMutex_;            // FrontPanel calls are not thread-safe
+    std::mutex workerMutex_;            // Serialises start/stop of the worker threads
+    std::thread writerThread_;
+    std::thread readerThread_;
+    
+    // Reader thread -> logging thread (decode, HDF5, latency record)
+    size_t logQueueCapacity_;
+    OverflowPolicy logQueuePolicy_;
+    std::unique_ptr<ResponseQueue> logQueue_;
+    std::thread loggerThread_;
+    BatchStats stats_;                   // Reader thread only
     
     // Helper functions
     bool configureFpga(const std::string& bitfilePath);
     void resetFifo();
-    bool writeToFpga(const std::vector<uint8_t>& data);
-    bool readFromFpga(std::vector<uint8_t>& data);
+    bool writeToFpga(const uint8_t* data, size_t length);
+    int readFromFpga(uint8_t* data, size_t length);
+    void writerLoop();
+    void readerLoop();
+    void loggerLoop();
+    void handleResponse(Batch* batch, size_t length, uint32_t seizureResults);
+    void reportBatchStats();
     void printDataArray(const std::vector<uint8_t>& data, const std::string& label);
 };
 
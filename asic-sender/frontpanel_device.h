@@ -0,0 +1,58 @@
+#ifndef FRONTPANEL_DEVICE_H
+#define FRONTPANEL_DEVICE_H
+
+#include <cstdint>
+#include <string>
+
+// The subset of okCFrontPanel that AsicSender uses. The real XEM6310 sits
+// behind OkFrontPanelDevice; FrontPanelEmulator (frontpanel_emulator.h)
+// stands in for it on machines without the board. Return values follow the
+// FrontPanel SDK: error codes for setup calls (NoError = 0), byte counts
+// (or a negative error code) for pipe transfers.
+class FrontPanelDevice {
+public:
+    enum ErrorCode {
+        NoError = 0,
+        Failed = -1,
+        DeviceNotOpen = -8
+    };
+
+    virtual ~FrontPanelDevice() {}
+
+    virtual int OpenBySerial(const std::string& serial) = 0;
+    virtual int ConfigureFPGA(const std::string& bitfilePath) = 0;
+
+    virtual int SetWireInValue(int ep, uint32_t value, uint32_t mask) = 0;
+    virtual int UpdateWireIns() = 0;
+    virtual int UpdateWireOuts() = 0;
+    virtual uint32_t GetWireOutValue(int ep) = 0;
+    virtual int ActivateTriggerIn(int ep, int bit) = 0;
+
+    virtual long WriteToPipeIn(int ep, long length, const uint8_t* data) = 0;
+    virtual long ReadFromPipeOut(int ep, long length, uint8_t* data) = 0;
+};
+
+#ifndef ASIC_SENDER_EMULATED
+#include "okFrontPanel.h"
+
+// Forwards to the Opal Kelly FrontPanel SDK
+class OkFrontPanelDevice : public FrontPanelDevice {
+public:
+    int OpenBySerial(const std::string& serial) override { return device_.OpenBySerial(serial); }
+    int ConfigureFPGA(const std::string& bitfilePath) override { return device_.ConfigureFPGA(bitfilePath); }
+
+    int SetWireInValue(int ep, uint32_t value, uint32_t mask) override { return device_.SetWireInValue(ep, value, mask); }
+    int UpdateWireIns() override { return device_.UpdateWireIns(); }
+    int UpdateWireOuts() override { return device_.UpdateWireOuts(); }
+    uint32_t GetWireOutValue(int ep) override { return static_cast<uint32_t>(device_.GetWireOutValue(ep)); }
+    int ActivateTriggerIn(int ep, int bit) override { return device_.ActivateTriggerIn(ep, bit); }
+
+    long WriteToPipeIn(int ep, long length, const uint8_t* data) override { return device_.WriteToPipeIn(ep, length, data); }
+    long ReadFromPipeOut(int ep, long length, uint8_t* data) override { return device_.ReadFromPipeOut(ep, length, data); }
+
+private:
+    OpalKellyLegacy::okCFrontPanel device_;
+};
+#endif // ASIC_SENDER_EMULATED
+
+#endif // FRONTPANEL_DEVICE_H
@@ -0,0 +1,223 @@
+#include "frontpanel_emulator.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace {
+constexpr int kChannels = 32;
+constexpr int kWireOutBase = 0x20;
+constexpr int kHaloOutsEp = 0x30;
+constexpr int kPipeInBase = 0x80;
+constexpr int kPipeOutBase = 0xA0;
+
+bool isWireIn(int ep) { return ep >= 0x00 && ep < 0x20; }
+bool isWireOut(int ep) { return ep >= 0x20 && ep < 0x40; }
+bool isTriggerIn(int ep) { return ep >= 0x40 && ep < 0x60; }
+bool isPipeIn(int ep) { return ep >= kPipeInBase && ep < kPipeInBase + 0x20; }
+bool isPipeOut(int ep) { return ep >= kPipeOutBase && ep < kPipeOutBase + 0x20; }
+} // namespace
+
+FrontPanelEmulator::FrontPanelEmulator(const FrontPanelEmulatorConfig& config)
+    : config_(config), open_(false), configured_(false), busFreeAt_(Clock::now()), outputFifoBytes_(0) {
+    std::memset(wireInStaged_, 0, sizeof(wireInStaged_));
+    std::memset(wireIn_, 0, sizeof(wireIn_));
+    std::memset(wireOutLive_, 0, sizeof(wireOutLive_));
+    std::memset(wireOut_, 0, sizeof(wireOut_));
+    model_.configure(kChannels);
+}
+
+int FrontPanelEmulator::OpenBySerial(const std::string& serial) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!config_.serial.empty() && serial != config_.serial) {
+        return Failed;
+    }
+    open_ = true;
+    return NoError;
+}
+
+int FrontPanelEmulator::ConfigureFPGA(const std::string& /* bitfilePath */) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_) {
+        return DeviceNotOpen;
+    }
+    // Loading a bitstream resets the fabric
+    configured_ = true;
+    std::memset(wireIn_, 0, sizeof(wireIn_));
+    std::memset(wireOutLive_, 0, sizeof(wireOutLive_));
+    outputFifo_.clear();
+    outputFifoBytes_ = 0;
+    model_.reset();
+    return NoError;
+}
+
+int FrontPanelEmulator::SetWireInValue(int ep, uint32_t value, uint32_t mask) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_) {
+        return DeviceNotOpen;
+    }
+    if (!isWireIn(ep)) {
+        return Failed;
+    }
+    wireInStaged_[ep] = (wireInStaged_[ep] & ~mask) | (value & mask);
+    return NoError;
+}
+
+int FrontPanelEmulator::UpdateWireIns() {
+    Clock::time_point done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_) {
+            return DeviceNotOpen;
+        }
+        done = occupyBus(config_.wireLatencyUs);
+        std::memcpy(wireIn_, wireInStaged_, sizeof(wireIn_));
+    }
+    std::this_thread::sleep_until(done);
+    return NoError;
+}
+
+int FrontPanelEmulator::UpdateWireOuts() {
+    Clock::time_point done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_) {
+            return DeviceNotOpen;
+        }
+        done = occupyBus(config_.wireLatencyUs);
+        std::memcpy(wireOut_, wireOutLive_, sizeof(wireOut_));
+    }
+    std::this_thread::sleep_until(done);
+    return NoError;
+}
+
+uint32_t FrontPanelEmulator::GetWireOutValue(int ep) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return isWireOut(ep) ? wireOut_[ep - kWireOutBase] : 0;
+}
+
+int FrontPanelEmulator::ActivateTriggerIn(int ep, int bit) {
+    Clock::time_point done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_) {
+            return DeviceNotOpen;
+        }
+        if (!isTriggerIn(ep) || bit < 0 || bit > 31) {
+            return Failed;
+        }
+        done = occupyBus(config_.wireLatencyUs);
+    }
+    std::this_thread::sleep_until(done);
+    return NoError;
+}
+
+long FrontPanelEmulator::WriteToPipeIn(int ep, long length, const uint8_t* data) {
+    if (length <= 0 || length % 16 != 0 || !data) {
+        return Failed;
+    }
+    Clock::time_point done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_ || !configured_) {
+            return DeviceNotOpen;
+        }
+        if (!isPipeIn(ep)) {
+            return Failed;
+        }
+        done = occupyBus(config_.usbLatencyUs + length / config_.usbBandwidthMBps);
+    }
+    std::this_thread::sleep_until(done);
+
+    PendingBytes pending;
+    pending.readyAt = done + std::chrono::nanoseconds(static_cast<int64_t>(length * config_.fpgaNsPerByte));
+    pending.consumed = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    processBlock(data, static_cast<size_t>(length), pending.bytes);
+    stats_.pipeInTransfers++;
+    stats_.bytesIn += static_cast<uint64_t>(length);
+
+    // A full output FIFO loses its oldest responses, as on the board
+    outputFifoBytes_ += pending.bytes.size();
+    outputFifo_.push_back(std::move(pending));
+    while (outputFifoBytes_ > config_.fifoBytes && !outputFifo_.empty()) {
+        PendingBytes& oldest = outputFifo_.front();
+        size_t drop = std::min(oldest.bytes.size() - oldest.consumed, outputFifoBytes_ - config_.fifoBytes);
+        oldest.consumed += drop;
+        outputFifoBytes_ -= drop;
+        stats_.overflowBytes += drop;
+        if (oldest.consumed == oldest.bytes.size()) {
+            outputFifo_.pop_front();
+        }
+    }
+    return length;
+}
+
+long FrontPanelEmulator::ReadFromPipeOut(int ep, long length, uint8_t* data) {
+    if (length <= 0 || length % 16 != 0 || !data) {
+        return Failed;
+    }
+    Clock::time_point done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_ || !configured_) {
+            return DeviceNotOpen;
+        }
+        if (!isPipeOut(ep)) {
+            return Failed;
+        }
+        // The transfer cannot finish before the FPGA has produced the data
+        Clock::time_point readyAt = outputFifo_.empty() ? Clock::now() : outputFifo_.front().readyAt;
+        busFreeAt_ = std::max(busFreeAt_, readyAt);
+        done = occupyBus(config_.usbLatencyUs + length / config_.usbBandwidthMBps);
+    }
+    std::this_thread::sleep_until(done);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t copied = 0;
+    while (copied < static_cast<size_t>(length) && !outputFifo_.empty()) {
+        PendingBytes& front = outputFifo_.front();
+        size_t n = std::min(front.bytes.size() - front.consumed, static_cast<size_t>(length) - copied);
+        std::memcpy(data + copied, front.bytes.data() + front.consumed, n);
+        front.consumed += n;
+        copied += n;
+        outputFifoBytes_ -= n;
+        if (front.consumed == front.bytes.size()) {
+            outputFifo_.pop_front();
+        }
+    }
+    // An empty pipe still completes the transfer; the HDL pads with zeros
+    std::memset(data + copied, 0, static_cast<size_t>(length) - copied);
+    stats_.underflowBytes += static_cast<size_t>(length) - copied;
+    stats_.pipeOutTransfers++;
+    stats_.bytesOut += static_cast<uint64_t>(length);
+    return length;
+}
+
+FrontPanelEmulatorStats FrontPanelEmulator::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+FrontPanelEmulator::Clock::time_point FrontPanelEmulator::occupyBus(double costUs) {
+    Clock::time_point start = std::max(Clock::now(), busFreeAt_);
+    busFreeAt_ = start + std::chrono::nanoseconds(static_cast<int64_t>(costUs * 1000.0));
+    return busFreeAt_;
+}
+
+void FrontPanelEmulator::processBlock(const uint8_t* data, size_t length, std::vector<uint8_t>& response) {
+    // Configuration as written by AsicSender::setThresholds()
+    const bool enabled = (wireIn_[0x00] & 0x01) != 0;
+    model_.setSeizureChannels((wireIn_[0x00] >> 8) & 0xFF);
+    model_.setNeoThreshold(static_cast<int32_t>(wireIn_[0x02] & 0xFFFF));
+
+    const HaloReferenceResult& result = model_.process(data, length);
+    response.assign(length, 0);
+    std::copy(result.gated.begin(), result.gated.end(), response.begin());
+
+    bool detected = enabled && result.detected;
+    HaloReferenceResult status;
+    status.detected = detected;
+    wireOutLive_[kHaloOutsEp - kWireOutBase] = status.haloOuts(wireIn_[0x01]);
+    stats_.blocksProcessed++;
+    stats_.detections += detected ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+#ifndef FRONTPANEL_EMULATOR_H
+#define FRONTPANEL_EMULATOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "frontpanel_device.h"
+#include "../data-analyser/src/core/halo_reference_model.h"
+
+// Software stand-in for the XEM6310 running the HALO bitstream, so the ASIC
+// sender can run and be benchmarked without the board.
+//
+// Timing: every pipe transfer costs a fixed USB latency plus length /
+// bandwidth, wire updates cost a fixed latency, and the bus is shared, so
+// calls from different threads queue behind each other like on the real
+// link. A written block becomes readable after the modelled FPGA processing
+// time.
+//
+// Behaviour: pipeline 6 is computed by HaloReferenceModel over rows of 32
+// channel bytes, one transfer at a time, with the NEO threshold from
+// ep02[15:0] and the channel count from ep00[15:8] (ep00[0] enables it). The
+// pipe out returns the GATE output, and ep30 reports
+// timestamp(ep01)[29:0] << 2 | valid << 1 | detected.
+struct FrontPanelEmulatorConfig {
+    std::string serial;                 // Accept only this serial (empty = any)
+    double usbLatencyUs = 150.0;        // Per pipe transfer
+    double usbBandwidthMBps = 340.0;    // USB 3.0 pipe throughput of the XEM6310
+    double wireLatencyUs = 40.0;        // Per UpdateWireIns/UpdateWireOuts/trigger
+    double fpgaNsPerByte = 10.0;        // HALO pipeline processing time
+    size_t fifoBytes = 16384;           // Output FIFO depth; older responses are lost beyond it
+};
+
+struct FrontPanelEmulatorStats {
+    uint64_t pipeInTransfers = 0;
+    uint64_t pipeOutTransfers = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t overflowBytes = 0;         // Responses dropped because the FIFO was full
+    uint64_t underflowBytes = 0;        // Pipe-out bytes read with no response behind them
+    uint64_t blocksProcessed = 0;
+    uint64_t detections = 0;
+};
+
+class FrontPanelEmulator : public FrontPanelDevice {
+public:
+    explicit FrontPanelEmulator(const FrontPanelEmulatorConfig& config = FrontPanelEmulatorConfig());
+
+    int OpenBySerial(const std::string& serial) override;
+    int ConfigureFPGA(const std::string& bitfilePath) override;
+
+    int SetWireInValue(int ep, uint32_t value, uint32_t mask) override;
+    int UpdateWireIns() override;
+    int UpdateWireOuts() override;
+    uint32_t GetWireOutValue(int ep) override;
+    int ActivateTriggerIn(int ep, int bit) override;
+
+    long WriteToPipeIn(int ep, long length, const uint8_t* data) override;
+    long ReadFromPipeOut(int ep, long length, uint8_t* data) override;
+
+    FrontPanelEmulatorStats stats() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct PendingBytes {
+        Clock::time_point readyAt;
+        std::vector<uint8_t> bytes;
+        size_t consumed;
+    };
+
+    // Occupy the shared bus for costUs after any transfer already on it
+    Clock::time_point occupyBus(double costUs);
+    void processBlock(const uint8_t* data, size_t length, std::vector<uint8_t>& response);
+
+    FrontPanelEmulatorConfig config_;
+    mutable std::mutex mutex_;
+    bool open_;
+    bool configured_;
+    Clock::time_point busFreeAt_;
+    uint32_t wireInStaged_[32];
+    uint32_t wireIn_[32];
+    uint32_t wireOutLive_[32];          // 0x20-0x3F, as driven by the "FPGA"
+    uint32_t wireOut_[32];              // Snapshot taken by UpdateWireOuts
+    std::deque<PendingBytes> outputFifo_;
+    size_t outputFifoBytes_;
+    HaloReferenceModel model_;          // Filter state carries across blocks
+    FrontPanelEmulatorStats stats_;
+};
+
+#endif // FRONTPANEL_EMULATOR_H
@@ -0,0 +1,142 @@
+#include "response_queue.h"
+#include <algorithm>
+
+namespace {
+// Upper bound on a missed wake-up: notifications are sent without the mutex
+constexpr auto kWaitSlice = std::chrono::milliseconds(1);
+} // namespace
+
+ResponseQueue::ResponseQueue(size_t capacity, size_t maxRecordBytes, OverflowPolicy policy)
+    : capacity_(std::max<size_t>(1, capacity)), maxRecordBytes_(maxRecordBytes), policy_(policy),
+      slots_(new ResponseRecord[capacity_]), writeIndex_(0), readIndex_(0), closed_(false), pushed_(0), popped_(0), dropped_(0), blocked_(0),
+      maxDepth_(0) {
+    for (size_t i = 0; i < capacity_; ++i) {
+        slots_[i].response.reserve(maxRecordBytes);
+        slots_[i].original.reserve(maxRecordBytes);
+    }
+}
+
+bool ResponseQueue::push(const uint8_t* response, size_t responseLength, const std::vector<uint8_t>& original,
+                         const LatencyTrace& trace) {
+    const uint64_t w = writeIndex_.load(std::memory_order_relaxed);
+    // Held from the drop until the overwritten slot is published
+    std::unique_lock<std::mutex> dropLock(waitMutex_, std::defer_lock);
+    bool waited = false;
+    for (;;) {
+        uint64_t r = readIndex_.load(std::memory_order_acquire);
+        if (w - r < capacity_) {
+            break;
+        }
+        if (policy_ == OverflowPolicy::DropOldest) {
+            // Slot w is slot r: take the oldest record away from the consumer
+            // while it cannot be copying it. If it popped the record before
+            // the lock was ours, there is room now anyway.
+            dropLock.lock();
+            r = readIndex_.load(std::memory_order_relaxed);
+            if (w - r >= capacity_) {
+                readIndex_.store(r + 1, std::memory_order_release);
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
+        }
+        if (closed_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        if (!waited) {
+            blocked_.fetch_add(1, std::memory_order_relaxed);
+            waited = true;
+        }
+        std::unique_lock<std::mutex> lock(waitMutex_);
+        notFull_.wait_for(lock, kWaitSlice);
+    }
+
+    // Clamped to the reserved size: a reallocation here could free memory
+    // the consumer is still copying from
+    ResponseRecord& slot = slots_[w % capacity_];
+    slot.response.assign(response, response + std::min(responseLength, maxRecordBytes_));
+    slot.original.assign(original.begin(), original.begin() + std::min(original.size(), maxRecordBytes_));
+    slot.trace = trace;
+    writeIndex_.store(w + 1, std::memory_order_release);
+    if (dropLock.owns_lock()) {
+        dropLock.unlock();
+    }
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+
+    size_t depth = static_cast<size_t>(w + 1 - readIndex_.load(std::memory_order_relaxed));
+    if (depth > maxDepth_.load(std::memory_order_relaxed)) {
+        maxDepth_.store(depth, std::memory_order_relaxed);
+    }
+    notEmpty_.notify_one();
+    return true;
+}
+
+bool ResponseQueue::pop(ResponseRecord& out) {
+    for (;;) {
+        uint64_t r = readIndex_.load(std::memory_order_acquire);
+        if (r == writeIndex_.load(std::memory_order_acquire)) {
+            if (closed_.load(std::memory_order_acquire)) {
+                // A push may have landed between the two loads above
+                if (r == writeIndex_.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(waitMutex_);
+            notEmpty_.wait_for(lock, kWaitSlice);
+            continue;
+        }
+
+        // Under DropOldest the producer drops records under the lock, so
+        // the record is re-checked once the lock is held
+        std::unique_lock<std::mutex> copyLock(waitMutex_, std::defer_lock);
+        if (policy_ == OverflowPolicy::DropOldest) {
+            copyLock.lock();
+            if (readIndex_.load(std::memory_order_relaxed) != r) {
+                continue;  // Dropped meanwhile; move on to the next one
+            }
+        }
+        const ResponseRecord& slot = slots_[r % capacity_];
+        out.response.assign(slot.response.begin(), slot.response.end());
+        out.original.assign(slot.original.begin(), slot.original.end());
+        out.trace = slot.trace;
+        readIndex_.store(r + 1, std::memory_order_release);
+        if (copyLock.owns_lock()) {
+            copyLock.unlock();
+        }
+        popped_.fetch_add(1, std::memory_order_relaxed);
+        if (policy_ == OverflowPolicy::Block) {
+            notFull_.notify_one();
+        }
+        return true;
+    }
+}
+
+void ResponseQueue::close() {
+    closed_.store(true, std::memory_order_release);
+    notEmpty_.notify_all();
+    notFull_.notify_all();
+}
+
+size_t ResponseQueue::depth() const {
+    uint64_t r = readIndex_.load(std::memory_order_acquire);
+    uint64_t w = writeIndex_.load(std::memory_order_acquire);
+    return static_cast<size_t>(w - std::min(r, w));
+}
+
+ResponseQueueStats ResponseQueue::stats(bool reset) {
+    ResponseQueueStats s;
+    if (reset) {
+        s.pushed = pushed_.exchange(0, std::memory_order_relaxed);
+        s.popped = popped_.exchange(0, std::memory_order_relaxed);
+        s.dropped = dropped_.exchange(0, std::memory_order_relaxed);
+        s.blocked = blocked_.exchange(0, std::memory_order_relaxed);
+        s.maxDepth = maxDepth_.exchange(depth(), std::memory_order_relaxed);
+    } else {
+        s.pushed = pushed_.load(std::memory_order_relaxed);
+        s.popped = popped_.load(std::memory_order_relaxed);
+        s.dropped = dropped_.load(std::memory_order_relaxed);
+        s.blocked = blocked_.load(std::memory_order_relaxed);
+        s.maxDepth = maxDepth_.load(std::memory_order_relaxed);
+    }
+    return s;
+}
@@ -0,0 +1,88 @@
+#ifndef RESPONSE_QUEUE_H
+#define RESPONSE_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../intan-reader/latency_tracker.h"
+
+// One FPGA response waiting to be decoded and written to disk
+struct ResponseRecord {
+    std::vector<uint8_t> response;  // Response bytes for this frame
+    std::vector<uint8_t> original;  // Waveform that was sent to the FPGA
+    LatencyTrace trace;
+};
+
+// What push() does when the logging thread has fallen capacity records behind
+enum class OverflowPolicy {
+    DropOldest,  // Overwrite the oldest unlogged response; push never waits
+    Block        // Wait for the logging thread (back-pressure to the FPGA reader)
+};
+
+struct ResponseQueueStats {
+    uint64_t pushed = 0;
+    uint64_t popped = 0;
+    uint64_t dropped = 0;   // Oldest records overwritten (DropOldest)
+    uint64_t blocked = 0;   // Pushes that had to wait (Block)
+    size_t maxDepth = 0;    // Deepest the queue got
+};
+
+// Single-producer single-consumer ring of preallocated records between the
+// AsicSender reader thread and its logging thread. Each slot reserves
+// maxRecordBytes for the response and the original, so push() and pop() copy
+// into existing storage and never allocate (longer inputs are truncated).
+//
+// Under DropOldest a full queue makes the producer advance the read index
+// itself and overwrite the slot the consumer would read next. That drop and
+// overwrite, and the consumer's copy of a slot, both hold waitMutex_, so the
+// two never touch the same record at once. The lock is only taken by the
+// producer when the queue is full; Block needs no lock on either side, as the
+// producer never writes a slot the consumer can be reading.
+class ResponseQueue {
+public:
+    ResponseQueue(size_t capacity, size_t maxRecordBytes, OverflowPolicy policy);
+
+    // Producer. False only under Block when the queue was closed while waiting
+    bool push(const uint8_t* response, size_t responseLength, const std::vector<uint8_t>& original,
+              const LatencyTrace& trace);
+
+    // Consumer. Waits for the next record; false once the queue is closed and empty
+    bool pop(ResponseRecord& out);
+
+    // No more pushes; pop() drains what is left, then returns false
+    void close();
+
+    size_t capacity() const { return capacity_; }
+    OverflowPolicy policy() const { return policy_; }
+    size_t depth() const;
+
+    // Counters since the last reset (maxDepth restarts from the current depth)
+    ResponseQueueStats stats(bool reset);
+
+private:
+    const size_t capacity_;
+    const size_t maxRecordBytes_;
+    const OverflowPolicy policy_;
+    std::unique_ptr<ResponseRecord[]> slots_;
+    std::atomic<uint64_t> writeIndex_;
+    std::atomic<uint64_t> readIndex_;
+    std::atomic<bool> closed_;
+
+    std::atomic<uint64_t> pushed_;
+    std::atomic<uint64_t> popped_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> blocked_;
+    std::atomic<size_t> maxDepth_;
+
+    // For sleeping, and under DropOldest for dropping/copying a record
+    std::mutex waitMutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+};
+
+#endif // RESPONSE_QUEUE_H
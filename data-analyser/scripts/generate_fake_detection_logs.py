@@ -5,6 +5,8 @@ import random
 from datetime import datetime, timezone, timedelta
 from pathlib import Path
 
+from time_index import day_start_ns, write_time_index
+
 # Bit layout (little-endian uint32 per event):
 # bits 0-1 : type (0b10 start, 0b01 end, 0b00 idle-not-logged)
 # bits 2-6 : channel id (1-32)
@@ -33,11 +35,14 @@ def generate_events(pairs: int, rng: random.Random, start_ticks: int = 0):
     return events
 
 
-def write_events(path: Path, events):
+def write_events(path: Path, events, base_ns=None):
     path.parent.mkdir(parents=True, exist_ok=True)
     with path.open("wb") as f:
         for ev in events:
             f.write(struct.pack("<I", ev))
+    # Sidecar time index; ticks are ms from base_ns (the day's midnight)
+    if base_ns is not None:
+        write_time_index(path, [(base_ns + (ev >> 7) * 1_000_000, i * 4) for i, ev in enumerate(events)])
     print(f"Wrote {len(events)} events to {path}")
 
 
@@ -75,7 +80,7 @@ def main():
         for hour in hours:
             out_path = day_dir / f"hour_{hour:02d}_detections.bin"
             events = generate_events(args.pairs, rng)
-            write_events(out_path, events)
+            write_events(out_path, events, day_start_ns(out_path))
 
 
 if __name__ == "__main__":
@@ -6,6 +6,8 @@ import struct
 import sys
 import math
 
+from time_index import day_start_ns, write_time_index
+
 # Reuse Intan-style synthetic generator from fpga/halo_seizure/shared/synthetic.py
 ROOT = Path(__file__).resolve().parents[2]
 SYNTH_PATH = ROOT / "fpga" / "halo_seizure" / "shared"
@@ -107,17 +109,21 @@ def generate_hour(raw_path: Path, det_path: Path, duration_sec: int, seed_offset
             f.write(struct.pack("<" + "I" * SAMPLES_PER_RECORD, *ts_block))
             f.write(struct.pack("<" + "H" * (CHANNELS * SAMPLES_PER_RECORD), *wave))
 
-    # Convert seizures to packed events (timestamps are local to this hour)
+    # Convert seizures to packed events (timestamps are local to this hour),
+    # in time order so the sidecar index can be searched
     events = []
     for start_ms, end_ms, ch in seizures:
         if 0 <= start_ms < duration_sec * 1000:
             events.append(((start_ms & 0x1FFFFFF) << 7) | ((ch & 0x1F) << 2) | TYPE_START)
         if 0 <= end_ms < duration_sec * 1000:
             events.append(((end_ms & 0x1FFFFFF) << 7) | ((ch & 0x1F) << 2) | TYPE_END)
+    events.sort(key=lambda ev: ev >> 7)
 
     with det_path.open("wb") as f:
         for ev in events:
             f.write(struct.pack("<I", ev))
+    base_ns = day_start_ns(det_path)
+    write_time_index(det_path, [(base_ns + (ev >> 7) * 1_000_000, i * 4) for i, ev in enumerate(events)])
 
 
 def main():
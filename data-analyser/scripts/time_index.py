@@ -0,0 +1,38 @@
+import struct
+from datetime import datetime, timezone
+from pathlib import Path
+
+# Sparse time index sidecar (<log>.idx); layout mirrors src/core/log_time_index.h
+INDEX_MAGIC = b"HALOIDX\x00"
+INDEX_VERSION = 1
+
+
+def day_start_ns(log_path: Path) -> int:
+    """Midnight UTC of the log's YYYY-MM-DD directory, as the GUI reads detection ticks."""
+    day = datetime.strptime(log_path.parent.name, "%Y-%m-%d").replace(tzinfo=timezone.utc)
+    return int(day.timestamp()) * 1_000_000_000
+
+
+def write_time_index(log_path: Path, records, stride: int = 256):
+    """
+    Write <log_path>.idx for a log whose records are (time_ns, byte offset)
+    pairs in time order: one entry per `stride` records plus the min/max time.
+    """
+    records = list(records)
+    entries = records[::stride]
+    times = [t for t, _ in records]
+    with Path(str(log_path) + ".idx").open("wb") as f:
+        f.write(
+            struct.pack(
+                "<8sHHIQQQ",
+                INDEX_MAGIC,
+                INDEX_VERSION,
+                0,  # reserved
+                stride,
+                len(records),
+                min(times, default=0),
+                max(times, default=0),
+            )
+        )
+        for time_ns, offset in entries:
+            f.write(struct.pack("<QQ", time_ns, offset))
@@ -1,21 +1,37 @@
 #include "fpga_logger.h"
 #include "hdf5_writer.h"
+#include "hourly_hdf5_sink.h"
 #include <iostream>
-#include <filesystem>
 #include <cstdlib>
-#include <iomanip>
 #include <chrono>
-#include <sstream>
+#include <algorithm>
 
-FpgaLogger::FpgaLogger() : responseCount_(0) {
-    // Create logs directory for today
-    std::string current_date = getDateString();
-    std::string date_dir = "data-analyser/logs/" + current_date;
-    std::filesystem::create_directories(date_dir);
+namespace {
+// Samples per frame on the ASIC shared-memory channel; lanes = bytes / this
+constexpr size_t kSamplesPerFrame = 128;
+constexpr int kShadowReportInterval = 500;
+} // namespace
+
+FpgaLogger::FpgaLogger()
+    : responseCount_(0), hdf5Failing_(false), shadowFrames_(0), shadowMismatchedFrames_(0), shadowMismatchedBytes_(0) {
+    // Set up header info for FPGA response data
+    IntanHeaderInfo info;
+    info.magic = 0x464741; // "FGA" magic number
+    info.streamCount = 1;
+    info.channelCount = 36; // 32 neural channels + 4 metadata channels
+    info.sampleRate = 1000; // 1 kHz
+
+    // Shuffle + deflate keeps both datasets (the metadata channels need the
+    // float values) at about a third of their raw size;
+    // bench_hdf5_compression compares the options.
+    Hdf5WriterOptions options;
+    options.codesCompression.filter = Hdf5Filter::ShuffleDeflate;
+    options.uvCompression.filter = Hdf5Filter::ShuffleDeflate;
+    sink_ = std::make_unique<HourlyHdf5Sink>("data-analyser/logs", info, options);
 }
 
 FpgaLogger::~FpgaLogger() {
-    // HDF5 writers will be automatically closed when unique_ptr goes out of scope
+    // The sink closes the current hour's file and any still being finalized
 }
 
 void FpgaLogger::analyzeFpgaData(const std::vector<uint8_t>& fpgaData, const std::vector<uint8_t>& originalData) {
@@ -27,35 +43,65 @@ void FpgaLogger::analyzeFpgaData(const std::vector<uint8_t>& fpgaData, const std
     HaloResponse response = decoder_.decodeResponse(fpgaData);
     responseCount_++;
     
+    // Cross-check the GATE output against the CPU model of the same frame
+    if (!originalData.empty()) {
+        runReferenceModel(originalData);
+        size_t mismatched = referenceModel_.mismatchedBytes(fpgaData.data(), fpgaData.size());
+        shadowFrames_++;
+        shadowMismatchedFrames_ += mismatched ? 1 : 0;
+        shadowMismatchedBytes_ += mismatched;
+        if (responseCount_ % kShadowReportInterval == 0) {
+            std::cout << "[FPGA] reference check (" << referenceModel_.kernelName() << "): "
+                      << shadowMismatchedFrames_ << "/" << shadowFrames_ << " frames differ, "
+                      << shadowMismatchedBytes_ << " bytes" << std::endl;
+        }
+    }
+    
     // Log FPGA response to HDF5 (all responses, not just seizures)
     logFpgaResponseToHdf5(response, fpgaData, originalData);
 }
 
+void FpgaLogger::analyzeOnCpu(const std::vector<uint8_t>& originalData) {
+    if (originalData.empty()) {
+        return;
+    }
+
+    const HaloReferenceResult& result = runReferenceModel(originalData);
+    HaloResponse response = decoder_.decodeResponse(result.gated);
+    responseCount_++;
+    
+    // The model knows the detection outcome; the decoder only sees the gated bytes
+    response.type = result.detected ? HaloResponseType::SEIZURE_DETECTED : HaloResponseType::NORMAL_ACTIVITY;
+    response.confidence = static_cast<double>(result.firingChannels) / referenceModel_.lanes();
+    
+    logFpgaResponseToHdf5(response, result.gated, originalData);
+}
+
+const HaloReferenceResult& FpgaLogger::runReferenceModel(const std::vector<uint8_t>& originalData) {
+    size_t lanes = std::max<size_t>(1, originalData.size() / kSamplesPerFrame);
+    if (lanes != referenceModel_.lanes()) {
+        referenceModel_.configure(lanes, referenceModel_.samplesAhead());
+    }
+    return referenceModel_.process(originalData.data(), originalData.size());
+}
+
 void FpgaLogger::setHaloPipeline(HaloPipeline pipeline) {
     decoder_.setPipeline(pipeline);
 }
 
 void FpgaLogger::setThresholds(double lowThreshold, double highThreshold) {
     decoder_.setThresholds(lowThreshold, highThreshold);
+    referenceModel_.setThresholds(lowThreshold, highThreshold);
 }
 
 
 void FpgaLogger::logFpgaResponseToHdf5(const HaloResponse& response, const std::vector<uint8_t>& processedData, const std::vector<uint8_t>& originalData) {
-    // Get current hour
-    int currentHour = getCurrentHour();
-    
-    // Create hourly writer if it doesn't exist
-    createHourlyWriter(currentHour);
-    
-    // Get the writer for this hour
-    auto it = hourlyWriters_.find(currentHour);
-    if (it == hourlyWriters_.end()) {
-        std::cerr << "[ERROR] No HDF5 writer available for hour " << currentHour << std::endl;
+    // Writer for the current UTC hour; the sink rotates at the boundary
+    Hdf5Writer* writer = sink_->writerFor(std::chrono::system_clock::now());
+    if (!writer) {
         return;
     }
     
-    Hdf5Writer* writer = it->second.get();
-    
     // Prepare data for all 32 channels + 4 metadata channels = 36 total
     std::vector<uint16_t> codes(36, 0);
     std::vector<float> microvolts(36, 0.0f);
@@ -90,63 +136,15 @@ void FpgaLogger::logFpgaResponseToHdf5(const HaloResponse& response, const std::
     codes[35] = static_cast<uint16_t>(response.activity_level * 1000);
     microvolts[35] = response.activity_level;
     
-    // Append to HDF5 file
-    writer->appendFrame(codes, microvolts);
-}
-
-void FpgaLogger::createHourlyWriter(int hour) {
-    // Check if writer already exists for this hour
-    if (hourlyWriters_.find(hour) != hourlyWriters_.end()) {
-        return; // Already exists
+    // Append to HDF5 file. A failed write drops its batch; say so once per
+    // run of failures rather than for every frame
+    bool ok = writer->appendFrame(codes, microvolts);
+    if (!ok && !hdf5Failing_) {
+        std::cerr << "[ERROR] HDF5 write failed; " << writer->droppedFrames()
+                  << " frames dropped from the current hour so far" << std::endl;
+    } else if (ok && hdf5Failing_) {
+        std::cerr << "[WARN] HDF5 writes recovered; " << writer->droppedFrames()
+                  << " frames dropped from the current hour" << std::endl;
     }
-    
-    // Create HDF5 file for this hour
-    std::string current_date = getDateString();
-    std::string date_dir = "data-analyser/logs/" + current_date;
-    std::filesystem::create_directories(date_dir);
-    
-    std::ostringstream filename;
-    filename << date_dir << "/hour_" << std::setfill('0') << std::setw(2) << hour << ".h5";
-    
-    // Create HDF5 writer for this hour
-    auto writer = std::make_unique<Hdf5Writer>();
-    
-    // Set up header info for FPGA response data
-    IntanHeaderInfo info;
-    info.magic = 0x464741; // "FGA" magic number
-    info.streamCount = 1;
-    info.channelCount = 36; // 32 neural channels + 4 metadata channels
-    info.sampleRate = 1000; // 1 kHz
-    
-    if (writer->open(filename.str(), info)) {
-        hourlyWriters_[hour] = std::move(writer);
-        // HDF5 file creation logging removed for long-term stability
-    } else {
-        std::cerr << "[ERROR] Failed to create HDF5 file for hour " << hour << std::endl;
-    }
-}
-
-std::string FpgaLogger::getDateString() const {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    
-    std::ostringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d");
-    return ss.str();
-}
-
-std::string FpgaLogger::getHourString() const {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    
-    std::ostringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%H");
-    return ss.str();
-}
-
-int FpgaLogger::getCurrentHour() const {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto tm = *std::localtime(&time_t);
-    return tm.tm_hour;
+    hdf5Failing_ = !ok;
 }
@@ -4,23 +4,34 @@
 #include <vector>
 #include <string>
 #include <memory>
-#include <map>
 
 #include "halo_response_decoder.h"
+#include "halo_reference_model.h"
 
 class FpgaLogger {
 private:
     HaloResponseDecoder decoder_;
-    std::map<int, std::unique_ptr<class Hdf5Writer>> hourlyWriters_; // hour -> writer
+    std::unique_ptr<class HourlyHdf5Sink> sink_; // hour_HH.h5 per UTC hour
     int responseCount_;
+    bool hdf5Failing_; // Last append failed; reported once per failure run
+    
+    // Shadow of pipeline 6, fed the same frames as the FPGA
+    HaloReferenceModel referenceModel_;
+    uint64_t shadowFrames_;
+    uint64_t shadowMismatchedFrames_;
+    uint64_t shadowMismatchedBytes_;
     
 public:
     FpgaLogger();
     ~FpgaLogger();
     
-    // Analyze FPGA response data with HALO decoding
+    // Analyze FPGA response data with HALO decoding, cross-checked bit for
+    // bit against the reference model
     void analyzeFpgaData(const std::vector<uint8_t>& fpgaData, const std::vector<uint8_t>& originalData);
     
+    // Run pipeline 6 on the CPU instead, for when the ASIC is not available
+    void analyzeOnCpu(const std::vector<uint8_t>& originalData);
+    
     // Set HALO pipeline configuration
     void setHaloPipeline(HaloPipeline pipeline);
     
@@ -28,11 +39,8 @@ public:
     void setThresholds(double lowThreshold, double highThreshold);
     
 private:
+    const HaloReferenceResult& runReferenceModel(const std::vector<uint8_t>& originalData);
     void logFpgaResponseToHdf5(const HaloResponse& response, const std::vector<uint8_t>& processedData, const std::vector<uint8_t>& originalData);
-    void createHourlyWriter(int hour);
-    std::string getDateString() const;
-    std::string getHourString() const;
-    int getCurrentHour() const;
 };
 
 #endif // FPGA_LOGGER_H
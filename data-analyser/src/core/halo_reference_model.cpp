@@ -0,0 +1,236 @@
+#include "halo_reference_model.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HALO_MODEL_X86 1
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HALO_MODEL_NEON 1
+#endif
+
+namespace {
+constexpr uint8_t kMidScale = 128;   // Flat history before the first frame
+constexpr int kMaxSamplesAhead = 64;
+
+// ---------------------------------------------------------------------------
+// Scalar reference
+// ---------------------------------------------------------------------------
+void neoRowScalar(const uint8_t* before, const uint8_t* centre, const uint8_t* after, size_t lanes,
+                  int32_t thrLow, int32_t thrHigh, int32_t* peak, uint8_t* fired, uint8_t* gated) {
+    for (size_t l = 0; l < lanes; ++l) {
+        int32_t x = centre[l];
+        int32_t psi = x * x - static_cast<int32_t>(before[l]) * static_cast<int32_t>(after[l]);
+        bool pass = thrLow <= psi && psi <= thrHigh;
+        peak[l] = std::max(peak[l], psi);
+        fired[l] |= pass ? 1 : 0;
+        gated[l] = pass ? centre[l] : 0;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: 8 lanes per step in 32-bit arithmetic, selected only if the CPU
+// reports AVX2 at runtime
+// ---------------------------------------------------------------------------
+#if defined(HALO_MODEL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define HALO_MODEL_AVX2 1
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET void neoRowAvx2(const uint8_t* before, const uint8_t* centre, const uint8_t* after, size_t lanes,
+                            int32_t thrLow, int32_t thrHigh, int32_t* peak, uint8_t* fired, uint8_t* gated) {
+    const __m256i lo = _mm256_set1_epi32(thrLow);
+    const __m256i hi = _mm256_set1_epi32(thrHigh);
+    const __m128i one = _mm_set1_epi8(1);
+    size_t l = 0;
+    for (; l + 8 <= lanes; l += 8) {
+        __m128i c8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(centre + l));
+        __m256i c = _mm256_cvtepu8_epi32(c8);
+        __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(before + l)));
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(after + l)));
+        __m256i psi = _mm256_sub_epi32(_mm256_mullo_epi32(c, c), _mm256_mullo_epi32(b, a));
+
+        // pass = !(lo > psi) && !(psi > hi)
+        __m256i fail = _mm256_or_si256(_mm256_cmpgt_epi32(lo, psi), _mm256_cmpgt_epi32(psi, hi));
+        __m128i fail16 = _mm_packs_epi32(_mm256_castsi256_si128(fail), _mm256_extracti128_si256(fail, 1));
+        __m128i pass8 = _mm_andnot_si128(_mm_packs_epi16(fail16, fail16), _mm_set1_epi8(-1));
+
+        __m256i* peakOut = reinterpret_cast<__m256i*>(peak + l);
+        _mm256_storeu_si256(peakOut, _mm256_max_epi32(_mm256_loadu_si256(peakOut), psi));
+        __m128i f = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(fired + l));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(fired + l), _mm_or_si128(f, _mm_and_si128(pass8, one)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(gated + l), _mm_and_si128(c8, pass8));
+    }
+    neoRowScalar(before + l, centre + l, after + l, lanes - l, thrLow, thrHigh, peak + l, fired + l, gated + l);
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// NEON: 8 lanes per step in 32-bit arithmetic
+// ---------------------------------------------------------------------------
+#if defined(HALO_MODEL_NEON)
+void neoRowNeon(const uint8_t* before, const uint8_t* centre, const uint8_t* after, size_t lanes,
+                int32_t thrLow, int32_t thrHigh, int32_t* peak, uint8_t* fired, uint8_t* gated) {
+    const int32x4_t lo = vdupq_n_s32(thrLow);
+    const int32x4_t hi = vdupq_n_s32(thrHigh);
+    const uint8x8_t one = vdup_n_u8(1);
+    size_t l = 0;
+    for (; l + 8 <= lanes; l += 8) {
+        uint8x8_t c8 = vld1_u8(centre + l);
+        uint16x8_t c16 = vmovl_u8(c8);
+        uint16x8_t b16 = vmovl_u8(vld1_u8(before + l));
+        uint16x8_t a16 = vmovl_u8(vld1_u8(after + l));
+        int32x4_t cLo = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(c16)));
+        int32x4_t cHi = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(c16)));
+        int32x4_t bLo = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(b16)));
+        int32x4_t bHi = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(b16)));
+        int32x4_t aLo = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(a16)));
+        int32x4_t aHi = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(a16)));
+        int32x4_t psiLo = vsubq_s32(vmulq_s32(cLo, cLo), vmulq_s32(bLo, aLo));
+        int32x4_t psiHi = vsubq_s32(vmulq_s32(cHi, cHi), vmulq_s32(bHi, aHi));
+
+        uint32x4_t passLo = vandq_u32(vcgeq_s32(psiLo, lo), vcleq_s32(psiLo, hi));
+        uint32x4_t passHi = vandq_u32(vcgeq_s32(psiHi, lo), vcleq_s32(psiHi, hi));
+        uint8x8_t pass8 = vmovn_u16(vcombine_u16(vmovn_u32(passLo), vmovn_u32(passHi)));
+
+        vst1q_s32(peak + l, vmaxq_s32(vld1q_s32(peak + l), psiLo));
+        vst1q_s32(peak + l + 4, vmaxq_s32(vld1q_s32(peak + l + 4), psiHi));
+        vst1_u8(fired + l, vorr_u8(vld1_u8(fired + l), vand_u8(pass8, one)));
+        vst1_u8(gated + l, vand_u8(c8, pass8));
+    }
+    neoRowScalar(before + l, centre + l, after + l, lanes - l, thrLow, thrHigh, peak + l, fired + l, gated + l);
+}
+#endif
+
+HaloReferenceModel::RowKernel kernelFor(HaloKernelIsa isa) {
+    switch (isa) {
+        case HaloKernelIsa::Scalar:
+            return neoRowScalar;
+        case HaloKernelIsa::AVX2:
+#if defined(HALO_MODEL_AVX2)
+            return __builtin_cpu_supports("avx2") ? neoRowAvx2 : nullptr;
+#else
+            return nullptr;
+#endif
+        case HaloKernelIsa::NEON:
+#if defined(HALO_MODEL_NEON)
+            return neoRowNeon;
+#else
+            return nullptr;
+#endif
+    }
+    return nullptr;
+}
+} // namespace
+
+HaloReferenceModel::HaloReferenceModel()
+    : lanes_(0), samplesAhead_(1), thrLow_(0), thrHigh_(INT32_MAX), seizureChannels_(0),
+      isa_(HaloKernelIsa::Scalar), kernel_(neoRowScalar) {
+    // Widest kernel this CPU supports
+    for (HaloKernelIsa isa : {HaloKernelIsa::AVX2, HaloKernelIsa::NEON}) {
+        if (useKernel(isa)) {
+            break;
+        }
+    }
+    setThresholds(0.3, 0.7);
+    configure(32);
+}
+
+bool HaloReferenceModel::configure(size_t lanes, int samplesAhead) {
+    if (lanes == 0 || samplesAhead < 1 || samplesAhead > kMaxSamplesAhead) {
+        return false;
+    }
+    lanes_ = lanes;
+    samplesAhead_ = samplesAhead;
+    result_.channelPeak.assign(lanes_, 0);
+    result_.channelFired.assign(lanes_, 0);
+    reset();
+    return true;
+}
+
+void HaloReferenceModel::reset() {
+    work_.assign(2 * samplesAhead_ * lanes_, kMidScale);
+    result_.detected = false;
+    result_.firingChannels = 0;
+    result_.gated.clear();
+}
+
+void HaloReferenceModel::setThresholds(double lowThreshold, double highThreshold) {
+    // Same conversions as AsicSender::setThresholds
+    setNeoThreshold(static_cast<uint16_t>(lowThreshold * 65535));
+    setSeizureChannels(static_cast<uint8_t>(highThreshold * 32));
+}
+
+void HaloReferenceModel::setNeoThreshold(int32_t thrLow, int32_t thrHigh) {
+    thrLow_ = thrLow;
+    thrHigh_ = thrHigh;
+}
+
+void HaloReferenceModel::setSeizureChannels(uint32_t channels) {
+    seizureChannels_ = channels;
+}
+
+const HaloReferenceResult& HaloReferenceModel::process(const uint8_t* frame, size_t bytes) {
+    const size_t rows = bytes / lanes_;
+    const size_t k = static_cast<size_t>(samplesAhead_);
+    const size_t historyBytes = 2 * k * lanes_;
+
+    // work_ = [2k history rows][frame rows]
+    work_.resize(historyBytes + rows * lanes_);
+    std::memcpy(work_.data() + historyBytes, frame, rows * lanes_);
+
+    result_.gated.resize(rows * lanes_);
+    std::fill(result_.channelPeak.begin(), result_.channelPeak.end(), INT32_MIN);
+    std::fill(result_.channelFired.begin(), result_.channelFired.end(), 0);
+
+    // Output row r is psi of work row r + k, which needs rows r and r + 2k
+    const uint8_t* base = work_.data();
+    for (size_t r = 0; r < rows; ++r) {
+        kernel_(base + r * lanes_, base + (r + k) * lanes_, base + (r + 2 * k) * lanes_, lanes_,
+                thrLow_, thrHigh_, result_.channelPeak.data(), result_.channelFired.data(),
+                result_.gated.data() + r * lanes_);
+    }
+
+    // Keep the newest 2k rows for the next frame
+    std::memmove(work_.data(), work_.data() + rows * lanes_, historyBytes);
+    work_.resize(historyBytes);
+
+    uint32_t firing = 0;
+    for (uint8_t f : result_.channelFired) {
+        firing += f;
+    }
+    result_.firingChannels = firing;
+    result_.detected = rows > 0 && firing >= seizureChannels_;
+    return result_;
+}
+
+size_t HaloReferenceModel::mismatchedBytes(const uint8_t* response, size_t bytes) const {
+    const std::vector<uint8_t>& gated = result_.gated;
+    size_t compared = std::min(bytes, gated.size());
+    size_t mismatches = std::max(bytes, gated.size()) - compared;
+    for (size_t i = 0; i < compared; ++i) {
+        mismatches += response[i] != gated[i] ? 1 : 0;
+    }
+    return mismatches;
+}
+
+bool HaloReferenceModel::useKernel(HaloKernelIsa isa) {
+    RowKernel kernel = kernelFor(isa);
+    if (!kernel) {
+        return false;
+    }
+    isa_ = isa;
+    kernel_ = kernel;
+    return true;
+}
+
+const char* HaloReferenceModel::kernelName() const {
+    switch (isa_) {
+        case HaloKernelIsa::Scalar: return "scalar";
+        case HaloKernelIsa::AVX2: return "avx2";
+        case HaloKernelIsa::NEON: return "neon";
+    }
+    return "unknown";
+}
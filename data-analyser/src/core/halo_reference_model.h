@@ -0,0 +1,86 @@
+#ifndef HALO_REFERENCE_MODEL_H
+#define HALO_REFERENCE_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU model of HALO pipeline 6: ADC_b -> NEO -> THR -> GATE, ADC_a -> GATE.
+//
+//   NEO   psi[n] = x[n]^2 - x[n-k] * x[n+k] per channel (SCALO doc 6.1.2),
+//         on the unsigned 8-bit samples the ASIC receives
+//   THR   pass = thrLow <= psi <= thrHigh (SCALO doc 6.2.2)
+//   GATE  forwards the raw sample when THR passes and drops (zeroes) it
+//         otherwise (SCALO doc 6.7.1); the frame is flagged as a seizure when
+//         at least seizureChannels lanes passed THR at least once
+//
+// Frames are [sample][lane] bytes, as AsicSender sends them. All lanes of a
+// row are processed together by a SIMD row kernel picked for the running CPU;
+// every kernel uses integer arithmetic only, so they agree bit for bit. The
+// output is delayed by k samples (psi[n] needs x[n+k]), and filter state
+// carries over between frames.
+
+enum class HaloKernelIsa {
+    Scalar,
+    AVX2,
+    NEON
+};
+
+struct HaloReferenceResult {
+    bool detected = false;
+    uint32_t firingChannels = 0;
+    std::vector<uint8_t> gated;         // GATE output, same layout and size as the input rows
+    std::vector<int32_t> channelPeak;   // Largest psi per lane in this frame
+    std::vector<uint8_t> channelFired;  // 1 if the lane passed THR in this frame
+
+    // ep30wire encoding: timestamp[29:0] << 2 | valid << 1 | detected
+    uint32_t haloOuts(uint32_t timestamp) const {
+        return ((timestamp & 0x3FFFFFFF) << 2) | 0x02 | (detected ? 0x01 : 0x00);
+    }
+};
+
+class HaloReferenceModel {
+public:
+    HaloReferenceModel();
+
+    // lanes = channels per row (32 per RHD2132 stream), samplesAhead = NEO k
+    bool configure(size_t lanes, int samplesAhead = 1);
+    void reset();
+
+    // Same mapping as AsicSender::setThresholds: low * 65535 is the NEO
+    // threshold, high * 32 the number of channels that must fire
+    void setThresholds(double lowThreshold, double highThreshold);
+    // Raw register values (ep02[15:0] and ep00[15:8] on the FPGA)
+    void setNeoThreshold(int32_t thrLow, int32_t thrHigh = INT32_MAX);
+    void setSeizureChannels(uint32_t channels);
+
+    // Run one frame; trailing bytes that do not fill a row are ignored
+    const HaloReferenceResult& process(const uint8_t* frame, size_t bytes);
+    const HaloReferenceResult& lastResult() const { return result_; }
+
+    // Bytes of an FPGA response that differ from the last GATE output
+    size_t mismatchedBytes(const uint8_t* response, size_t bytes) const;
+
+    // Row kernel in use; useKernel() returns false if the CPU lacks it
+    bool useKernel(HaloKernelIsa isa);
+    const char* kernelName() const;
+
+    size_t lanes() const { return lanes_; }
+    int samplesAhead() const { return samplesAhead_; }
+
+    typedef void (*RowKernel)(const uint8_t* before, const uint8_t* centre, const uint8_t* after, size_t lanes,
+                              int32_t thrLow, int32_t thrHigh, int32_t* peak, uint8_t* fired, uint8_t* gated);
+
+private:
+    size_t lanes_;
+    int samplesAhead_;
+    int32_t thrLow_;
+    int32_t thrHigh_;
+    uint32_t seizureChannels_;
+    std::vector<uint8_t> work_;         // 2k history rows followed by the current frame
+    HaloReferenceResult result_;
+    HaloKernelIsa isa_;
+    RowKernel kernel_;
+};
+
+#endif // HALO_REFERENCE_MODEL_H
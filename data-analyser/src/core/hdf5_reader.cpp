@@ -4,11 +4,26 @@
 #include <iomanip>
 #include <sstream>
 
-Hdf5Reader::Hdf5Reader() : file_(nullptr), dset_codes_(nullptr), dset_uv_(nullptr) {}
+namespace {
+// Read rows [firstFrame, firstFrame + rows) of a 2D dataset
+herr_t readRows(hid_t dataset, hid_t memType, hsize_t firstFrame, hsize_t rows, hsize_t numSignals, void* buffer) {
+    hid_t fspace = H5Dget_space(dataset);
+    hsize_t start[2] = {firstFrame, 0};
+    hsize_t count[2] = {rows, numSignals};
+    H5Sselect_hyperslab(fspace, H5S_SELECT_SET, start, nullptr, count, nullptr);
+    hid_t mspace = H5Screate_simple(2, count, nullptr);
+    herr_t status = H5Dread(dataset, memType, mspace, fspace, H5P_DEFAULT, buffer);
+    H5Sclose(mspace);
+    H5Sclose(fspace);
+    return status;
+}
+} // namespace
+
+Hdf5Reader::Hdf5Reader() : file_(nullptr), dset_codes_(nullptr), dset_uv_(nullptr), live_(false), nextFrame_(0) {}
 
 Hdf5Reader::~Hdf5Reader() { close(); }
 
-bool Hdf5Reader::open(const std::string& path) {
+bool Hdf5Reader::open(const std::string& path, bool live) {
     close();
     
     if (!std::filesystem::exists(path)) {
@@ -16,7 +31,9 @@ bool Hdf5Reader::open(const std::string& path) {
         return false;
     }
     
-    hid_t file = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    // SWMR read: the writer keeps appending while we read, and refresh()
+    // picks up its new rows without reopening the file
+    hid_t file = H5Fopen(path.c_str(), live ? H5F_ACC_RDONLY | H5F_ACC_SWMR_READ : H5F_ACC_RDONLY, H5P_DEFAULT);
     if (file < 0) {
         std::cerr << "[ERROR] Failed to open HDF5 file: " << path << std::endl;
         return false;
@@ -30,9 +47,22 @@ bool Hdf5Reader::open(const std::string& path) {
         return false;
     }
     
-    hid_t dsetUv = H5Dopen2(file, "/samples_uV", H5P_DEFAULT);
-    if (dsetUv < 0) {
-        std::cerr << "[ERROR] Failed to open samples_uV dataset" << std::endl;
+    // Codes-only files have no /samples_uV; microvolts come from the
+    // uV_scale/uV_offset attributes instead
+    hid_t dsetUv = -1;
+    uvScale_.clear();
+    uvOffset_.clear();
+    if (H5Lexists(file, "/samples_uV", H5P_DEFAULT) > 0) {
+        dsetUv = H5Dopen2(file, "/samples_uV", H5P_DEFAULT);
+        if (dsetUv < 0) {
+            std::cerr << "[ERROR] Failed to open samples_uV dataset" << std::endl;
+            H5Dclose(dsetCodes);
+            H5Fclose(file);
+            return false;
+        }
+    } else if (!readScaleAttribute(dsetCodes, "uV_scale", uvScale_) ||
+               !readScaleAttribute(dsetCodes, "uV_offset", uvOffset_)) {
+        std::cerr << "[ERROR] No samples_uV dataset and no uV_scale/uV_offset attributes" << std::endl;
         H5Dclose(dsetCodes);
         H5Fclose(file);
         return false;
@@ -40,7 +70,9 @@ bool Hdf5Reader::open(const std::string& path) {
     
     file_ = reinterpret_cast<void*>(static_cast<intptr_t>(file));
     dset_codes_ = reinterpret_cast<void*>(static_cast<intptr_t>(dsetCodes));
-    dset_uv_ = reinterpret_cast<void*>(static_cast<intptr_t>(dsetUv));
+    dset_uv_ = dsetUv >= 0 ? reinterpret_cast<void*>(static_cast<intptr_t>(dsetUv)) : nullptr;
+    live_ = live;
+    nextFrame_ = 0;
     
     return true;
 }
@@ -89,13 +121,45 @@ bool Hdf5Reader::readHeader(IntanHeaderInfo& info) {
     return success;
 }
 
+size_t Hdf5Reader::refresh() {
+    if (!file_ || !dset_codes_) return 0;
+    hid_t dsetC = static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_codes_));
+    if (live_) {
+        // Reload the dataset metadata the writer last flushed
+        H5Drefresh(dsetC);
+        if (dset_uv_) {
+            H5Drefresh(static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_uv_)));
+        }
+    }
+    return frameCount();
+}
+
+size_t Hdf5Reader::frameCount() const {
+    if (!file_ || !dset_codes_) return 0;
+    hid_t spaceC = H5Dget_space(static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_codes_)));
+    hsize_t dims[2] = {0, 0};
+    if (H5Sget_simple_extent_ndims(spaceC) == 2) {
+        H5Sget_simple_extent_dims(spaceC, dims, nullptr);
+    }
+    H5Sclose(spaceC);
+    return static_cast<size_t>(dims[0]);
+}
+
 std::vector<SeizureDetectionData> Hdf5Reader::readSeizureDetections() {
+    return readDetections(0);
+}
+
+std::vector<SeizureDetectionData> Hdf5Reader::readNewDetections() {
+    refresh();
+    return readDetections(nextFrame_);
+}
+
+std::vector<SeizureDetectionData> Hdf5Reader::readDetections(size_t firstFrame) {
     std::vector<SeizureDetectionData> detections;
     
-    if (!file_ || !dset_codes_ || !dset_uv_) return detections;
+    if (!file_ || !dset_codes_) return detections;
     
     hid_t dsetC = static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_codes_));
-    hid_t dsetU = static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_uv_));
     
     // Get dataset dimensions
     hid_t spaceC = H5Dget_space(dsetC);
@@ -110,19 +174,18 @@ std::vector<SeizureDetectionData> Hdf5Reader::readSeizureDetections() {
     H5Sget_simple_extent_dims(spaceC, dims, nullptr);
     H5Sclose(spaceC);
     
-    hsize_t numFrames = dims[0];
     hsize_t numSignals = dims[1];
+    if (dims[0] <= firstFrame) return detections;
+    hsize_t numFrames = dims[0] - firstFrame;
     
-    if (numFrames == 0) return detections;
-    
-    // Read all data at once
+    // Read all requested rows at once
     std::vector<uint16_t> codes(numFrames * numSignals);
     std::vector<float> microvolts(numFrames * numSignals);
     
-    herr_t status1 = H5Dread(dsetC, H5T_NATIVE_UINT16, H5S_ALL, H5S_ALL, H5P_DEFAULT, codes.data());
-    herr_t status2 = H5Dread(dsetU, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, microvolts.data());
+    herr_t status1 = readRows(dsetC, H5T_NATIVE_UINT16, firstFrame, numFrames, numSignals, codes.data());
+    bool status2 = status1 >= 0 && readMicrovolts(firstFrame, numFrames, numSignals, codes, microvolts);
     
-    if (status1 < 0 || status2 < 0) {
+    if (status1 < 0 || !status2) {
         std::cerr << "[ERROR] Failed to read HDF5 data" << std::endl;
         return detections;
     }
@@ -202,7 +265,7 @@ std::vector<SeizureDetectionData> Hdf5Reader::readSeizureDetections() {
         }
         
         // Generate timestamp based on file creation time and frame index
-        detection.timestamp = extractTimestampFromFrame(frame);
+        detection.timestamp = extractTimestampFromFrame(static_cast<int>(firstFrame + frame));
         
         // Determine response type based on confidence and activity level
         detection.responseType = responseTypeToString(detection.confidence, detection.activityLevel);
@@ -215,6 +278,7 @@ std::vector<SeizureDetectionData> Hdf5Reader::readSeizureDetections() {
         
         detections.push_back(detection);
     }
+    nextFrame_ = firstFrame + numFrames;
     
     return detections;
 }
@@ -245,12 +309,11 @@ std::string Hdf5Reader::responseTypeToString(double confidence, double activityL
 std::vector<float> Hdf5Reader::readChannelData(int channelIndex) {
     std::vector<float> channelData;
     
-    if (!file_ || !dset_codes_ || !dset_uv_ || channelIndex < 0 || channelIndex >= 32) {
+    if (!file_ || !dset_codes_ || channelIndex < 0 || channelIndex >= 32) {
         return channelData;
     }
     
     hid_t dsetC = static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_codes_));
-    hid_t dsetU = static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_uv_));
     
     // Get dataset dimensions
     hid_t spaceC = H5Dget_space(dsetC);
@@ -267,9 +330,14 @@ std::vector<float> Hdf5Reader::readChannelData(int channelIndex) {
     
     // Read all data
     std::vector<float> microvolts(numFrames * numSignals);
-    herr_t status = H5Dread(dsetU, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, microvolts.data());
+    std::vector<uint16_t> codes;
+    if (!dset_uv_) {
+        codes.resize(numFrames * numSignals);
+    }
+    bool status = (dset_uv_ || H5Dread(dsetC, H5T_NATIVE_UINT16, H5S_ALL, H5S_ALL, H5P_DEFAULT, codes.data()) >= 0) &&
+                  readMicrovolts(0, numFrames, numSignals, codes, microvolts);
     
-    if (status < 0) {
+    if (!status) {
         std::cerr << "[ERROR] Failed to read channel data from HDF5" << std::endl;
         return channelData;
     }
@@ -283,3 +351,32 @@ std::vector<float> Hdf5Reader::readChannelData(int channelIndex) {
     
     return channelData;
 }
+
+bool Hdf5Reader::readMicrovolts(size_t firstFrame, size_t numFrames, size_t numSignals,
+                                const std::vector<uint16_t>& codes, std::vector<float>& microvolts) {
+    if (dset_uv_) {
+        hid_t dsetU = static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_uv_));
+        return readRows(dsetU, H5T_NATIVE_FLOAT, firstFrame, numFrames, numSignals, microvolts.data()) >= 0;
+    }
+    if (uvScale_.size() != numSignals || uvOffset_.size() != numSignals || codes.size() != microvolts.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < codes.size(); ++i) {
+        size_t signal = i % numSignals;
+        microvolts[i] = codes[i] * uvScale_[signal] + uvOffset_[signal];
+    }
+    return true;
+}
+
+bool Hdf5Reader::readScaleAttribute(hid_t dataset, const char* name, std::vector<float>& values) {
+    if (H5Aexists(dataset, name) <= 0) return false;
+    hid_t attr = H5Aopen(dataset, name, H5P_DEFAULT);
+    if (attr < 0) return false;
+    hid_t space = H5Aget_space(attr);
+    hssize_t count = H5Sget_simple_extent_npoints(space);
+    H5Sclose(space);
+    values.resize(count > 0 ? static_cast<size_t>(count) : 0);
+    herr_t status = values.empty() ? -1 : H5Aread(attr, H5T_NATIVE_FLOAT, values.data());
+    H5Aclose(attr);
+    return status >= 0;
+}
@@ -29,8 +29,9 @@ public:
     Hdf5Reader();
     ~Hdf5Reader();
     
-    // Open HDF5 file for reading
-    bool open(const std::string& path);
+    // Open HDF5 file for reading. live = SWMR read of a file a writer still
+    // has open (Hdf5WriterOptions::swmr); call refresh() to see its new rows.
+    bool open(const std::string& path, bool live = false);
     
     // Close the file
     void close();
@@ -41,6 +42,14 @@ public:
     // Read all seizure detection data from the file
     std::vector<SeizureDetectionData> readSeizureDetections();
     
+    // Detections for rows appended since the last read (refreshes live files
+    // first), so a tailing reader only decodes new rows
+    std::vector<SeizureDetectionData> readNewDetections();
+    
+    // Live files: reload the extent the writer last flushed. Returns frameCount()
+    size_t refresh();
+    size_t frameCount() const;
+    
     // Read data for a specific channel (0-31)
     std::vector<float> readChannelData(int channelIndex);
     
@@ -50,9 +59,17 @@ public:
 private:
     void* file_;  // hid_t file handle
     void* dset_codes_;  // hid_t dataset handle for codes
-    void* dset_uv_;     // hid_t dataset handle for microvolts
+    void* dset_uv_;     // hid_t dataset handle for microvolts (null in codes-only files)
+    std::vector<float> uvScale_;   // Codes-only files: microvolts = code * scale + offset
+    std::vector<float> uvOffset_;
+    bool live_;
+    size_t nextFrame_;  // First row not yet returned by readSeizureDetections/readNewDetections
     
     // Helper functions
+    std::vector<SeizureDetectionData> readDetections(size_t firstFrame);
+    bool readMicrovolts(size_t firstFrame, size_t numFrames, size_t numSignals,
+                        const std::vector<uint16_t>& codes, std::vector<float>& microvolts);
+    static bool readScaleAttribute(hid_t dataset, const char* name, std::vector<float>& values);
     std::chrono::system_clock::time_point extractTimestampFromFrame(int frameIndex) const;
     std::string responseTypeToString(double confidence, double activityLevel) const;
 };
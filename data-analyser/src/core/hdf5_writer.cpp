@@ -1,8 +1,71 @@
 #include "hdf5_writer.h"
 #include <hdf5.h>
+#include <algorithm>
 #include <filesystem>
+#include <iostream>
+#include <mutex>
 
-Hdf5Writer::Hdf5Writer() : file_(nullptr), dset_codes_(nullptr), dset_uv_(nullptr), space_codes_(nullptr), space_uv_(nullptr), frameIndex_(0) {}
+namespace {
+// The HDF5 library is not thread-safe unless built with --enable-threadsafe
+// (Homebrew's is not), so every writer serialises its library calls here.
+// Appends that only fill the buffer never take it. Lock order: a writer's
+// bufferMutex_, then this.
+std::mutex& hdf5Mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+// Registered HDF5 filter id of the LZ4 plugin (hdf5_plugins / hdf5plugin)
+constexpr H5Z_filter_t kLz4FilterId = 32004;
+
+// Add the filter pipeline to a dataset creation list; returns what was applied
+Hdf5Filter applyCompression(hid_t plist, const Hdf5Compression& compression, const char* dataset) {
+    Hdf5Filter filter = compression.filter;
+    if (filter == Hdf5Filter::Lz4 && H5Zfilter_avail(kLz4FilterId) <= 0) {
+        std::cerr << "[WARN] LZ4 HDF5 filter not available (check HDF5_PLUGIN_PATH); using shuffle+deflate for "
+                  << dataset << std::endl;
+        filter = Hdf5Filter::ShuffleDeflate;
+    }
+    if (filter == Hdf5Filter::ShuffleDeflate && H5Zfilter_avail(H5Z_FILTER_DEFLATE) <= 0) {
+        std::cerr << "[WARN] HDF5 built without deflate; " << dataset << " is stored uncompressed" << std::endl;
+        filter = Hdf5Filter::None;
+    }
+
+    switch (filter) {
+        case Hdf5Filter::None:
+            break;
+        case Hdf5Filter::ShuffleDeflate:
+            // Shuffle groups the high and low bytes of each sample, which
+            // change at very different rates, before zlib sees them
+            H5Pset_shuffle(plist);
+            H5Pset_deflate(plist, static_cast<unsigned>(std::max(1, std::min(compression.deflateLevel, 9))));
+            break;
+        case Hdf5Filter::Lz4:
+            H5Pset_shuffle(plist);
+            // Optional: a chunk LZ4 cannot shrink is stored as is
+            H5Pset_filter(plist, kLz4FilterId, H5Z_FLAG_OPTIONAL, 0, nullptr);
+            break;
+    }
+    return filter;
+}
+
+// One value per signal from a per-signal list, a single broadcast value, or a default
+std::vector<float> expandPerSignal(const std::vector<float>& values, size_t numSignals, float fallback) {
+    if (values.size() == numSignals) {
+        return values;
+    }
+    return std::vector<float>(numSignals, values.empty() ? fallback : values[0]);
+}
+} // namespace
+
+Hdf5Writer::Hdf5Writer(const Hdf5WriterOptions& options)
+    : file_(nullptr), dset_codes_(nullptr), dset_uv_(nullptr), space_codes_(nullptr), space_uv_(nullptr),
+      options_(options), codesFilter_(Hdf5Filter::None), uvFilter_(Hdf5Filter::None), frameIndex_(0),
+      bufferedRows_(0), droppedFrames_(0) {
+    if (options_.chunkRows == 0) {
+        options_.chunkRows = 1;
+    }
+}
 
 Hdf5Writer::~Hdf5Writer() { close(); }
 
@@ -10,10 +73,16 @@ bool Hdf5Writer::open(const std::string& path, const IntanHeaderInfo& info) {
     close();
     info_ = info;
     std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    std::lock_guard<std::mutex> bufferLock(bufferMutex_);
+    std::lock_guard<std::mutex> lock(hdf5Mutex());
 
     // Create file access property list with SWMR (Single Writer Multiple Reader) mode
     hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
     H5Pset_fclose_degree(fapl, H5F_CLOSE_STRONG); // Force close to prevent locking issues
+    if (options_.swmr) {
+        // SWMR needs the 1.10 file format (version 2 B-trees and chunk indexes)
+        H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+    }
     
     hid_t file = H5Fcreate(path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
     H5Pclose(fapl);
@@ -27,24 +96,36 @@ bool Hdf5Writer::open(const std::string& path, const IntanHeaderInfo& info) {
 
     // Chunking for append
     hid_t plist = H5Pcreate(H5P_DATASET_CREATE);
-    hsize_t chunk[2] = {1024, numSignals};
+    hsize_t chunk[2] = {options_.chunkRows, numSignals};
     H5Pset_chunk(plist, 2, chunk);
+    codesFilter_ = applyCompression(plist, options_.codesCompression, "/samples_codes");
+
+    // Chunk cache, large enough to hold the chunk being filled in each dataset
+    hid_t dapl = H5Pcreate(H5P_DATASET_ACCESS);
+    H5Pset_chunk_cache(dapl, options_.chunkCacheSlots, options_.chunkCacheBytes, 1.0);
 
     // Datatype: native little-endian uint16
     hid_t type = H5Tcopy(H5T_NATIVE_UINT16);
 
-    hid_t dsetCodes = H5Dcreate2(file, "/samples_codes", type, space, H5P_DEFAULT, plist, H5P_DEFAULT);
+    hid_t dsetCodes = H5Dcreate2(file, "/samples_codes", type, space, H5P_DEFAULT, plist, dapl);
     H5Pclose(plist);
-    if (dsetCodes < 0) { H5Sclose(space); H5Fclose(file); return false; }
+    if (dsetCodes < 0) { H5Pclose(dapl); H5Sclose(space); H5Fclose(file); return false; }
 
-    // Second dataset: microvolts as float32
-    hid_t space2 = H5Screate_simple(2, dims, maxdims);
-    hid_t plist2 = H5Pcreate(H5P_DATASET_CREATE);
-    H5Pset_chunk(plist2, 2, chunk);
-    hid_t floatType = H5Tcopy(H5T_NATIVE_FLOAT);
-    hid_t dsetUv = H5Dcreate2(file, "/samples_uV", floatType, space2, H5P_DEFAULT, plist2, H5P_DEFAULT);
-    H5Pclose(plist2);
-    if (dsetUv < 0) { H5Sclose(space2); H5Sclose(space); H5Dclose(dsetCodes); H5Fclose(file); return false; }
+    // Second dataset: microvolts as float32 (skipped for codes-only files)
+    hid_t space2 = -1;
+    hid_t dsetUv = -1;
+    uvFilter_ = Hdf5Filter::None;
+    if (options_.storeMicrovolts) {
+        space2 = H5Screate_simple(2, dims, maxdims);
+        hid_t plist2 = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_chunk(plist2, 2, chunk);
+        uvFilter_ = applyCompression(plist2, options_.uvCompression, "/samples_uV");
+        hid_t floatType = H5Tcopy(H5T_NATIVE_FLOAT);
+        dsetUv = H5Dcreate2(file, "/samples_uV", floatType, space2, H5P_DEFAULT, plist2, dapl);
+        H5Pclose(plist2);
+        if (dsetUv < 0) { H5Pclose(dapl); H5Sclose(space2); H5Sclose(space); H5Dclose(dsetCodes); H5Fclose(file); return false; }
+    }
+    H5Pclose(dapl);
 
     // Attributes: metadata
     auto write_attr_u32 = [&](hid_t target, const char* name, uint32_t value){
@@ -54,23 +135,52 @@ bool Hdf5Writer::open(const std::string& path, const IntanHeaderInfo& info) {
         H5Awrite(attr, atype, &value);
         H5Aclose(attr); H5Sclose(aspace); H5Tclose(atype);
     };
+    auto write_attr_f32_array = [&](hid_t target, const char* name, const std::vector<float>& values){
+        hsize_t length = values.size();
+        hid_t aspace = H5Screate_simple(1, &length, nullptr);
+        hid_t attr = H5Acreate2(target, name, H5T_NATIVE_FLOAT, aspace, H5P_DEFAULT, H5P_DEFAULT);
+        H5Awrite(attr, H5T_NATIVE_FLOAT, values.data());
+        H5Aclose(attr); H5Sclose(aspace);
+    };
     write_attr_u32(dsetCodes, "streamCount", info.streamCount);
     write_attr_u32(dsetCodes, "channelCount", info.channelCount);
     write_attr_u32(dsetCodes, "sampleRate", info.sampleRate);
-    write_attr_u32(dsetUv, "streamCount", info.streamCount);
-    write_attr_u32(dsetUv, "channelCount", info.channelCount);
-    write_attr_u32(dsetUv, "sampleRate", info.sampleRate);
+    if (!options_.storeMicrovolts || !options_.uvScale.empty() || !options_.uvOffset.empty()) {
+        // microvolts = code * uV_scale + uV_offset, per signal
+        write_attr_f32_array(dsetCodes, "uV_scale", expandPerSignal(options_.uvScale, numSignals, 1.0f));
+        write_attr_f32_array(dsetCodes, "uV_offset", expandPerSignal(options_.uvOffset, numSignals, 0.0f));
+    }
+    if (dsetUv >= 0) {
+        write_attr_u32(dsetUv, "streamCount", info.streamCount);
+        write_attr_u32(dsetUv, "channelCount", info.channelCount);
+        write_attr_u32(dsetUv, "sampleRate", info.sampleRate);
+    }
+
+    // Everything structural (datasets, attributes) must exist before SWMR
+    // starts; from here on the file only grows along the frame axis
+    if (options_.swmr && H5Fstart_swmr_write(file) < 0) {
+        std::cerr << "[WARN] H5Fstart_swmr_write failed; " << path << " cannot be read until closed" << std::endl;
+    }
 
     file_ = reinterpret_cast<void*>(static_cast<intptr_t>(file));
     dset_codes_ = reinterpret_cast<void*>(static_cast<intptr_t>(dsetCodes));
-    dset_uv_ = reinterpret_cast<void*>(static_cast<intptr_t>(dsetUv));
+    dset_uv_ = dsetUv >= 0 ? reinterpret_cast<void*>(static_cast<intptr_t>(dsetUv)) : nullptr;
     space_codes_ = reinterpret_cast<void*>(static_cast<intptr_t>(space));
-    space_uv_ = reinterpret_cast<void*>(static_cast<intptr_t>(space2));
+    space_uv_ = space2 >= 0 ? reinterpret_cast<void*>(static_cast<intptr_t>(space2)) : nullptr;
     frameIndex_ = 0;
+    bufferedRows_ = 0;
+    droppedFrames_ = 0;
+    codesBuffer_.assign(options_.chunkRows * numSignals, 0);
+    uvBuffer_.assign(options_.storeMicrovolts ? options_.chunkRows * numSignals : 0, 0.0f);
     return true;
 }
 
 void Hdf5Writer::close() {
+    std::lock_guard<std::mutex> bufferLock(bufferMutex_);
+    std::lock_guard<std::mutex> lock(hdf5Mutex());
+    if (file_) {
+        writeBuffered();
+    }
     if (dset_codes_) { 
         H5Dclose(static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_codes_))); 
         dset_codes_ = nullptr; 
@@ -93,48 +203,118 @@ void Hdf5Writer::close() {
         H5Fclose(static_cast<hid_t>(reinterpret_cast<intptr_t>(file_))); 
         file_ = nullptr; 
     }
+    bufferedRows_ = 0;
 }
 
 bool Hdf5Writer::appendFrame(const std::vector<uint16_t>& codes, const std::vector<float>& microvolts) {
-    if (!file_ || !dset_codes_ || !dset_uv_) return false;
+    size_t numSignals = static_cast<size_t>(info_.streamCount) * info_.channelCount;
+    if (codes.size() != numSignals) return false;
+    if (options_.storeMicrovolts && microvolts.size() != numSignals) return false;
+    return appendRow(codes.data(), microvolts.data());
+}
+
+bool Hdf5Writer::appendFrame(const std::vector<uint16_t>& codes) {
+    size_t numSignals = static_cast<size_t>(info_.streamCount) * info_.channelCount;
+    if (options_.storeMicrovolts || codes.size() != numSignals) return false;
+    return appendRow(codes.data(), nullptr);
+}
+
+bool Hdf5Writer::appendRow(const uint16_t* codes, const float* microvolts) {
+    std::lock_guard<std::mutex> bufferLock(bufferMutex_);
+    if (!file_ || !dset_codes_) return false;
+    size_t numSignals = static_cast<size_t>(info_.streamCount) * info_.channelCount;
+    // writeBuffered empties the buffer even when it fails, so it never
+    // stays full; this only keeps a broken invariant from overrunning it
+    if (bufferedRows_ >= options_.chunkRows) return false;
+
+    if (bufferedRows_ == 0) {
+        firstBufferedAt_ = std::chrono::steady_clock::now();
+    }
+    std::copy(codes, codes + numSignals, codesBuffer_.begin() + bufferedRows_ * numSignals);
+    if (dset_uv_) {
+        std::copy(microvolts, microvolts + numSignals, uvBuffer_.begin() + bufferedRows_ * numSignals);
+    }
+    ++bufferedRows_;
+
+    // A full chunk goes out as one extent change and one write per dataset
+    if (bufferedRows_ >= options_.chunkRows ||
+        std::chrono::steady_clock::now() - firstBufferedAt_ >= options_.flushInterval) {
+        std::lock_guard<std::mutex> lock(hdf5Mutex());
+        return writeBuffered();
+    }
+    return true;
+}
+
+bool Hdf5Writer::flush() {
+    std::lock_guard<std::mutex> bufferLock(bufferMutex_);
+    std::lock_guard<std::mutex> lock(hdf5Mutex());
+    return writeBuffered();
+}
+
+bool Hdf5Writer::flushIfDue() {
+    std::lock_guard<std::mutex> bufferLock(bufferMutex_);
+    if (bufferedRows_ == 0 || std::chrono::steady_clock::now() - firstBufferedAt_ < options_.flushInterval) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(hdf5Mutex());
+    return writeBuffered();
+}
+
+bool Hdf5Writer::writeBuffered() {
+    if (!file_ || !dset_codes_) return false;
+    if (bufferedRows_ == 0) return true;
     hsize_t numSignals = static_cast<hsize_t>(info_.streamCount) * info_.channelCount;
-    if (codes.size() != numSignals || microvolts.size() != numSignals) return false;
+    hsize_t rows = bufferedRows_;
+    // A failed write drops the batch rather than keeping it: the buffer
+    // must have room for the next frame. The next batch goes at the same
+    // frame index, so the datasets stay gap-free.
+    auto drop = [&] {
+        droppedFrames_ += bufferedRows_;
+        bufferedRows_ = 0;
+        return false;
+    };
 
-    // Extend dataset by 1 frame
-    hsize_t newdims[2] = {frameIndex_ + 1, numSignals};
+    // Extend the datasets by all buffered frames
+    hsize_t newdims[2] = {frameIndex_ + rows, numSignals};
     hid_t dsetC = static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_codes_));
-    hid_t dsetU = static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_uv_));
-    H5Dset_extent(dsetC, newdims);
-    H5Dset_extent(dsetU, newdims);
+    if (H5Dset_extent(dsetC, newdims) < 0) return drop();
 
-    // Select the hyperslab for the new frame
-    hid_t fspaceC = H5Dget_space(dsetC);
+    // Select the hyperslab for the new frames
     hsize_t start[2] = {frameIndex_, 0};
-    hsize_t count[2] = {1, numSignals};
+    hsize_t count[2] = {rows, numSignals};
+    hid_t mspace = H5Screate_simple(2, count, nullptr);
+
+    hid_t fspaceC = H5Dget_space(dsetC);
     H5Sselect_hyperslab(fspaceC, H5S_SELECT_SET, start, nullptr, count, nullptr);
+    herr_t s1 = H5Dwrite(dsetC, H5T_NATIVE_UINT16, mspace, fspaceC, H5P_DEFAULT, codesBuffer_.data());
+    H5Sclose(fspaceC);
 
-    // Memory space for the frame
-    hsize_t mdims[2] = {1, numSignals};
-    hid_t mspaceC = H5Screate_simple(2, mdims, nullptr);
+    herr_t s2 = 0;
+    if (dset_uv_) {
+        hid_t dsetU = static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_uv_));
+        s2 = H5Dset_extent(dsetU, newdims);
+        if (s2 >= 0) {
+            hid_t fspaceU = H5Dget_space(dsetU);
+            H5Sselect_hyperslab(fspaceU, H5S_SELECT_SET, start, nullptr, count, nullptr);
+            s2 = H5Dwrite(dsetU, H5T_NATIVE_FLOAT, mspace, fspaceU, H5P_DEFAULT, uvBuffer_.data());
+            H5Sclose(fspaceU);
+        }
+    }
+    H5Sclose(mspace);
+    if (s1 < 0 || s2 < 0) return drop();
 
-    // Write
-    herr_t s1 = H5Dwrite(dsetC, H5T_NATIVE_UINT16, mspaceC, fspaceC, H5P_DEFAULT, codes.data());
-    H5Sclose(mspaceC);
-    H5Sclose(fspaceC);
-    if (s1 < 0) return false;
-
-    // UV write
-    hid_t fspaceU = H5Dget_space(dsetU);
-    H5Sselect_hyperslab(fspaceU, H5S_SELECT_SET, start, nullptr, count, nullptr);
-    hid_t mspaceU = H5Screate_simple(2, mdims, nullptr);
-    herr_t s2 = H5Dwrite(dsetU, H5T_NATIVE_FLOAT, mspaceU, fspaceU, H5P_DEFAULT, microvolts.data());
-    H5Sclose(mspaceU);
-    H5Sclose(fspaceU);
-    if (s2 < 0) return false;
-    
-    // Flush after each frame to ensure data is persisted
-    H5Fflush(static_cast<hid_t>(reinterpret_cast<intptr_t>(file_)), H5F_SCOPE_GLOBAL);
-    
-    ++frameIndex_;
+    // Flush once per batch so readers see whole chunks; under SWMR,
+    // H5Dflush publishes the new extent and rows to live readers
+    if (options_.swmr) {
+        H5Dflush(dsetC);
+        if (dset_uv_) {
+            H5Dflush(static_cast<hid_t>(reinterpret_cast<intptr_t>(dset_uv_)));
+        }
+    } else {
+        H5Fflush(static_cast<hid_t>(reinterpret_cast<intptr_t>(file_)), H5F_SCOPE_GLOBAL);
+    }
+
+    frameIndex_ += bufferedRows_;
+    bufferedRows_ = 0;
     return true;
 }
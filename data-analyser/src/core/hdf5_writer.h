@@ -2,6 +2,8 @@
 #define HDF5_WRITER_H
 
 #include <hdf5.h>
+#include <chrono>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -12,31 +14,114 @@ struct IntanHeaderInfo {
     uint32_t sampleRate;
 };
 
+// Filter pipeline for one dataset
+enum class Hdf5Filter {
+    None,
+    ShuffleDeflate,  // Byte shuffle + zlib, built into HDF5
+    Lz4              // Byte shuffle + LZ4 (registered filter 32004, loaded from
+                     // HDF5_PLUGIN_PATH); falls back to ShuffleDeflate if missing
+};
+
+struct Hdf5Compression {
+    Hdf5Filter filter = Hdf5Filter::None;
+    int deflateLevel = 4;  // 1 (fast) to 9 (small), ShuffleDeflate only
+};
+
+struct Hdf5WriterOptions {
+    // Rows per dataset chunk; frames are buffered and written a chunk at a time
+    size_t chunkRows = 1024;
+    // A partial chunk is written once its oldest frame is this old, checked
+    // on append and by flushIfDue()
+    std::chrono::milliseconds flushInterval{1000};
+    // Single-writer/multiple-reader: latest file format plus
+    // H5Fstart_swmr_write, so Hdf5Reader::open(path, true) can tail the file
+    // while it is written. Each flush makes the new rows visible with
+    // H5Dflush. Needs HDF5 1.10+ to read.
+    bool swmr = true;
+    // Raw data chunk cache per dataset (H5Pset_chunk_cache)
+    size_t chunkCacheBytes = 4 * 1024 * 1024;
+    size_t chunkCacheSlots = 521; // Prime, per the HDF5 docs
+
+    Hdf5Compression codesCompression;
+    Hdf5Compression uvCompression;
+
+    // false = codes only: /samples_uV is not created, and readers derive
+    // microvolts as code * uV_scale + uV_offset from the attributes on
+    // /samples_codes (the microvolts passed to appendFrame are ignored)
+    bool storeMicrovolts = true;
+    // Per-signal conversion written as uV_scale/uV_offset; a single value
+    // applies to every signal. Required for codes only, optional otherwise.
+    std::vector<float> uvScale;
+    std::vector<float> uvOffset;
+};
+
 class Hdf5Writer {
 public:
-    Hdf5Writer();
+    explicit Hdf5Writer(const Hdf5WriterOptions& options = Hdf5WriterOptions());
     ~Hdf5Writer();
-    
+
     // Open HDF5 file for writing
     bool open(const std::string& path, const IntanHeaderInfo& info);
-    
-    // Close the file
+
+    // Write any buffered frames, then close the file
     void close();
-    
-    // Append a frame of data
+
+    // Append a frame of data. Frames are buffered and written when a chunk
+    // fills or the flush interval passes. False if the frame was not taken,
+    // or if the write it triggered failed (those frames are dropped, see
+    // droppedFrames)
     bool appendFrame(const std::vector<uint16_t>& codes, const std::vector<float>& microvolts);
-    
+    // Codes-only files
+    bool appendFrame(const std::vector<uint16_t>& codes);
+
+    // Write buffered frames now and flush them to disk (visible to SWMR readers)
+    bool flush();
+    // flush() if the oldest buffered frame is flushInterval old. Safe to call
+    // from another thread than the appends, for a timer that keeps a stalled
+    // stream's partial chunk from waiting for the next frame.
+    bool flushIfDue();
+
     // Check if file is open
     bool isOpen() const { return file_ != nullptr; }
-    
+
+    // Frames appended so far, including those still buffered
+    size_t frameCount() const {
+        std::lock_guard<std::mutex> lock(bufferMutex_);
+        return frameIndex_ + bufferedRows_;
+    }
+    // Frames lost to failed writes (not counted in frameCount)
+    size_t droppedFrames() const {
+        std::lock_guard<std::mutex> lock(bufferMutex_);
+        return droppedFrames_;
+    }
+
+    // Filters actually applied (after any LZ4 fallback)
+    Hdf5Filter codesFilter() const { return codesFilter_; }
+    Hdf5Filter uvFilter() const { return uvFilter_; }
+
 private:
+    bool appendRow(const uint16_t* codes, const float* microvolts);
+    bool writeBuffered();  // flush() body; caller holds bufferMutex_ and the HDF5 lock
+
     void* file_;  // hid_t file handle
     void* dset_codes_;  // hid_t dataset handle for codes
     void* dset_uv_;     // hid_t dataset handle for microvolts
     void* space_codes_; // hid_t dataspace handle for codes
     void* space_uv_;    // hid_t dataspace handle for microvolts
     IntanHeaderInfo info_;
-    size_t frameIndex_;
+    Hdf5WriterOptions options_;
+    Hdf5Filter codesFilter_;
+    Hdf5Filter uvFilter_;
+    size_t frameIndex_;  // Frames already written to the datasets
+
+    // Frames waiting for the next write, row-major. bufferMutex_ guards
+    // them against flushIfDue from a timer thread; taken before the HDF5 lock.
+    mutable std::mutex bufferMutex_;
+    std::vector<uint16_t> codesBuffer_;
+    std::vector<float> uvBuffer_;
+    size_t bufferedRows_;
+    size_t droppedFrames_;
+    std::chrono::steady_clock::time_point firstBufferedAt_;
 };
 
 #endif // HDF5_WRITER_H
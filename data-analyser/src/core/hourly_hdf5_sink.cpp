@@ -0,0 +1,180 @@
+#include "hourly_hdf5_sink.h"
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+constexpr int64_t kSecondsPerHour = 3600;
+
+HourlyHdf5Sink::Clock::time_point hourStart(int64_t key) {
+    return HourlyHdf5Sink::Clock::time_point(std::chrono::seconds(key * kSecondsPerHour));
+}
+} // namespace
+
+HourlyHdf5Sink::HourlyHdf5Sink(const std::string& baseDir, const IntanHeaderInfo& info,
+                               const Hdf5WriterOptions& options, std::chrono::seconds preopenLead)
+    : baseDir_(baseDir), info_(info), options_(options), preopenLead_(preopenLead), rotations_(0),
+      synchronousOpens_(0), live_(nullptr), preopenKey_(-1), openingKey_(-1), stop_(false) {
+    worker_ = std::thread(&HourlyHdf5Sink::workerLoop, this);
+}
+
+HourlyHdf5Sink::~HourlyHdf5Sink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+
+    for (Segment& segment : retired_) {
+        closeSegment(segment);
+    }
+    closeSegment(preopened_);
+    closeSegment(current_);
+}
+
+int64_t HourlyHdf5Sink::hourKey(Clock::time_point time) {
+    int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+    return seconds >= 0 ? seconds / kSecondsPerHour : (seconds - kSecondsPerHour + 1) / kSecondsPerHour;
+}
+
+std::string HourlyHdf5Sink::segmentPath(const std::string& baseDir, int64_t key) {
+    std::time_t start = static_cast<std::time_t>(key * kSecondsPerHour);
+    std::tm utc{};
+    gmtime_r(&start, &utc);
+
+    std::ostringstream path;
+    path << baseDir << "/" << std::put_time(&utc, "%Y-%m-%d") << "/hour_" << std::put_time(&utc, "%H") << ".h5";
+    return path.str();
+}
+
+Hdf5Writer* HourlyHdf5Sink::writerFor(Clock::time_point now) {
+    int64_t key = hourKey(now);
+    // A clock stepped back (NTP) keeps writing to the current hour: opening
+    // an earlier one would truncate a file that is already complete
+    if (current_.writer && current_.key >= key) {
+        return current_.writer.get();
+    }
+
+    Segment next;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // Never open the same file twice: let an open already under way finish
+        opened_.wait(lock, [&] { return openingKey_ != key; });
+        if (preopened_.writer && preopened_.key == key) {
+            next = std::move(preopened_);
+        } else if (preopened_.writer) {
+            // Pre-opened for an hour we skipped (clock jump)
+            retired_.push_back(std::move(preopened_));
+        }
+        preopened_ = Segment();
+        if (current_.writer) {
+            retired_.push_back(std::move(current_));
+            ++rotations_;
+        }
+        live_ = nullptr;
+        preopenKey_ = key + 1;
+    }
+    wake_.notify_one();
+
+    if (!next.writer) {
+        // First segment, or the worker has not got to this hour yet
+        next = openSegment(key);
+        ++synchronousOpens_;
+    }
+    current_ = std::move(next);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_ = current_.writer.get();
+    }
+    return current_.writer.get();
+}
+
+HourlyHdf5Sink::Segment HourlyHdf5Sink::openSegment(int64_t key) const {
+    Segment segment;
+    segment.key = key;
+    segment.path = segmentPath(baseDir_, key);
+    auto writer = std::make_unique<Hdf5Writer>(options_);
+    if (writer->open(segment.path, info_)) {
+        segment.writer = std::move(writer);
+    } else {
+        std::cerr << "[ERROR] Failed to create HDF5 file " << segment.path << std::endl;
+    }
+    return segment;
+}
+
+void HourlyHdf5Sink::closeSegment(Segment& segment) {
+    if (!segment.writer) {
+        return;
+    }
+    bool empty = segment.writer->frameCount() == 0;
+    segment.writer->close();
+    segment.writer.reset();
+    if (empty) {
+        std::error_code ec;
+        std::filesystem::remove(segment.path, ec);
+    }
+}
+
+void HourlyHdf5Sink::workerLoop() {
+    // The writer only checks its flush interval on append
+    const auto flushPeriod = std::max<std::chrono::steady_clock::duration>(
+        options_.flushInterval / 2, std::chrono::milliseconds(1));
+    auto nextFlush = std::chrono::steady_clock::now() + flushPeriod;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (std::chrono::steady_clock::now() >= nextFlush) {
+            nextFlush = std::chrono::steady_clock::now() + flushPeriod;
+            // live_ stays valid while unlocked: once retired, only this
+            // thread closes it
+            if (Hdf5Writer* writer = live_) {
+                lock.unlock();
+                writer->flushIfDue();
+                lock.lock();
+            }
+            continue;
+        }
+
+        if (!retired_.empty()) {
+            std::vector<Segment> retired;
+            retired.swap(retired_);
+            lock.unlock();
+            for (Segment& segment : retired) {
+                closeSegment(segment);
+            }
+            lock.lock();
+            continue;
+        }
+
+        int64_t key = preopenKey_;
+        bool wanted = key >= 0 && preopened_.key != key;
+        Clock::time_point due = hourStart(key) - preopenLead_;
+        if (wanted && Clock::now() >= due) {
+            openingKey_ = key;
+            lock.unlock();
+            Segment segment = openSegment(key);
+            lock.lock();
+            openingKey_ = -1;
+            opened_.notify_all();
+            if (preopenKey_ == key && !stop_) {
+                preopened_ = std::move(segment);
+                preopened_.key = key;  // Also marks a failed open as attempted
+            } else {
+                retired_.push_back(std::move(segment));
+            }
+            continue;
+        }
+
+        auto untilFlush = nextFlush - std::chrono::steady_clock::now();
+        if (wanted) {
+            auto untilDue = std::chrono::duration_cast<std::chrono::steady_clock::duration>(due - Clock::now());
+            wake_.wait_for(lock, std::min(untilDue, untilFlush));
+        } else {
+            wake_.wait_for(lock, untilFlush);
+        }
+    }
+}
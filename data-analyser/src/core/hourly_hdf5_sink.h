@@ -0,0 +1,80 @@
+#ifndef HOURLY_HDF5_SINK_H
+#define HOURLY_HDF5_SINK_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hdf5_writer.h"
+
+// One HDF5 file per UTC hour, <baseDir>/YYYY-MM-DD/hour_HH.h5.
+//
+// Only the current segment is open on the caller's thread. A background
+// thread creates the next hour's file preopenLead before the boundary and
+// closes finished segments, so rotation on the hot path is a pointer swap.
+// A segment that was pre-opened but never written (the process stopped, or
+// the clock jumped) is deleted when it is closed. The same thread calls
+// Hdf5Writer::flushIfDue on the current segment every half flushInterval,
+// so a partial chunk reaches the file even when frames stop arriving.
+class HourlyHdf5Sink {
+public:
+    using Clock = std::chrono::system_clock;
+
+    HourlyHdf5Sink(const std::string& baseDir, const IntanHeaderInfo& info, const Hdf5WriterOptions& options,
+                   std::chrono::seconds preopenLead = std::chrono::seconds(30));
+    ~HourlyHdf5Sink();
+    HourlyHdf5Sink(const HourlyHdf5Sink&) = delete;
+    HourlyHdf5Sink& operator=(const HourlyHdf5Sink&) = delete;
+
+    // Writer for the UTC hour containing now, rotating if that hour is
+    // later than the current one (never back to an earlier hour). nullptr if
+    // the segment could not be created.
+    Hdf5Writer* writerFor(Clock::time_point now);
+
+    // Hours since the Unix epoch, the segment key
+    static int64_t hourKey(Clock::time_point time);
+    static std::string segmentPath(const std::string& baseDir, int64_t key);
+
+    uint64_t rotations() const { return rotations_; }
+    // Rotations that had to create the file on the caller's thread
+    uint64_t synchronousOpens() const { return synchronousOpens_; }
+
+private:
+    struct Segment {
+        int64_t key = -1;
+        std::string path;
+        std::unique_ptr<Hdf5Writer> writer;
+    };
+
+    Segment openSegment(int64_t key) const;
+    static void closeSegment(Segment& segment);
+    void workerLoop();
+
+    const std::string baseDir_;
+    const IntanHeaderInfo info_;
+    const Hdf5WriterOptions options_;
+    const std::chrono::seconds preopenLead_;
+
+    Segment current_;  // Caller's thread only
+    uint64_t rotations_;
+    uint64_t synchronousOpens_;
+
+    // Handed between the caller and the worker under mutex_
+    std::mutex mutex_;
+    std::condition_variable wake_;    // Worker: something to close or pre-open
+    std::condition_variable opened_;  // Caller: the worker finished an open
+    std::vector<Segment> retired_;  // Waiting to be closed
+    Segment preopened_;             // Ready for key preopenKey_
+    Hdf5Writer* live_;              // current_'s writer, for the flush timer
+    int64_t preopenKey_;
+    int64_t openingKey_;            // Being opened by the worker right now
+    bool stop_;
+    std::thread worker_;
+};
+
+#endif // HOURLY_HDF5_SINK_H
@@ -0,0 +1,100 @@
+#include "log_time_index.h"
+#include "raw_io_util.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+namespace {
+static_assert(sizeof(TimeIndexHeader) == 40, "TimeIndexHeader must match the on-disk header");
+static_assert(sizeof(TimeIndexEntry) == 16, "TimeIndexEntry must match the on-disk entry");
+
+bool validHeader(const TimeIndexHeader& header) {
+    const TimeIndexHeader expected;
+    return std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 && header.version == 1 &&
+           header.stride > 0;
+}
+} // namespace
+
+TimeIndexWriter::TimeIndexWriter(uint32_t stride) : fd_(-1), entriesWritten_(0) {
+    header_.stride = std::max<uint32_t>(1, stride);
+}
+
+TimeIndexWriter::~TimeIndexWriter() { close(); }
+
+bool TimeIndexWriter::open(const std::string& path) {
+    close();
+    if (!kHostLittleEndian) return false;
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+    uint32_t stride = header_.stride;
+    header_ = TimeIndexHeader();
+    header_.stride = stride;
+    pending_.clear();
+    entriesWritten_ = 0;
+    return pwriteAll(fd_, &header_, sizeof(header_), 0);
+}
+
+void TimeIndexWriter::add(uint64_t timeNs, uint64_t offset) {
+    if (fd_ < 0) return;
+    if (header_.record_count % header_.stride == 0) {
+        pending_.push_back({timeNs, offset});
+    }
+    if (header_.record_count == 0 || timeNs < header_.min_time_ns) header_.min_time_ns = timeNs;
+    if (header_.record_count == 0 || timeNs > header_.max_time_ns) header_.max_time_ns = timeNs;
+    ++header_.record_count;
+}
+
+bool TimeIndexWriter::flush() {
+    if (fd_ < 0) return false;
+    // Header last, see raw_io_util.h
+    uint64_t offset = sizeof(TimeIndexHeader) + entriesWritten_ * sizeof(TimeIndexEntry);
+    if (!pending_.empty() && !pwriteAll(fd_, pending_.data(), pending_.size() * sizeof(TimeIndexEntry), offset)) {
+        return false;
+    }
+    entriesWritten_ += pending_.size();
+    pending_.clear();
+    return pwriteAll(fd_, &header_, sizeof(header_), 0);
+}
+
+void TimeIndexWriter::close() {
+    if (fd_ >= 0) {
+        flush();
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool TimeIndex::load(const std::string& path) {
+    entries_.clear();
+    if (!kHostLittleEndian) return false;
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    std::streamoff bytes = in.tellg();
+    in.seekg(0);
+    if (bytes < static_cast<std::streamoff>(sizeof(TimeIndexHeader)) ||
+        !in.read(reinterpret_cast<char*>(&header_), sizeof(header_)) || !validHeader(header_)) {
+        return false;
+    }
+    // Only entries the header already covers; a newer tail is ignored
+    uint64_t covered = (header_.record_count + header_.stride - 1) / header_.stride;
+    uint64_t present = static_cast<uint64_t>(bytes - sizeof(TimeIndexHeader)) / sizeof(TimeIndexEntry);
+    entries_.resize(static_cast<size_t>(std::min(covered, present)));
+    if (!in.read(reinterpret_cast<char*>(entries_.data()),
+                 static_cast<std::streamsize>(entries_.size() * sizeof(TimeIndexEntry)))) {
+        entries_.clear();
+        return false;
+    }
+    return true;
+}
+
+size_t TimeIndex::floor(uint64_t timeNs) const {
+    auto it = std::upper_bound(entries_.begin(), entries_.end(), timeNs,
+                               [](uint64_t t, const TimeIndexEntry& e) { return t < e.time_ns; });
+    return it == entries_.begin() ? entries_.size() : static_cast<size_t>(it - entries_.begin()) - 1;
+}
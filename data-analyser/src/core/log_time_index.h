@@ -0,0 +1,90 @@
+// Sparse time index written next to a log as <log path>.idx, so a log can be
+// searched by wall-clock time without scanning it.
+//
+// Used for hour_HH_raw.log (RawLogWriter) and hour_HH_detections.bin (the
+// generators in data-analyser/scripts, time_index.py). Records must be
+// written in time order.
+//
+// Layout (all little-endian):
+// TimeIndexHeader {
+//   char     magic[8]      = "HALOIDX";
+//   uint16_t version        = 1;
+//   uint16_t reserved       = 0;
+//   uint32_t stride;                // log records per entry
+//   uint64_t record_count;          // log records covered by this index
+//   uint64_t min_time_ns;           // over those records
+//   uint64_t max_time_ns;
+// }
+// Repeated TimeIndexEntry {         // one per stride records, from record 0
+//   uint64_t time_ns;               // time of that record
+//   uint64_t offset;                // its byte offset in the log
+// }
+//
+// The header is rewritten as entries are appended, so a log being written
+// has an index that lags it by up to one flush; readers search the part
+// past the last entry in the log itself.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TimeIndexHeader {
+    char magic[8] = {'H','A','L','O','I','D','X',0};
+    uint16_t version = 1;
+    uint16_t reserved = 0;
+    uint32_t stride = 0;
+    uint64_t record_count = 0;
+    uint64_t min_time_ns = 0;
+    uint64_t max_time_ns = 0;
+};
+
+struct TimeIndexEntry {
+    uint64_t time_ns;
+    uint64_t offset;
+};
+
+// Sidecar path for a log
+inline std::string timeIndexPath(const std::string& logPath) { return logPath + ".idx"; }
+
+class TimeIndexWriter {
+public:
+    explicit TimeIndexWriter(uint32_t stride = 64);
+    ~TimeIndexWriter();
+    TimeIndexWriter(const TimeIndexWriter&) = delete;
+    TimeIndexWriter& operator=(const TimeIndexWriter&) = delete;
+
+    // Create (truncate) the index file
+    bool open(const std::string& path);
+    // Call for every log record, in order
+    void add(uint64_t timeNs, uint64_t offset);
+    // Append pending entries and rewrite the header
+    bool flush();
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+
+private:
+    int fd_;
+    TimeIndexHeader header_;
+    std::vector<TimeIndexEntry> pending_;
+    uint64_t entriesWritten_;
+};
+
+class TimeIndex {
+public:
+    // Read a whole index; false if missing or malformed
+    bool load(const std::string& path);
+
+    const TimeIndexHeader& header() const { return header_; }
+    const std::vector<TimeIndexEntry>& entries() const { return entries_; }
+    bool empty() const { return entries_.empty(); }
+
+    // Index of the last entry at or before the time, or entries().size()
+    // if the time precedes the first entry. Binary search.
+    size_t floor(uint64_t timeNs) const;
+
+private:
+    TimeIndexHeader header_;
+    std::vector<TimeIndexEntry> entries_;
+};
@@ -0,0 +1,42 @@
+// Low-level file helpers shared by the raw log writer and the files written
+// next to a log (the .idx time index and the .lodN pyramid levels).
+//
+// The sidecars are rewritten in place while the log grows: each flush
+// pwrites the new data first and then the header whose count covers it.
+// Readers trust only that count, so a crash between the two writes leaves a
+// header that describes only data already on disk.
+
+#ifndef RAW_IO_UTIL_H
+#define RAW_IO_UTIL_H
+
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+// On-disk structs are copied as they are only on a little-endian host.
+// Elsewhere the raw log is encoded field by field and the sidecars are not
+// written; readers then search or decimate the log itself.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+constexpr bool kHostLittleEndian = true;
+#else
+constexpr bool kHostLittleEndian = false;
+#endif
+
+// pwrite the whole range, retrying short writes and EINTR
+inline bool pwriteAll(int fd, const void* data, size_t length, uint64_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t n = ::pwrite(fd, p, length, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        length -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+#endif // RAW_IO_UTIL_H
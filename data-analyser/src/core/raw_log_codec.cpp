@@ -0,0 +1,390 @@
+#include "raw_log_codec.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RAW_LOG_CODEC_X86 1
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RAW_LOG_CODEC_NEON 1
+#endif
+
+namespace {
+constexpr uint32_t kLanes = 8;
+constexpr uint32_t kSteps = kRawLogCodecSamples / kLanes;  // Values per lane
+constexpr size_t kTimestampHeaderBytes = 8;
+constexpr size_t kChannelHeaderBytes = 4;
+
+static_assert(kRawLogCodecSamples % (kLanes * 2) == 0, "Each lane must fill whole 16-bit words");
+
+inline uint16_t load16(const uint8_t* p) {
+    uint16_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t load32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline size_t packedBytes(uint32_t bits) { return size_t(kRawLogCodecSamples) * bits / 8; }
+
+// ---------------------------------------------------------------------------
+// Scalar kernels. These define the format; the SIMD kernels match them byte
+// for byte.
+// ---------------------------------------------------------------------------
+
+uint16_t deltasScalar(const uint16_t* samples, uint16_t* zigzag) {
+    uint16_t any = 0;
+    uint16_t prev = samples[0];
+    for (uint32_t i = 0; i < kRawLogCodecSamples; ++i) {
+        uint16_t delta = static_cast<uint16_t>(samples[i] - prev);
+        prev = samples[i];
+        uint16_t sign = (delta & 0x8000) ? 0xFFFF : 0;
+        zigzag[i] = static_cast<uint16_t>((delta << 1) ^ sign);
+        any |= zigzag[i];
+    }
+    return any;
+}
+
+void packScalar(const uint16_t* zigzag, uint32_t bits, uint8_t* out) {
+    uint16_t* words = reinterpret_cast<uint16_t*>(out);
+    for (uint32_t lane = 0; lane < kLanes; ++lane) {
+        uint32_t acc = 0;
+        uint32_t used = 0;
+        uint32_t word = 0;
+        for (uint32_t step = 0; step < kSteps; ++step) {
+            acc |= uint32_t(zigzag[step * kLanes + lane]) << used;
+            used += bits;
+            if (used >= 16) {
+                uint16_t value = static_cast<uint16_t>(acc);
+                std::memcpy(words + word * kLanes + lane, &value, sizeof(value));
+                ++word;
+                acc >>= 16;
+                used -= 16;
+            }
+        }
+    }
+}
+
+void unpackScalar(const uint8_t* in, uint32_t bits, uint16_t first, uint16_t* samples) {
+    const uint32_t mask = (1u << bits) - 1;
+    uint16_t zigzag[kRawLogCodecSamples];
+    for (uint32_t lane = 0; lane < kLanes; ++lane) {
+        uint32_t acc = 0;
+        uint32_t avail = 0;
+        uint32_t word = 0;
+        for (uint32_t step = 0; step < kSteps; ++step) {
+            if (avail < bits) {
+                acc |= uint32_t(load16(in + (size_t(word) * kLanes + lane) * 2)) << avail;
+                ++word;
+                avail += 16;
+            }
+            zigzag[step * kLanes + lane] = static_cast<uint16_t>(acc & mask);
+            acc >>= bits;
+            avail -= bits;
+        }
+    }
+    uint16_t value = first;
+    for (uint32_t i = 0; i < kRawLogCodecSamples; ++i) {
+        uint16_t z = zigzag[i];
+        uint16_t delta = static_cast<uint16_t>((z >> 1) ^ (0u - (z & 1u)));
+        value = static_cast<uint16_t>(value + delta);
+        samples[i] = value;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// SSE2 kernels (baseline on x86_64)
+// ---------------------------------------------------------------------------
+#if defined(RAW_LOG_CODEC_X86) && defined(__SSE2__)
+
+uint16_t deltasSse2(const uint16_t* samples, uint16_t* zigzag) {
+    __m128i prev = _mm_set1_epi16(static_cast<short>(samples[0]));
+    __m128i any = _mm_setzero_si128();
+    for (uint32_t i = 0; i < kRawLogCodecSamples; i += kLanes) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        // x shifted up one lane, with the previous vector's last sample in lane 0
+        __m128i before = _mm_or_si128(_mm_slli_si128(x, 2), _mm_srli_si128(prev, 14));
+        __m128i delta = _mm_sub_epi16(x, before);
+        __m128i z = _mm_xor_si128(_mm_slli_epi16(delta, 1), _mm_srai_epi16(delta, 15));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(zigzag + i), z);
+        any = _mm_or_si128(any, z);
+        prev = x;
+    }
+    any = _mm_or_si128(any, _mm_srli_si128(any, 8));
+    any = _mm_or_si128(any, _mm_srli_si128(any, 4));
+    any = _mm_or_si128(any, _mm_srli_si128(any, 2));
+    return static_cast<uint16_t>(_mm_cvtsi128_si32(any));
+}
+
+void packSse2(const uint16_t* zigzag, uint32_t bits, uint8_t* out) {
+    __m128i acc = _mm_setzero_si128();
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < kRawLogCodecSamples; i += kLanes) {
+        __m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(zigzag + i));
+        acc = _mm_or_si128(acc, _mm_sll_epi16(z, _mm_cvtsi32_si128(static_cast<int>(used))));
+        used += bits;
+        if (used >= 16) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), acc);
+            out += 16;
+            used -= 16;
+            // The bits of z that did not fit start the next word
+            acc = used ? _mm_srl_epi16(z, _mm_cvtsi32_si128(static_cast<int>(bits - used))) : _mm_setzero_si128();
+        }
+    }
+}
+
+void unpackSse2(const uint8_t* in, uint32_t bits, uint16_t first, uint16_t* samples) {
+    const __m128i mask = _mm_set1_epi16(static_cast<short>((1u << bits) - 1));
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i running = _mm_set1_epi16(static_cast<short>(first));
+    __m128i word = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < kRawLogCodecSamples; i += kLanes) {
+        __m128i z = _mm_srl_epi16(word, _mm_cvtsi32_si128(static_cast<int>(used)));
+        used += bits;
+        if (used >= 16) {
+            used -= 16;
+            if (i + kLanes < kRawLogCodecSamples) {
+                in += 16;
+                word = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+                if (used) z = _mm_or_si128(z, _mm_sll_epi16(word, _mm_cvtsi32_si128(static_cast<int>(bits - used))));
+            }
+        }
+        z = _mm_and_si128(z, mask);
+        __m128i delta = _mm_xor_si128(_mm_srli_epi16(z, 1), _mm_sub_epi16(zero, _mm_and_si128(z, one)));
+        // Prefix sum across the 8 lanes, then carry in the previous total
+        delta = _mm_add_epi16(delta, _mm_slli_si128(delta, 2));
+        delta = _mm_add_epi16(delta, _mm_slli_si128(delta, 4));
+        delta = _mm_add_epi16(delta, _mm_slli_si128(delta, 8));
+        __m128i x = _mm_add_epi16(delta, running);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), x);
+        __m128i last = _mm_shufflehi_epi16(x, 0xFF);
+        running = _mm_unpackhi_epi64(last, last);
+    }
+}
+
+const RawLogCodecKernels kSse2Kernels = {
+    RawLogCodecIsa::SSE2, "sse2",
+    deltasSse2, packSse2, unpackSse2
+};
+#endif
+
+// ---------------------------------------------------------------------------
+// NEON kernels (baseline on arm64, e.g. Apple Silicon)
+// ---------------------------------------------------------------------------
+#if defined(RAW_LOG_CODEC_NEON)
+
+// vshlq_u16 shifts right for negative counts
+inline uint16x8_t shiftLeftNeon(uint16x8_t v, uint32_t count) {
+    return vshlq_u16(v, vdupq_n_s16(static_cast<int16_t>(count)));
+}
+
+inline uint16x8_t shiftRightNeon(uint16x8_t v, uint32_t count) {
+    return vshlq_u16(v, vdupq_n_s16(static_cast<int16_t>(-static_cast<int32_t>(count))));
+}
+
+uint16_t deltasNeon(const uint16_t* samples, uint16_t* zigzag) {
+    uint16x8_t prev = vdupq_n_u16(samples[0]);
+    uint16x8_t any = vdupq_n_u16(0);
+    for (uint32_t i = 0; i < kRawLogCodecSamples; i += kLanes) {
+        uint16x8_t x = vld1q_u16(samples + i);
+        uint16x8_t delta = vsubq_u16(x, vextq_u16(prev, x, 7));
+        uint16x8_t sign = vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(delta), 15));
+        uint16x8_t z = veorq_u16(vshlq_n_u16(delta, 1), sign);
+        vst1q_u16(zigzag + i, z);
+        any = vorrq_u16(any, z);
+        prev = x;
+    }
+    any = vorrq_u16(any, vextq_u16(any, any, 4));
+    any = vorrq_u16(any, vextq_u16(any, any, 2));
+    any = vorrq_u16(any, vextq_u16(any, any, 1));
+    return vgetq_lane_u16(any, 0);
+}
+
+void packNeon(const uint16_t* zigzag, uint32_t bits, uint8_t* out) {
+    uint16_t* words = reinterpret_cast<uint16_t*>(out);
+    uint16x8_t acc = vdupq_n_u16(0);
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < kRawLogCodecSamples; i += kLanes) {
+        uint16x8_t z = vld1q_u16(zigzag + i);
+        acc = vorrq_u16(acc, shiftLeftNeon(z, used));
+        used += bits;
+        if (used >= 16) {
+            vst1q_u16(words, acc);
+            words += kLanes;
+            used -= 16;
+            acc = used ? shiftRightNeon(z, bits - used) : vdupq_n_u16(0);
+        }
+    }
+}
+
+void unpackNeon(const uint8_t* in, uint32_t bits, uint16_t first, uint16_t* samples) {
+    const uint16_t* words = reinterpret_cast<const uint16_t*>(in);
+    const uint16x8_t mask = vdupq_n_u16(static_cast<uint16_t>((1u << bits) - 1));
+    const uint16x8_t one = vdupq_n_u16(1);
+    const uint16x8_t zero = vdupq_n_u16(0);
+    uint16x8_t running = vdupq_n_u16(first);
+    uint16x8_t word = vld1q_u16(words);
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < kRawLogCodecSamples; i += kLanes) {
+        uint16x8_t z = shiftRightNeon(word, used);
+        used += bits;
+        if (used >= 16) {
+            used -= 16;
+            if (i + kLanes < kRawLogCodecSamples) {
+                words += kLanes;
+                word = vld1q_u16(words);
+                if (used) z = vorrq_u16(z, shiftLeftNeon(word, bits - used));
+            }
+        }
+        z = vandq_u16(z, mask);
+        uint16x8_t delta = veorq_u16(vshrq_n_u16(z, 1), vsubq_u16(zero, vandq_u16(z, one)));
+        delta = vaddq_u16(delta, vextq_u16(zero, delta, 7));
+        delta = vaddq_u16(delta, vextq_u16(zero, delta, 6));
+        delta = vaddq_u16(delta, vextq_u16(zero, delta, 4));
+        uint16x8_t x = vaddq_u16(delta, running);
+        vst1q_u16(samples + i, x);
+        running = vdupq_n_u16(vgetq_lane_u16(x, 7));
+    }
+}
+
+const RawLogCodecKernels kNeonKernels = {
+    RawLogCodecIsa::NEON, "neon",
+    deltasNeon, packNeon, unpackNeon
+};
+#endif
+
+const RawLogCodecKernels kScalarKernels = {
+    RawLogCodecIsa::Scalar, "scalar",
+    deltasScalar, packScalar, unpackScalar
+};
+
+const RawLogCodecKernels* selectKernels() {
+    const RawLogCodecKernels* best = &kScalarKernels;
+    for (RawLogCodecIsa isa : {RawLogCodecIsa::SSE2, RawLogCodecIsa::NEON}) {
+        if (const RawLogCodecKernels* k = rawLogCodecKernelsFor(isa)) {
+            best = k;
+        }
+    }
+    return best;
+}
+} // namespace
+
+const RawLogCodecKernels* rawLogCodecKernelsFor(RawLogCodecIsa isa) {
+    switch (isa) {
+        case RawLogCodecIsa::Scalar:
+            return &kScalarKernels;
+        case RawLogCodecIsa::SSE2:
+#if defined(RAW_LOG_CODEC_X86) && defined(__SSE2__)
+            return &kSse2Kernels;
+#else
+            return nullptr;
+#endif
+        case RawLogCodecIsa::NEON:
+#if defined(RAW_LOG_CODEC_NEON)
+            return &kNeonKernels;
+#else
+            return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+const RawLogCodecKernels& rawLogCodecKernels() {
+    static const RawLogCodecKernels* kernels = selectKernels();
+    return *kernels;
+}
+
+size_t rawLogEncodeRecord(const uint32_t* timestamps, const uint16_t* waveform, uint32_t channelCount, uint8_t* out,
+                          const RawLogCodecKernels& kernels) {
+    uint8_t* p = out;
+    uint16_t run = 1;
+    while (run < kRawLogCodecSamples && timestamps[run] == timestamps[0] + run) {
+        ++run;
+    }
+    const uint16_t reserved = 0;
+    std::memcpy(p, &timestamps[0], 4);
+    std::memcpy(p + 4, &run, 2);
+    std::memcpy(p + 6, &reserved, 2);
+    p += kTimestampHeaderBytes;
+    size_t rest = (kRawLogCodecSamples - run) * sizeof(uint32_t);
+    std::memcpy(p, timestamps + run, rest);
+    p += rest;
+
+    alignas(16) uint16_t zigzag[kRawLogCodecSamples];
+    for (uint32_t channel = 0; channel < channelCount; ++channel) {
+        const uint16_t* samples = waveform + size_t(channel) * kRawLogCodecSamples;
+        uint16_t any = kernels.deltas(samples, zigzag);
+        uint8_t bits = 0;
+        while (bits < 16 && (any >> bits) != 0) {
+            ++bits;
+        }
+        std::memcpy(p, &samples[0], 2);
+        p[2] = bits;
+        p[3] = 0;
+        p += kChannelHeaderBytes;
+        if (bits > 0) {
+            kernels.pack(zigzag, bits, p);
+            p += packedBytes(bits);
+        }
+    }
+    return static_cast<size_t>(p - out);
+}
+
+bool rawLogValidatePayload(const uint8_t* payload, size_t bytes, uint32_t channelCount) {
+    if (bytes < kTimestampHeaderBytes) return false;
+    uint16_t run = load16(payload + 4);
+    if (run == 0 || run > kRawLogCodecSamples) return false;
+    size_t offset = kTimestampHeaderBytes + (kRawLogCodecSamples - run) * sizeof(uint32_t);
+    for (uint32_t channel = 0; channel < channelCount; ++channel) {
+        if (offset + kChannelHeaderBytes > bytes) return false;
+        uint8_t bits = payload[offset + 2];
+        if (bits > 16) return false;
+        offset += kChannelHeaderBytes + packedBytes(bits);
+    }
+    return offset == bytes;
+}
+
+void rawLogDecodeTimestamps(const uint8_t* payload, uint32_t* timestamps) {
+    uint32_t first = load32(payload);
+    uint16_t run = load16(payload + 4);
+    for (uint32_t i = 0; i < run; ++i) {
+        timestamps[i] = first + i;
+    }
+    std::memcpy(timestamps + run, payload + kTimestampHeaderBytes, (kRawLogCodecSamples - run) * sizeof(uint32_t));
+}
+
+void rawLogChannelOffsets(const uint8_t* payload, uint32_t channelCount, uint32_t* offsets) {
+    size_t offset = kTimestampHeaderBytes + (kRawLogCodecSamples - load16(payload + 4)) * sizeof(uint32_t);
+    for (uint32_t channel = 0; channel < channelCount; ++channel) {
+        offsets[channel] = static_cast<uint32_t>(offset);
+        offset += kChannelHeaderBytes + packedBytes(payload[offset + 2]);
+    }
+}
+
+void rawLogDecodeChannel(const uint8_t* block, uint16_t* samples, const RawLogCodecKernels& kernels) {
+    uint16_t first = load16(block);
+    uint8_t bits = block[2];
+    if (bits == 0) {
+        std::fill(samples, samples + kRawLogCodecSamples, first);
+    } else {
+        kernels.unpack(block + kChannelHeaderBytes, bits, first, samples);
+    }
+}
+
+void rawLogDecodeRecord(const uint8_t* payload, uint32_t channelCount, uint32_t* timestamps, uint16_t* waveform,
+                        const RawLogCodecKernels& kernels) {
+    rawLogDecodeTimestamps(payload, timestamps);
+    const uint8_t* block = payload + kTimestampHeaderBytes + (kRawLogCodecSamples - load16(payload + 4)) * sizeof(uint32_t);
+    for (uint32_t channel = 0; channel < channelCount; ++channel) {
+        rawLogDecodeChannel(block, waveform + size_t(channel) * kRawLogCodecSamples, kernels);
+        block += kChannelHeaderBytes + packedBytes(block[2]);
+    }
+}
@@ -0,0 +1,91 @@
+// Lossless record codec for HALOLOG v2 (raw_log_format.h).
+//
+// v2 keeps the v1 file header (version = 2) and record header, but the
+// record's payload_bytes now counts a compressed payload:
+//
+//   uint32_t first_timestamp;
+//   uint16_t timestamp_run;         // timestamps[i] = first_timestamp + i for i < run
+//   uint16_t reserved = 0;
+//   uint32_t timestamps[128 - run]; // the rest, as they are (usually none)
+//   Repeated per channel {
+//     uint16_t first_sample;
+//     uint8_t  bits;                // width of each packed value, 0..16
+//     uint8_t  reserved = 0;
+//     uint16_t packed[8 * bits];    // 16 * bits bytes
+//   }
+//
+// A channel's 128 samples become zig-zag deltas, d[0] = 0 and
+// d[i] = zigzag(x[i] - x[i-1]) (mod 2^16, so every input round-trips), packed
+// at the channel's widest delta. The packing is "vertical" over 8 lanes of 16
+// bits: lane l holds d[l], d[l+8], ..., d[l+120], each lane filling its own
+// 16-bit words low bits first, and word k of all lanes is packed[8k .. 8k+7].
+// This lets an SSE2 or NEON register pack or unpack 8 deltas per step with
+// plain shifts; the scalar kernels produce the same bytes.
+//
+// Every field is a multiple of 4 bytes, so records stay 4-byte aligned like
+// v1. All multi-byte fields are little-endian; the SIMD kernels store words as
+// they are, so the codec needs a little-endian host.
+
+#ifndef RAW_LOG_CODEC_H
+#define RAW_LOG_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Samples per channel per record; v2 supports only this record length
+constexpr uint32_t kRawLogCodecSamples = 128;
+
+enum class RawLogCodecIsa {
+    Scalar,
+    SSE2,
+    NEON
+};
+
+// One channel of kRawLogCodecSamples samples. No AVX2 set: the packed layout
+// is 8 lanes of 16 bits with one shift per step, so a 256-bit register has
+// nothing to put in its upper half.
+struct RawLogCodecKernels {
+    RawLogCodecIsa isa;
+    const char* name;
+    // Zig-zag deltas of the samples into zigzag[], returning the OR of all of them
+    uint16_t (*deltas)(const uint16_t* samples, uint16_t* zigzag);
+    // Pack zig-zag deltas at bits (1..16) per value: 16 * bits bytes
+    void (*pack)(const uint16_t* zigzag, uint32_t bits, uint8_t* out);
+    // Unpack, undo the zig-zag and sum the deltas back up from first
+    void (*unpack)(const uint8_t* in, uint32_t bits, uint16_t first, uint16_t* samples);
+};
+
+// Best kernels for the running CPU, picked once on first use
+const RawLogCodecKernels& rawLogCodecKernels();
+
+// Kernels for one instruction set, or nullptr if this CPU/build lacks it
+const RawLogCodecKernels* rawLogCodecKernelsFor(RawLogCodecIsa isa);
+
+// Largest payload for a record of this many channels (every delta 16 bits,
+// no timestamp run)
+constexpr size_t rawLogCodecMaxPayload(uint32_t channelCount) {
+    return 8 + kRawLogCodecSamples * 4 + size_t(channelCount) * (4 + kRawLogCodecSamples * 2);
+}
+
+// Encode 128 timestamps and channelCount * 128 channel-major samples into out
+// (at least rawLogCodecMaxPayload bytes). Returns the payload size.
+size_t rawLogEncodeRecord(const uint32_t* timestamps, const uint16_t* waveform, uint32_t channelCount, uint8_t* out,
+                          const RawLogCodecKernels& kernels = rawLogCodecKernels());
+
+// Check that a payload of this many bytes is well formed for channelCount
+// channels: widths in range and sizes adding up exactly
+bool rawLogValidatePayload(const uint8_t* payload, size_t bytes, uint32_t channelCount);
+
+// Decode a validated payload
+void rawLogDecodeRecord(const uint8_t* payload, uint32_t channelCount, uint32_t* timestamps, uint16_t* waveform,
+                        const RawLogCodecKernels& kernels = rawLogCodecKernels());
+
+// The same in parts, for readers that want only some channels
+void rawLogDecodeTimestamps(const uint8_t* payload, uint32_t* timestamps);
+// Where each channel's block starts in a validated payload
+void rawLogChannelOffsets(const uint8_t* payload, uint32_t channelCount, uint32_t* offsets);
+// One channel from the block at payload + offsets[channel]
+void rawLogDecodeChannel(const uint8_t* block, uint16_t* samples,
+                         const RawLogCodecKernels& kernels = rawLogCodecKernels());
+
+#endif // RAW_LOG_CODEC_H
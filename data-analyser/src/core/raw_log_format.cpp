@@ -1,79 +1,540 @@
 #include "raw_log_format.h"
+#include "raw_log_codec.h"
+#include "raw_log_pyramid.h"
+#include "raw_io_util.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <iostream>
 #include <type_traits>
 
 namespace {
+constexpr size_t kTimestampsPerRecord = 128;
+constexpr size_t kSamplesPerRecord = 32 * 128;
+constexpr size_t kFileHeaderBytes = 28;
+constexpr size_t kRecordBytes = 16 + kTimestampsPerRecord * 4 + kSamplesPerRecord * 2;
+constexpr size_t kMaxCompressedRecordBytes = 16 + rawLogCodecMaxPayload(32);
+constexpr size_t kPageBytes = 4096;
+
+// The structs are packed exactly like the file, so on a little-endian host
+// they can be copied as they are
+static_assert(sizeof(RawLogFileHeader) == kFileHeaderBytes, "RawLogFileHeader must match the on-disk header");
+static_assert(sizeof(RawLogRecordHeader) == 16, "RawLogRecordHeader must match the on-disk record header");
+static_assert(kRecordBytes == 8720, "HALOLOG v1 record size");
+
 // Ensure we always write little-endian regardless of host.
 template <typename T>
-void write_le(std::ofstream& out, T value) {
-    static_assert(std::is_integral_v<T>, "write_le requires integral type");
+uint8_t* put_le(uint8_t* out, T value) {
+    static_assert(std::is_integral_v<T>, "put_le requires integral type");
     for (size_t i = 0; i < sizeof(T); ++i) {
-        uint8_t byte = static_cast<uint8_t>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
-        out.put(static_cast<char>(byte));
+        *out++ = static_cast<uint8_t>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
+    }
+    return out;
+}
+
+template <typename T>
+uint8_t* put_array(uint8_t* out, const T* values, size_t count) {
+    if constexpr (kHostLittleEndian) {
+        std::memcpy(out, values, count * sizeof(T));
+        return out + count * sizeof(T);
     }
+    for (size_t i = 0; i < count; ++i) {
+        out = put_le<T>(out, values[i]);
+    }
+    return out;
+}
+
+uint8_t* put_file_header(uint8_t* out, const RawLogFileHeader& h) {
+    if constexpr (kHostLittleEndian) {
+        std::memcpy(out, &h, sizeof(h));
+        return out + sizeof(h);
+    }
+    std::memcpy(out, h.magic, sizeof(h.magic));
+    out += sizeof(h.magic);
+    out = put_le<uint16_t>(out, h.version);
+    out = put_le<uint16_t>(out, h.reserved);
+    out = put_le<uint32_t>(out, h.channel_count);
+    out = put_le<uint32_t>(out, h.samples_per_record);
+    out = put_le<uint32_t>(out, h.sample_bits);
+    return put_le<uint32_t>(out, h.timestamp_bits);
+}
+
+uint8_t* put_record_header(uint8_t* out, const RawLogRecordHeader& rec) {
+    if constexpr (kHostLittleEndian) {
+        std::memcpy(out, &rec, sizeof(rec));
+        return out + sizeof(rec);
+    }
+    out = put_le<uint64_t>(out, rec.unix_time_ns);
+    out = put_le<uint32_t>(out, rec.sequence_index);
+    return put_le<uint32_t>(out, rec.payload_bytes);
+}
+
+int data_sync(int fd) {
+#ifdef __APPLE__
+    return ::fsync(fd);  // No fdatasync on macOS
+#else
+    return ::fdatasync(fd);
+#endif
 }
 } // namespace
 
-RawLogWriter::RawLogWriter() = default;
-RawLogWriter::~RawLogWriter() { close(); }
+RawLogWriter::RawLogWriter(const RawLogWriterOptions& options)
+    : options_(options), fd_(-1), buffer_(nullptr), bufferCapacity_(0), bufferedBytes_(0), fileOffset_(0), failed_(false), recordsSinceSync_(0),
+      index_(options.indexStride), pyramid_(std::make_unique<RawLogPyramidWriter>()) {
+    // Whole pages, at least one record of either version plus the file header
+    size_t bytes = std::max(options_.bufferBytes, kFileHeaderBytes + std::max(kRecordBytes, kMaxCompressedRecordBytes));
+    bufferCapacity_ = (bytes + kPageBytes - 1) / kPageBytes * kPageBytes;
+}
+
+RawLogWriter::~RawLogWriter() {
+    close();
+    std::free(buffer_);
+}
 
 bool RawLogWriter::open(const std::string& path) {
     close();
+    if (options_.version != 1 && options_.version != 2) {
+        std::cerr << "[ERROR] Unsupported HALOLOG version " << options_.version << std::endl;
+        return false;
+    }
 
-    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
-    file_.open(path, std::ios::binary | std::ios::trunc);
-    if (!file_.is_open()) {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent);
+    }
+    if (buffer_ == nullptr) {
+        void* p = nullptr;
+        if (posix_memalign(&p, kPageBytes, bufferCapacity_) != 0) {
+            return false;
+        }
+        buffer_ = static_cast<uint8_t*>(p);
+    }
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
         return false;
     }
 
-    // Write header in a stable, explicit way.
-    file_.write(header_.magic, sizeof(header_.magic));
-    write_le<uint16_t>(file_, header_.version);
-    write_le<uint16_t>(file_, header_.reserved);
-    write_le<uint32_t>(file_, header_.channel_count);
-    write_le<uint32_t>(file_, header_.samples_per_record);
-    write_le<uint32_t>(file_, header_.sample_bits);
-    write_le<uint32_t>(file_, header_.timestamp_bits);
+    // The codec stores its words as they are
+    header_.version = options_.version;
+    if (header_.version == 2 && !kHostLittleEndian) {
+        std::cerr << "[WARN] HALOLOG v2 needs a little-endian host; raw log uses v1" << std::endl;
+        header_.version = 1;
+    }
 
+    fileOffset_ = 0;
+    failed_ = false;
     sequence_ = 0;
-    return file_.good();
+    recordsSinceSync_ = 0;
+    firstBufferedAt_ = std::chrono::steady_clock::now();
+    lastSyncAt_ = firstBufferedAt_;
+
+    // Header goes out with the first buffer
+    bufferedBytes_ = static_cast<size_t>(put_file_header(buffer_, header_) - buffer_);
+
+    // The log is usable without its index, so a failure here is only a warning
+    if (options_.indexStride > 0 && !index_.open(timeIndexPath(path))) {
+        std::cerr << "[WARN] Cannot create time index for " << path << std::endl;
+    }
+    if (options_.lodPyramid && !pyramid_->open(path, header_.channel_count)) {
+        std::cerr << "[WARN] Cannot create LOD pyramid for " << path << std::endl;
+    }
+    return true;
 }
 
 bool RawLogWriter::append(uint64_t unix_time_ns,
                           const std::vector<uint32_t>& timestamps,
                           const std::vector<uint16_t>& waveform) {
-    if (!file_.is_open()) return false;
-    if (timestamps.size() != 128) return false;
-    if (waveform.size() != 32 * 128) return false;
+    if (timestamps.size() != kTimestampsPerRecord) return false;
+    if (waveform.size() != kSamplesPerRecord) return false;
+    return append(unix_time_ns, timestamps.data(), waveform.data());
+}
+
+bool RawLogWriter::append(uint64_t unix_time_ns, const uint32_t* timestamps, const uint16_t* waveform) {
+    if (fd_ < 0 || failed_) return false;
+
+    const bool compressed = header_.version == 2;
+    if (bufferedBytes_ + (compressed ? kMaxCompressedRecordBytes : kRecordBytes) > bufferCapacity_ && !writeBuffer()) {
+        return false;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (bufferedBytes_ == 0) {
+        firstBufferedAt_ = now;
+    }
 
     RawLogRecordHeader rec{};
     rec.unix_time_ns = unix_time_ns;
     rec.sequence_index = sequence_++;
+    index_.add(unix_time_ns, bytesWritten());
+    pyramid_->add(timestamps, waveform, kTimestampsPerRecord);
 
-    // Record header
-    write_le<uint64_t>(file_, rec.unix_time_ns);
-    write_le<uint32_t>(file_, rec.sequence_index);
-    write_le<uint32_t>(file_, rec.payload_bytes);
+    uint8_t* out = buffer_ + bufferedBytes_;
+    if (compressed) {
+        // Encode in place, then fill in the header with the payload size
+        rec.payload_bytes = static_cast<uint32_t>(rawLogEncodeRecord(timestamps, waveform, 32, out + sizeof(rec)));
+        put_record_header(out, rec);
+    } else {
+        out = put_record_header(out, rec);
+        out = put_array(out, timestamps, kTimestampsPerRecord);
+        put_array(out, waveform, kSamplesPerRecord);  // Channel-major, as given
+    }
+    bufferedBytes_ += sizeof(rec) + rec.payload_bytes;
+    ++recordsSinceSync_;
 
-    // Timestamps
-    for (uint32_t ts : timestamps) {
-        write_le<uint32_t>(file_, ts);
+    bool syncDue = (options_.syncEveryRecords > 0 && recordsSinceSync_ >= options_.syncEveryRecords) ||
+                   (options_.syncInterval.count() > 0 && now - lastSyncAt_ >= options_.syncInterval);
+    if (syncDue) {
+        return sync();
+    }
+    if (now - firstBufferedAt_ >= options_.flushInterval) {
+        return writeBuffer();
     }
+    return true;
+}
+
+bool RawLogWriter::writeBuffer() {
+    if (bufferedBytes_ == 0) return !failed_;
+    const uint8_t* data = buffer_;
+    size_t length = bufferedBytes_;
+    uint64_t offset = fileOffset_;
+    fileOffset_ += length;
+    bufferedBytes_ = 0;
 
-    // Waveform samples (channel-major)
-    for (uint16_t sample : waveform) {
-        write_le<uint16_t>(file_, sample);
+    if (!pwriteAll(fd_, data, length, offset)) {
+        failed_ = true;
     }
+    return !failed_;
+}
+
+bool RawLogWriter::flush() {
+    if (fd_ < 0) return false;
+    return writeBuffer();
+}
 
-    file_.flush();
-    return file_.good();
+bool RawLogWriter::sync() {
+    if (!flush()) return false;
+    if (data_sync(fd_) != 0) {
+        failed_ = true;
+        return false;
+    }
+    recordsSinceSync_ = 0;
+    lastSyncAt_ = std::chrono::steady_clock::now();
+    // Only now do the new entries point at data that is on disk
+    if (index_.isOpen()) {
+        index_.flush();
+    }
+    if (pyramid_->isOpen()) {
+        pyramid_->flush();
+    }
+    return true;
 }
 
 void RawLogWriter::close() {
-    if (file_.is_open()) {
-        file_.flush();
-        file_.close();
+    if (fd_ >= 0) {
+        sync();
+        ::close(fd_);
+        fd_ = -1;
+        index_.close();
+        pyramid_->close();
     }
 }
 
+uint64_t RawLogRecordView::unixTimeNs() const {
+    uint64_t value;
+    std::memcpy(&value, record_, sizeof(value));  // Only 4-byte aligned in the file
+    return value;
+}
+
+uint32_t RawLogRecordView::sequenceIndex() const {
+    uint32_t value;
+    std::memcpy(&value, record_ + 8, sizeof(value));
+    return value;
+}
+
+uint32_t RawLogRecordView::payloadBytes() const {
+    uint32_t value;
+    std::memcpy(&value, record_ + 12, sizeof(value));
+    return value;
+}
+
+const uint32_t* RawLogRecordView::timestamps() const {
+    if (decoder_) return decoder_->decodedTimestamps(index_);
+    return reinterpret_cast<const uint32_t*>(record_ + 16);
+}
+
+const uint16_t* RawLogRecordView::waveform() const {
+    if (decoder_) return decoder_->decodedWaveform(index_);
+    return reinterpret_cast<const uint16_t*>(record_ + 16 + size_t(samplesPerRecord_) * 4);
+}
+
+const uint16_t* RawLogRecordView::channel(uint32_t channel) const {
+    if (decoder_) return decoder_->decodedChannel(index_, channel);
+    return waveform() + size_t(channel) * samplesPerRecord_;
+}
+
+RawLogReader::RawLogReader()
+    : data_(nullptr), mappedBytes_(0), recordBytes_(0), recordCount_(0), indexed_(false), decodedIndex_(SIZE_MAX),
+      timestampsDecoded_(false) {}
+RawLogReader::~RawLogReader() { close(); }
+
+bool RawLogReader::open(const std::string& path) {
+    close();
+    if constexpr (!kHostLittleEndian) {
+        error_ = "RawLogReader needs a little-endian host";
+        return false;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error_ = std::strerror(errno);
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kFileHeaderBytes) {
+        ::close(fd);
+        error_ = "File too short for a HALOLOG header";
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file
+    if (map == MAP_FAILED) {
+        error_ = std::strerror(errno);
+        return false;
+    }
+
+    RawLogFileHeader header;
+    std::memcpy(&header, map, sizeof(header));
+    const RawLogFileHeader expected;
+    const char* problem = nullptr;
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0) {
+        problem = "Bad magic in raw file";
+    } else if (header.version != 1 && header.version != 2) {
+        problem = "Unsupported HALOLOG version";
+    } else if (header.sample_bits != 16 || header.timestamp_bits != 32 || header.channel_count == 0 ||
+               header.samples_per_record == 0 ||
+               (header.version == 2 && header.samples_per_record != kRawLogCodecSamples)) {
+        problem = "Unsupported HALOLOG layout";
+    }
+    const bool compressed = header.version == 2;
+    size_t recordBytes = 16 + size_t(header.samples_per_record) * 4 +
+                         size_t(header.channel_count) * header.samples_per_record * 2;
+    if (!problem && !compressed && recordBytes % 4 != 0) {
+        problem = "Unsupported HALOLOG layout";  // Timestamps would be misaligned
+    }
+    size_t records = problem || compressed ? 0 : (bytes - kFileHeaderBytes) / recordBytes;
+    if (records > 0) {
+        RawLogRecordView first(static_cast<const uint8_t*>(map) + kFileHeaderBytes, header.channel_count,
+                               header.samples_per_record);
+        if (first.payloadBytes() != recordBytes - 16) {
+            problem = "Record size does not match the header";
+        }
+    }
+    if (problem) {
+        munmap(map, bytes);
+        error_ = problem;
+        return false;
+    }
+
+    header_ = header;
+    data_ = static_cast<const uint8_t*>(map);
+    mappedBytes_ = bytes;
+    recordBytes_ = compressed ? 0 : recordBytes;
+    recordCount_ = records;
+    if (compressed) {
+        if (!scanCompressed(bytes)) {
+            close();
+            error_ = "Malformed HALOLOG v2 record";
+            return false;
+        }
+        channelOffsets_.resize(header_.channel_count);
+        channelDecoded_.resize(header_.channel_count);
+        decodedTimestamps_.resize(header_.samples_per_record);
+        decodedWaveform_.resize(size_t(header_.channel_count) * header_.samples_per_record);
+    }
+    error_.clear();
+
+    // Use the index only if its entries land on this log's records
+    indexed_ = index_.load(timeIndexPath(path)) && !index_.empty();
+    if (indexed_ && compressed) {
+        const std::vector<TimeIndexEntry>& entries = index_.entries();
+        for (size_t entry = 0; entry < entries.size() && indexed_; ++entry) {
+            size_t rec = entry * index_.header().stride;
+            indexed_ = rec < recordCount_ && offsets_[rec] == entries[entry].offset;
+        }
+    } else if (indexed_) {
+        indexed_ = index_.entries()[0].offset == kFileHeaderBytes &&
+                   (index_.entries().size() < 2 || index_.entries()[1].offset - index_.entries()[0].offset ==
+                                                       uint64_t(index_.header().stride) * recordBytes_);
+    }
+    return true;
+}
+
+bool RawLogReader::scanCompressed(size_t bytes) {
+    offsets_.clear();
+    const size_t maxPayload = rawLogCodecMaxPayload(header_.channel_count);
+    uint64_t offset = kFileHeaderBytes;
+    while (offset + sizeof(RawLogRecordHeader) <= bytes) {
+        RawLogRecordHeader rec;
+        std::memcpy(&rec, data_ + offset, sizeof(rec));
+        const uint8_t* payload = data_ + offset + sizeof(rec);
+        if (offset + sizeof(rec) + rec.payload_bytes > bytes) {
+            break;  // Still being written
+        }
+        if (rec.payload_bytes > maxPayload ||
+            !rawLogValidatePayload(payload, rec.payload_bytes, header_.channel_count)) {
+            // Nothing after it can be located
+            if (offsets_.empty()) return false;
+            std::cerr << "[WARN] Malformed HALOLOG v2 record " << offsets_.size() << "; reading only the records before it"
+                      << std::endl;
+            break;
+        }
+        offsets_.push_back(offset);
+        offset += sizeof(rec) + rec.payload_bytes;
+    }
+    recordCount_ = offsets_.size();
+    return true;
+}
+
+void RawLogReader::close() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), mappedBytes_);
+        data_ = nullptr;
+    }
+    mappedBytes_ = 0;
+    recordBytes_ = 0;
+    recordCount_ = 0;
+    offsets_.clear();
+    indexed_ = false;
+    decodedIndex_ = SIZE_MAX;
+}
+
+const uint8_t* RawLogReader::recordAt(size_t index) const {
+    return recordBytes_ > 0 ? data_ + kFileHeaderBytes + index * recordBytes_ : data_ + offsets_[index];
+}
+
+RawLogRecordView RawLogReader::record(size_t index) const {
+    if (recordBytes_ > 0) {
+        return RawLogRecordView(recordAt(index), header_.channel_count, header_.samples_per_record);
+    }
+    return RawLogRecordView(recordAt(index), this, index, header_.channel_count, header_.samples_per_record);
+}
+
+void RawLogReader::selectDecoded(size_t index) const {
+    if (decodedIndex_ == index) return;
+    rawLogChannelOffsets(recordAt(index) + sizeof(RawLogRecordHeader), header_.channel_count, channelOffsets_.data());
+    std::fill(channelDecoded_.begin(), channelDecoded_.end(), 0);
+    timestampsDecoded_ = false;
+    decodedIndex_ = index;
+}
+
+const uint32_t* RawLogReader::decodedTimestamps(size_t index) const {
+    selectDecoded(index);
+    if (!timestampsDecoded_) {
+        rawLogDecodeTimestamps(recordAt(index) + sizeof(RawLogRecordHeader), decodedTimestamps_.data());
+        timestampsDecoded_ = true;
+    }
+    return decodedTimestamps_.data();
+}
+
+const uint16_t* RawLogReader::decodedChannel(size_t index, uint32_t channel) const {
+    selectDecoded(index);
+    uint16_t* samples = decodedWaveform_.data() + size_t(channel) * header_.samples_per_record;
+    if (!channelDecoded_[channel]) {
+        rawLogDecodeChannel(recordAt(index) + sizeof(RawLogRecordHeader) + channelOffsets_[channel], samples);
+        channelDecoded_[channel] = 1;
+    }
+    return samples;
+}
+
+const uint16_t* RawLogReader::decodedWaveform(size_t index) const {
+    for (uint32_t channel = 0; channel < header_.channel_count; ++channel) {
+        decodedChannel(index, channel);
+    }
+    return decodedWaveform_.data();
+}
+
+RawLogRecordHeader RawLogReader::recordHeader(size_t index) const {
+    RawLogRecordHeader rec;
+    std::memcpy(&rec, recordAt(index), sizeof(rec));  // Only 4-byte aligned in the file
+    return rec;
+}
+
+// Both versions start the payload with the first timestamp
+uint32_t RawLogReader::firstTick(size_t index) const {
+    uint32_t tick;
+    std::memcpy(&tick, recordAt(index) + sizeof(RawLogRecordHeader), sizeof(tick));
+    return tick;
+}
+
+// Keys rise with the record index. Records are written at a fixed rate, so
+// the interpolated guess is normally exact or one off; gaps in the recording
+// fall back to a binary search on the side the guess landed.
+// Searches records [lo, hi].
+template <typename Key>
+size_t RawLogReader::findLastAtOrBefore(uint64_t target, Key key, size_t lo, size_t hi) const {
+    uint64_t first = key(lo);
+    uint64_t end = key(hi);
+    if (target <= first || hi == lo) return lo;
+    if (target >= end) return hi;
+
+    size_t guess = lo + static_cast<size_t>(static_cast<long double>(target - first) * (hi - lo) / (end - first));
+    guess = std::min(guess, hi);
+    constexpr int kLocalSteps = 4;
+    if (key(guess) <= target) {
+        for (int step = 0; step < kLocalSteps; ++step) {
+            if (guess == hi || key(guess + 1) > target) return guess;
+            ++guess;
+        }
+        lo = guess;  // key(lo) <= target < key(hi)
+    } else {
+        for (int step = 0; step < kLocalSteps; ++step) {
+            --guess;
+            if (key(guess) <= target) return guess;
+        }
+        hi = guess;  // key(lo) <= target < key(hi)
+    }
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        (key(mid) <= target ? lo : hi) = mid;
+    }
+    return lo;
+}
+
+size_t RawLogReader::findBySequence(uint32_t sequenceIndex) const {
+    if (recordCount_ == 0) return 0;
+    auto key = [this](size_t i) { return uint64_t(recordHeader(i).sequence_index); };
+    size_t index = findLastAtOrBefore(sequenceIndex, key, 0, recordCount_ - 1);
+    return key(index) == sequenceIndex ? index : recordCount_;
+}
+
+size_t RawLogReader::findByTime(uint64_t unixTimeNs) const {
+    if (recordCount_ == 0) return 0;
+    size_t lo = 0;
+    size_t hi = recordCount_ - 1;
+    if (indexed_) {
+        // Between the index entries around the time; past the last entry the
+        // index has not caught up yet and the rest of the log is searched
+        const std::vector<TimeIndexEntry>& entries = index_.entries();
+        size_t entry = index_.floor(unixTimeNs);
+        if (entry == entries.size()) return 0;
+        // open() checked that entry k is record k * stride
+        const size_t stride = index_.header().stride;
+        lo = std::min(entry * stride, hi);
+        if (entry + 1 < entries.size()) {
+            hi = std::min((entry + 1) * stride, hi);
+        }
+    }
+    return findLastAtOrBefore(unixTimeNs, [this](size_t i) { return recordHeader(i).unix_time_ns; }, lo, hi);
+}
+
+size_t RawLogReader::findByTick(uint32_t tick) const {
+    if (recordCount_ == 0) return 0;
+    return findLastAtOrBefore(tick, [this](size_t i) { return uint64_t(firstTick(i)); }, 0, recordCount_ - 1);
+}
@@ -23,13 +23,23 @@
 //
 // Record size is fixed: 16 bytes header + 512 + 8192 = 8720 bytes.
 // Files can be memory-mapped or sequentially read with simple pointer math.
+//
+// Version 2 has the same file header and record header, but each record's
+// payload is compressed losslessly (timestamps as a base and a run length,
+// samples as bit-packed deltas; see raw_log_codec.h): about half the size of
+// v1 for typical amplifier noise, and never more than 132 bytes larger.
+// payload_bytes then varies from record to record.
+// RawLogWriter writes v1 unless asked for v2; RawLogReader reads both.
 
 #pragma once
 
 #include <cstdint>
 #include <vector>
 #include <string>
-#include <fstream>
+#include <chrono>
+#include <memory>
+
+#include "log_time_index.h"
 
 struct RawLogFileHeader {
     char magic[8] = {'H','A','L','O','L','O','G',0};
@@ -47,11 +57,35 @@ struct RawLogRecordHeader {
     uint32_t payload_bytes = 512 + 8192; // 128 * 4 + 32 * 128 * 2
 };
 
-// Minimal writer for the raw log format.
+struct RawLogWriterOptions {
+    // Records are staged in a page-aligned buffer of this size and written
+    // when it fills (rounded up to whole records)
+    size_t bufferBytes = 1024 * 1024;
+    // A partial buffer is written once its oldest record is this old
+    std::chrono::milliseconds flushInterval{1000};
+    // Group commit: fdatasync after this many records or this long since the
+    // last sync, whichever comes first (0 disables that trigger; with both 0
+    // data reaches the disk only on close)
+    uint32_t syncEveryRecords = 0;
+    std::chrono::milliseconds syncInterval{5000};
+    // Records per entry in the <path>.idx time index, written at each sync
+    // (0 = no index)
+    uint32_t indexStride = 64;
+    // HALOLOG version to write: 1 (fixed-size records) or 2 (compressed)
+    uint16_t version = 1;
+    // Build the min/max/mean pyramid (<path>.lod16/256/4096, see
+    // raw_log_pyramid.h) as records are appended, written at each sync
+    bool lodPyramid = true;
+};
+
+// Writer for the raw log format. Records are serialised into a large buffer
+// (plain memcpy on little-endian hosts, or the v2 codec) and written in bulk.
 class RawLogWriter {
 public:
-    RawLogWriter();
+    explicit RawLogWriter(const RawLogWriterOptions& options = RawLogWriterOptions());
     ~RawLogWriter();
+    RawLogWriter(const RawLogWriter&) = delete;
+    RawLogWriter& operator=(const RawLogWriter&) = delete;
 
     // Open/prepare a log file. Creates directories if needed and writes header.
     bool open(const std::string& path);
@@ -60,13 +94,157 @@ public:
     bool append(uint64_t unix_time_ns,
                 const std::vector<uint32_t>& timestamps,
                 const std::vector<uint16_t>& waveform);
+    // Same, from raw arrays of 128 timestamps and 32*128 samples
+    bool append(uint64_t unix_time_ns, const uint32_t* timestamps, const uint16_t* waveform);
 
+    // Write buffered records to the file (no fdatasync)
+    bool flush();
+    // flush(), then fdatasync
+    bool sync();
+
+    // Flush, sync and close
     void close();
-    bool isOpen() const { return file_.is_open(); }
+    bool isOpen() const { return fd_ >= 0; }
+
+    uint64_t bytesWritten() const { return fileOffset_ + bufferedBytes_; }
 
 private:
-    std::ofstream file_;
+    bool writeBuffer();
+
+    RawLogWriterOptions options_;
+    int fd_;
     RawLogFileHeader header_{};
     uint32_t sequence_{0};
+
+    // Page-aligned staging buffer, written with one pwrite when full
+    uint8_t* buffer_;
+    size_t bufferCapacity_;
+    size_t bufferedBytes_;
+    uint64_t fileOffset_;  // Where the active buffer starts in the file
+    bool failed_;          // A write failed; the file is incomplete
+
+    uint32_t recordsSinceSync_;
+    std::chrono::steady_clock::time_point firstBufferedAt_;
+    std::chrono::steady_clock::time_point lastSyncAt_;
+
+    TimeIndexWriter index_;
+    std::unique_ptr<class RawLogPyramidWriter> pyramid_;
+};
+
+class RawLogReader;
+
+// View of one record of a RawLogReader. For v1 it points into the mapping
+// and is valid until the reader is closed. For v2 the payload is decoded into
+// the reader on first use, one channel at a time, so pulling one channel
+// costs one channel's decode; what a v2 view returns stays valid until a view
+// of another record is used.
+class RawLogRecordView {
+public:
+    // A v1 record, in place
+    RawLogRecordView(const uint8_t* record, uint32_t channelCount, uint32_t samplesPerRecord)
+        : record_(record), decoder_(nullptr), index_(0), channelCount_(channelCount),
+          samplesPerRecord_(samplesPerRecord) {}
+    // A v2 record, decoded by the reader
+    RawLogRecordView(const uint8_t* record, const RawLogReader* decoder, size_t index, uint32_t channelCount,
+                     uint32_t samplesPerRecord)
+        : record_(record), decoder_(decoder), index_(index), channelCount_(channelCount),
+          samplesPerRecord_(samplesPerRecord) {}
+
+    uint64_t unixTimeNs() const;
+    uint32_t sequenceIndex() const;
+    uint32_t payloadBytes() const;
+
+    // samplesPerRecord sample ticks
+    const uint32_t* timestamps() const;
+    // Whole block, channel-major: waveform()[channel * samplesPerRecord + sample]
+    const uint16_t* waveform() const;
+    // samplesPerRecord samples of one channel
+    const uint16_t* channel(uint32_t channel) const;
+
+    uint32_t channelCount() const { return channelCount_; }
+    uint32_t samplesPerRecord() const { return samplesPerRecord_; }
+
+private:
+    const uint8_t* record_;
+    const RawLogReader* decoder_;  // nullptr for v1
+    size_t index_;
+    uint32_t channelCount_;
+    uint32_t samplesPerRecord_;
 };
 
+// Read-only, memory-mapped raw log, v1 or v2. v1 records are found by
+// position from the fixed record size; v2 records vary in size, so open()
+// walks and validates the record headers once to build a table of offsets.
+// Lookups by sequence index, capture time or sample tick are then an
+// interpolation from the first and last record plus a short local search
+// (binary search only if the file has gaps), reading only record headers.
+// If the log has a .idx time index, findByTime first narrows to the records
+// between two index entries. Records are used in place, which needs a
+// little-endian host, like the views above. Not thread-safe: views of a v2
+// log decode into the reader.
+class RawLogReader {
+public:
+    RawLogReader();
+    ~RawLogReader();
+    RawLogReader(const RawLogReader&) = delete;
+    RawLogReader& operator=(const RawLogReader&) = delete;
+
+    // Map the file and validate its header. On failure error() says why.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return data_ != nullptr; }
+    const std::string& error() const { return error_; }
+
+    const RawLogFileHeader& header() const { return header_; }
+    // Size of every record (v1), or 0 if they vary (v2)
+    size_t recordBytes() const { return recordBytes_; }
+    // Whole records; a partial record still being written is ignored
+    size_t recordCount() const { return recordCount_; }
+
+    RawLogRecordView record(size_t index) const;
+    // The .idx sidecar, if one was found and matches the log
+    const TimeIndex* timeIndex() const { return indexed_ ? &index_ : nullptr; }
+
+    // Index of the record with this sequence index, or recordCount() if none
+    size_t findBySequence(uint32_t sequenceIndex) const;
+    // Index of the last record starting at or before the given time (its
+    // unix_time_ns or first timestamp); 0 if the time precedes the file.
+    // recordCount() must be non-zero.
+    size_t findByTime(uint64_t unixTimeNs) const;
+    size_t findByTick(uint32_t tick) const;
+
+private:
+    template <typename Key>
+    size_t findLastAtOrBefore(uint64_t target, Key key, size_t lo, size_t hi) const;
+    // Start of a record (its 16-byte header) in the mapping
+    const uint8_t* recordAt(size_t index) const;
+    // Search keys, read without decoding a v2 payload
+    RawLogRecordHeader recordHeader(size_t index) const;
+    uint32_t firstTick(size_t index) const;
+    // Offsets of the v2 records, false at the first malformed one
+    bool scanCompressed(size_t bytes);
+
+    std::string error_;
+    RawLogFileHeader header_{};
+    const uint8_t* data_;
+    size_t mappedBytes_;
+    size_t recordBytes_;
+    size_t recordCount_;
+    std::vector<uint64_t> offsets_;  // v2 only
+    TimeIndex index_;
+    bool indexed_;
+
+    // v2 decoding for RawLogRecordView, one record at a time
+    friend class RawLogRecordView;
+    void selectDecoded(size_t index) const;
+    const uint32_t* decodedTimestamps(size_t index) const;
+    const uint16_t* decodedChannel(size_t index, uint32_t channel) const;
+    const uint16_t* decodedWaveform(size_t index) const;
+
+    mutable size_t decodedIndex_;
+    mutable bool timestampsDecoded_;
+    mutable std::vector<uint32_t> channelOffsets_;  // Within the payload
+    mutable std::vector<uint8_t> channelDecoded_;
+    mutable std::vector<uint32_t> decodedTimestamps_;
+    mutable std::vector<uint16_t> decodedWaveform_;
+};
@@ -0,0 +1,468 @@
+#include "raw_log_pyramid.h"
+#include "raw_io_util.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+constexpr uint32_t kBucketsPerBlock = 1024;
+
+static_assert(sizeof(RawLogLodHeader) == 32, "RawLogLodHeader must match the on-disk header");
+
+size_t blockBytes(uint32_t buckets, uint32_t channels) { return size_t(buckets) * (8 + size_t(channels) * 6); }
+
+// Offsets of the arrays inside a block
+size_t lastTickRow(uint32_t buckets) { return size_t(buckets) * 4; }
+size_t minRow(uint32_t buckets, uint32_t channel) { return size_t(buckets) * (8 + size_t(channel) * 6); }
+size_t maxRow(uint32_t buckets, uint32_t channel) { return minRow(buckets, channel) + size_t(buckets) * 2; }
+size_t meanRow(uint32_t buckets, uint32_t channel) { return minRow(buckets, channel) + size_t(buckets) * 4; }
+
+template <typename T>
+T load(const uint8_t* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+template <typename T>
+void store(uint8_t* p, T value) {
+    std::memcpy(p, &value, sizeof(value));
+}
+
+// Fold n samples into a bucket's running min/max/sum. Working on locals with
+// a fixed n lets the compiler vectorise the common case of a whole bucket;
+// min/max run on the samples offset to signed, as SSE2 only has a signed
+// 16-bit min/max.
+template <uint32_t N>
+inline void reduceFixed(const uint16_t* s, uint16_t& min, uint16_t& max, uint32_t& sum) {
+    int16_t lo = static_cast<int16_t>(min ^ 0x8000), hi = static_cast<int16_t>(max ^ 0x8000);
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < N; ++i) {
+        int16_t v = static_cast<int16_t>(s[i] ^ 0x8000);
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+        total += s[i];
+    }
+    min = static_cast<uint16_t>(lo ^ 0x8000);
+    max = static_cast<uint16_t>(hi ^ 0x8000);
+    sum += total;
+}
+
+inline void reduce(const uint16_t* s, uint32_t n, uint16_t& min, uint16_t& max, uint32_t& sum) {
+    if (n == kRawLogLodFactors[0]) {
+        reduceFixed<kRawLogLodFactors[0]>(s, min, max, sum);
+        return;
+    }
+    uint16_t lo = min, hi = max;
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        lo = std::min(lo, s[i]);
+        hi = std::max(hi, s[i]);
+        total += s[i];
+    }
+    min = lo;
+    max = hi;
+    sum += total;
+}
+
+// Rounded mean; a whole bucket of a power-of-two factor divides by shifting
+uint16_t bucketMean(uint32_t sum, uint32_t samples, uint32_t factor, uint32_t factorShift) {
+    if (samples == factor) return static_cast<uint16_t>((sum + factor / 2) >> factorShift);
+    return static_cast<uint16_t>((sum + samples / 2) / samples);
+}
+} // namespace
+
+struct RawLogPyramidWriter::Level {
+    RawLogLodHeader header;
+    uint32_t factorShift = 0;  // log2(factor)
+    int fd = -1;
+
+    // Bucket being accumulated
+    uint32_t samples = 0;
+    uint32_t firstTick = 0;
+    uint32_t lastTick = 0;
+    std::vector<uint16_t> min;
+    std::vector<uint16_t> max;
+    std::vector<uint32_t> sum;  // At most 4096 * 65535
+
+    // Block being filled
+    std::vector<uint8_t> block;
+    uint32_t filled = 0;   // Buckets in the block
+    uint32_t written = 0;  // Of those, already in the file
+    uint64_t blockIndex = 0;
+
+    void resetBucket() {
+        samples = 0;
+        std::fill(min.begin(), min.end(), uint16_t(0xFFFF));
+        std::fill(max.begin(), max.end(), uint16_t(0));
+        std::fill(sum.begin(), sum.end(), 0u);
+    }
+};
+
+RawLogPyramidWriter::RawLogPyramidWriter() : channelCount_(0) {}
+
+RawLogPyramidWriter::~RawLogPyramidWriter() { close(); }
+
+bool RawLogPyramidWriter::open(const std::string& logPath, uint32_t channelCount) {
+    close();
+    if (!kHostLittleEndian || channelCount == 0) return false;
+    channelCount_ = channelCount;
+    for (uint32_t factor : kRawLogLodFactors) {
+        Level level;
+        level.header.channel_count = channelCount;
+        level.header.factor = factor;
+        level.header.buckets_per_block = kBucketsPerBlock;
+        while ((1u << level.factorShift) < factor) ++level.factorShift;
+        level.fd = ::open(rawLogLodPath(logPath, factor).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (level.fd < 0 || !pwriteAll(level.fd, &level.header, sizeof(level.header), 0)) {
+            if (level.fd >= 0) ::close(level.fd);
+            for (Level& opened : levels_) ::close(opened.fd);
+            levels_.clear();
+            return false;
+        }
+        level.min.resize(channelCount);
+        level.max.resize(channelCount);
+        level.sum.resize(channelCount);
+        level.resetBucket();
+        level.block.assign(blockBytes(kBucketsPerBlock, channelCount), 0);
+        levels_.push_back(std::move(level));
+    }
+    return true;
+}
+
+void RawLogPyramidWriter::add(const uint32_t* timestamps, const uint16_t* waveform, uint32_t samples) {
+    if (levels_.empty()) return;
+    Level& finest = levels_[0];
+    uint32_t pos = 0;
+    while (pos < samples) {
+        if (finest.samples == 0 && samples - pos >= finest.header.factor) {
+            pos += addBuckets(timestamps, waveform, samples, pos);
+            continue;
+        }
+        uint32_t n = std::min(samples - pos, finest.header.factor - finest.samples);
+        if (finest.samples == 0) finest.firstTick = timestamps[pos];
+        finest.lastTick = timestamps[pos + n - 1];
+        for (uint32_t channel = 0; channel < channelCount_; ++channel) {
+            reduce(waveform + size_t(channel) * samples + pos, n, finest.min[channel], finest.max[channel],
+                   finest.sum[channel]);
+        }
+        finest.samples += n;
+        pos += n;
+        if (finest.samples == finest.header.factor) {
+            emit(0);
+        }
+    }
+}
+
+// Whole finest-level buckets from samples[pos..], written straight into the
+// block a channel at a time rather than one emit() per bucket, and folded
+// into the next level's bucket. Returns the samples consumed.
+uint32_t RawLogPyramidWriter::addBuckets(const uint32_t* timestamps, const uint16_t* waveform, uint32_t samples,
+                                         uint32_t pos) {
+    Level& level = levels_[0];
+    const uint32_t factor = level.header.factor;
+    Level* parent = levels_.size() > 1 ? &levels_[1] : nullptr;
+    uint32_t count = std::min((samples - pos) / factor, kBucketsPerBlock - level.filled);
+    if (parent) count = std::min(count, (parent->header.factor - parent->samples) / factor);
+
+    const uint32_t b = kBucketsPerBlock;
+    const uint32_t slot = level.filled;
+    uint8_t* block = level.block.data();
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t* ts = timestamps + pos + size_t(i) * factor;
+        store<uint32_t>(block + size_t(slot + i) * 4, ts[0]);
+        store<uint32_t>(block + lastTickRow(b) + size_t(slot + i) * 4, ts[factor - 1]);
+    }
+    for (uint32_t channel = 0; channel < channelCount_; ++channel) {
+        const uint16_t* s = waveform + size_t(channel) * samples + pos;
+        uint8_t* min = block + minRow(b, channel) + size_t(slot) * 2;
+        uint8_t* max = block + maxRow(b, channel) + size_t(slot) * 2;
+        uint8_t* mean = block + meanRow(b, channel) + size_t(slot) * 2;
+        uint16_t lo = 0xFFFF, hi = 0;
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint16_t bucketMin = 0xFFFF, bucketMax = 0;
+            uint32_t bucketSum = 0;
+            reduce(s + size_t(i) * factor, factor, bucketMin, bucketMax, bucketSum);
+            store<uint16_t>(min + size_t(i) * 2, bucketMin);
+            store<uint16_t>(max + size_t(i) * 2, bucketMax);
+            store<uint16_t>(mean + size_t(i) * 2, bucketMean(bucketSum, factor, factor, level.factorShift));
+            lo = std::min(lo, bucketMin);
+            hi = std::max(hi, bucketMax);
+            total += bucketSum;
+        }
+        if (parent) {
+            parent->min[channel] = std::min(parent->min[channel], lo);
+            parent->max[channel] = std::max(parent->max[channel], hi);
+            parent->sum[channel] += total;
+        }
+    }
+    level.filled += count;
+    level.header.bucket_count += count;
+
+    if (parent) {
+        if (parent->samples == 0) parent->firstTick = timestamps[pos];
+        parent->lastTick = timestamps[pos + count * factor - 1];
+        parent->samples += count * factor;
+        if (parent->samples == parent->header.factor) {
+            emit(1);
+        }
+    }
+    endBlockIfFull(level);
+    return count * factor;
+}
+
+// Append the level's current bucket to its block and fold it into the next
+// level up
+void RawLogPyramidWriter::emit(size_t index) {
+    Level& level = levels_[index];
+    if (level.samples == 0) return;
+
+    const uint32_t b = kBucketsPerBlock;
+    const uint32_t slot = level.filled;
+    uint8_t* block = level.block.data();
+    store<uint32_t>(block + size_t(slot) * 4, level.firstTick);
+    store<uint32_t>(block + lastTickRow(b) + size_t(slot) * 4, level.lastTick);
+    for (uint32_t channel = 0; channel < channelCount_; ++channel) {
+        uint16_t mean = bucketMean(level.sum[channel], level.samples, level.header.factor, level.factorShift);
+        store<uint16_t>(block + minRow(b, channel) + size_t(slot) * 2, level.min[channel]);
+        store<uint16_t>(block + maxRow(b, channel) + size_t(slot) * 2, level.max[channel]);
+        store<uint16_t>(block + meanRow(b, channel) + size_t(slot) * 2, mean);
+    }
+    ++level.filled;
+    ++level.header.bucket_count;
+
+    if (index + 1 < levels_.size()) {
+        Level& parent = levels_[index + 1];
+        if (parent.samples == 0) parent.firstTick = level.firstTick;
+        parent.lastTick = level.lastTick;
+        for (uint32_t channel = 0; channel < channelCount_; ++channel) {
+            parent.min[channel] = std::min(parent.min[channel], level.min[channel]);
+            parent.max[channel] = std::max(parent.max[channel], level.max[channel]);
+            parent.sum[channel] += level.sum[channel];
+        }
+        parent.samples += level.samples;
+        level.resetBucket();
+        if (parent.samples == parent.header.factor) {
+            emit(index + 1);
+        }
+    } else {
+        level.resetBucket();
+    }
+
+    endBlockIfFull(level);
+}
+
+void RawLogPyramidWriter::endBlockIfFull(Level& level) {
+    if (level.filled == kBucketsPerBlock) {
+        // The next block starts at a fixed offset; this one is finished. If
+        // it cannot be written the level stops here, its header still
+        // covering only what reached the file.
+        if (!writeBlock(level)) {
+            ::close(level.fd);
+            level.fd = -1;
+        }
+        level.filled = 0;
+        level.written = 0;
+        ++level.blockIndex;
+    }
+}
+
+// Write the block's buckets that are not in the file yet, row by row
+bool RawLogPyramidWriter::writeBlock(Level& level) {
+    if (level.fd < 0 || level.written == level.filled) return true;
+    const uint32_t b = kBucketsPerBlock;
+    const uint64_t base = sizeof(RawLogLodHeader) + level.blockIndex * level.block.size();
+    auto writeRow = [&](size_t row, size_t elementBytes) {
+        size_t begin = row + level.written * elementBytes;
+        size_t length = size_t(level.filled - level.written) * elementBytes;
+        return pwriteAll(level.fd, level.block.data() + begin, length, base + begin);
+    };
+    bool ok = writeRow(0, 4) && writeRow(lastTickRow(b), 4);
+    for (uint32_t channel = 0; ok && channel < channelCount_; ++channel) {
+        ok = writeRow(minRow(b, channel), 2) && writeRow(maxRow(b, channel), 2) && writeRow(meanRow(b, channel), 2);
+    }
+    if (ok) level.written = level.filled;
+    return ok;
+}
+
+bool RawLogPyramidWriter::flush() {
+    bool ok = !levels_.empty();
+    for (Level& level : levels_) {
+        ok = level.fd >= 0 && writeBlock(level) && pwriteAll(level.fd, &level.header, sizeof(level.header), 0) && ok;
+    }
+    return ok;
+}
+
+void RawLogPyramidWriter::close() {
+    if (levels_.empty()) return;
+    for (size_t index = 0; index < levels_.size(); ++index) {
+        emit(index);
+    }
+    flush();
+    for (Level& level : levels_) {
+        if (level.fd >= 0) ::close(level.fd);
+    }
+    levels_.clear();
+}
+
+RawLogPyramid::RawLogPyramid() {}
+
+RawLogPyramid::~RawLogPyramid() { close(); }
+
+bool RawLogPyramid::open(const std::string& logPath) {
+    close();
+    if (!log_.open(logPath)) return false;
+    for (uint32_t factor : kRawLogLodFactors) {
+        Level level;
+        if (openLevel(rawLogLodPath(logPath, factor), factor, level)) {
+            levels_.push_back(level);
+        }
+    }
+    return true;
+}
+
+bool RawLogPyramid::openLevel(const std::string& path, uint32_t factor, Level& level) const {
+    if (!kHostLittleEndian) return false;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(RawLogLodHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+
+    std::memcpy(&level.header, map, sizeof(level.header));
+    const RawLogLodHeader& h = level.header;
+    const RawLogLodHeader expected;
+    bool ok = std::memcmp(h.magic, expected.magic, sizeof(h.magic)) == 0 && h.version == 1 && h.factor == factor &&
+              h.channel_count == log_.header().channel_count && h.buckets_per_block > 0;
+    if (ok) {
+        level.blockBytes = blockBytes(h.buckets_per_block, h.channel_count);
+        // Every covered bucket must be inside the file; the last row of the
+        // last block ends furthest in
+        if (h.bucket_count > 0) {
+            uint64_t last = h.bucket_count - 1;
+            uint64_t end = sizeof(RawLogLodHeader) + (last / h.buckets_per_block) * level.blockBytes +
+                           meanRow(h.buckets_per_block, h.channel_count - 1) + (last % h.buckets_per_block + 1) * 2;
+            ok = end <= bytes;
+        }
+        // ...and belong to this log, not an earlier one at the same path
+        const uint8_t* first = static_cast<const uint8_t*>(map) + sizeof(RawLogLodHeader);
+        ok = ok && (h.bucket_count == 0 ||
+                    (log_.recordCount() > 0 && load<uint32_t>(first) == log_.record(0).timestamps()[0]));
+    }
+    if (!ok || h.bucket_count == 0) {
+        munmap(map, bytes);
+        return false;
+    }
+    level.data = static_cast<const uint8_t*>(map);
+    level.mappedBytes = bytes;
+    return true;
+}
+
+void RawLogPyramid::close() {
+    for (Level& level : levels_) {
+        munmap(const_cast<uint8_t*>(level.data), level.mappedBytes);
+    }
+    levels_.clear();
+    log_.close();
+}
+
+std::vector<uint32_t> RawLogPyramid::factors() const {
+    std::vector<uint32_t> factors{1};
+    for (const Level& level : levels_) {
+        factors.push_back(level.header.factor);
+    }
+    return factors;
+}
+
+uint32_t RawLogPyramid::factorFor(uint64_t samples, uint32_t pixels) const {
+    uint32_t best = 1;
+    for (const Level& level : levels_) {
+        if (samples / level.header.factor >= std::max<uint32_t>(pixels, 1)) {
+            best = level.header.factor;
+        }
+    }
+    return best;
+}
+
+uint32_t RawLogPyramid::query(uint32_t channel, uint32_t startTick, uint32_t endTick, uint32_t pixels,
+                              std::vector<RawLogLodBucket>& out) const {
+    uint64_t samples = endTick >= startTick ? uint64_t(endTick) - startTick + 1 : 0;
+    uint32_t factor = factorFor(samples, pixels);
+    read(factor, channel, startTick, endTick, out);
+    return factor;
+}
+
+bool RawLogPyramid::read(uint32_t factor, uint32_t channel, uint32_t startTick, uint32_t endTick,
+                         std::vector<RawLogLodBucket>& out) const {
+    out.clear();
+    if (!log_.isOpen() || channel >= log_.header().channel_count) return false;
+    if (factor == 1) {
+        readLog(channel, startTick, endTick, out);
+        return true;
+    }
+    for (const Level& level : levels_) {
+        if (level.header.factor == factor) {
+            readLevel(level, channel, startTick, endTick, out);
+            return true;
+        }
+    }
+    return false;
+}
+
+void RawLogPyramid::readLevel(const Level& level, uint32_t channel, uint32_t startTick, uint32_t endTick,
+                              std::vector<RawLogLodBucket>& out) const {
+    const uint32_t b = level.header.buckets_per_block;
+    const uint64_t count = level.header.bucket_count;
+    auto at = [&](uint64_t bucket, size_t row, size_t elementBytes) {
+        return level.data + sizeof(RawLogLodHeader) + (bucket / b) * level.blockBytes + row + (bucket % b) * elementBytes;
+    };
+    auto lastTick = [&](uint64_t bucket) { return load<uint32_t>(at(bucket, lastTickRow(b), 4)); };
+
+    // First bucket ending at or after the start; ticks rise with the bucket
+    uint64_t lo = 0;
+    uint64_t hi = count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (lastTick(mid) < startTick) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (uint64_t bucket = lo; bucket < count; ++bucket) {
+        RawLogLodBucket value;
+        value.firstTick = load<uint32_t>(at(bucket, 0, 4));
+        if (value.firstTick > endTick) break;
+        value.lastTick = lastTick(bucket);
+        value.min = load<uint16_t>(at(bucket, minRow(b, channel), 2));
+        value.max = load<uint16_t>(at(bucket, maxRow(b, channel), 2));
+        value.mean = load<uint16_t>(at(bucket, meanRow(b, channel), 2));
+        out.push_back(value);
+    }
+}
+
+void RawLogPyramid::readLog(uint32_t channel, uint32_t startTick, uint32_t endTick,
+                            std::vector<RawLogLodBucket>& out) const {
+    for (size_t rec = log_.recordCount() > 0 ? log_.findByTick(startTick) : 0; rec < log_.recordCount(); ++rec) {
+        RawLogRecordView view = log_.record(rec);
+        const uint32_t* ts = view.timestamps();
+        if (ts[0] > endTick) break;
+        const uint16_t* wave = view.channel(channel);
+        for (uint32_t i = 0; i < view.samplesPerRecord(); ++i) {
+            if (ts[i] < startTick || ts[i] > endTick) continue;
+            out.push_back({ts[i], ts[i], wave[i], wave[i], wave[i]});
+        }
+    }
+}
@@ -0,0 +1,142 @@
+// Min/max/mean level-of-detail pyramid for a raw log, so a waveform view can
+// draw any span at screen resolution without reading every sample.
+//
+// The raw log itself is the 1x level. Coarser levels decimate it 16x, 256x
+// and 4096x and are stored next to it, one file per level, as
+// <log>.lod16, <log>.lod256 and <log>.lod4096. RawLogWriter builds them as
+// records are appended (RawLogWriterOptions::lodPyramid).
+//
+// Layout of a level file (all little-endian):
+// RawLogLodHeader {
+//   char     magic[8]          = "HALOLOD";
+//   uint16_t version            = 1;
+//   uint16_t reserved           = 0;
+//   uint32_t channel_count;
+//   uint32_t factor;                 // samples per bucket
+//   uint32_t buckets_per_block;      // B
+//   uint64_t bucket_count;           // buckets covered by this header
+// }
+// Repeated fixed-size block of B buckets, arrays rather than structs so
+// that one channel is three contiguous runs per block:
+//   uint32_t first_tick[B];          // tick of each bucket's first sample
+//   uint32_t last_tick[B];           // and of its last
+//   per channel {
+//     uint16_t min[B];
+//     uint16_t max[B];
+//     uint16_t mean[B];              // rounded
+//   }
+//
+// A bucket covers factor consecutive samples of the log, whatever their
+// ticks (so a dropout can fall inside one); only the last bucket of a closed
+// log may cover fewer. The block being filled is rewritten in place at each
+// flush, and bucket_count is what a reader may use (raw_io_util.h).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "raw_log_format.h"
+
+struct RawLogLodHeader {
+    char magic[8] = {'H','A','L','O','L','O','D',0};
+    uint16_t version = 1;
+    uint16_t reserved = 0;
+    uint32_t channel_count = 0;
+    uint32_t factor = 0;
+    uint32_t buckets_per_block = 0;
+    uint64_t bucket_count = 0;
+};
+
+struct RawLogLodBucket {
+    uint32_t firstTick;
+    uint32_t lastTick;
+    uint16_t min;
+    uint16_t max;
+    uint16_t mean;
+};
+
+// Decimation factors of the stored levels, finest first
+constexpr uint32_t kRawLogLodFactors[] = {16, 256, 4096};
+
+// Sidecar path for one level of a log
+inline std::string rawLogLodPath(const std::string& logPath, uint32_t factor) {
+    return logPath + ".lod" + std::to_string(factor);
+}
+
+class RawLogPyramidWriter {
+public:
+    RawLogPyramidWriter();
+    ~RawLogPyramidWriter();
+    RawLogPyramidWriter(const RawLogPyramidWriter&) = delete;
+    RawLogPyramidWriter& operator=(const RawLogPyramidWriter&) = delete;
+
+    // Create (truncate) every level file for the log
+    bool open(const std::string& logPath, uint32_t channelCount);
+    // One record: samples ticks and channelCount * samples channel-major samples
+    void add(const uint32_t* timestamps, const uint16_t* waveform, uint32_t samples);
+    // Write new buckets of every level, then the headers
+    bool flush();
+    // Emit the partial last buckets, flush and close
+    void close();
+    bool isOpen() const { return !levels_.empty(); }
+
+private:
+    struct Level;
+
+    uint32_t addBuckets(const uint32_t* timestamps, const uint16_t* waveform, uint32_t samples, uint32_t pos);
+    void emit(size_t level);
+    void endBlockIfFull(Level& level);
+    bool writeBlock(Level& level);
+
+    uint32_t channelCount_;
+    std::vector<Level> levels_;
+};
+
+// Read side: the raw log plus whichever level files are next to it and
+// match it. Everything is memory-mapped and read in place, as of open().
+class RawLogPyramid {
+public:
+    RawLogPyramid();
+    ~RawLogPyramid();
+    RawLogPyramid(const RawLogPyramid&) = delete;
+    RawLogPyramid& operator=(const RawLogPyramid&) = delete;
+
+    // The log must open; missing or mismatched levels are left out. On
+    // failure error() says why.
+    bool open(const std::string& logPath);
+    void close();
+    const std::string& error() const { return log_.error(); }
+    const RawLogReader& log() const { return log_; }
+
+    // Factors available, 1 (the log itself) first
+    std::vector<uint32_t> factors() const;
+    // Coarsest available factor that still gives at least one bucket per
+    // pixel over this many samples
+    uint32_t factorFor(uint64_t samples, uint32_t pixels) const;
+
+    // Buckets of one channel overlapping ticks [startTick, endTick], at the
+    // level picked by factorFor for the span. Returns the factor used.
+    uint32_t query(uint32_t channel, uint32_t startTick, uint32_t endTick, uint32_t pixels,
+                   std::vector<RawLogLodBucket>& out) const;
+    // Same at a given factor; false if that level is not available
+    bool read(uint32_t factor, uint32_t channel, uint32_t startTick, uint32_t endTick,
+              std::vector<RawLogLodBucket>& out) const;
+
+private:
+    struct Level {
+        RawLogLodHeader header;
+        const uint8_t* data = nullptr;
+        size_t mappedBytes = 0;
+        size_t blockBytes = 0;
+    };
+
+    bool openLevel(const std::string& path, uint32_t factor, Level& level) const;
+    void readLevel(const Level& level, uint32_t channel, uint32_t startTick, uint32_t endTick,
+                   std::vector<RawLogLodBucket>& out) const;
+    void readLog(uint32_t channel, uint32_t startTick, uint32_t endTick, std::vector<RawLogLodBucket>& out) const;
+
+    RawLogReader log_;
+    std::vector<Level> levels_;  // Finest first
+};
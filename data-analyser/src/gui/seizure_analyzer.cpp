@@ -37,6 +37,8 @@ static const int kCfgChannelsPerPacket = 32;
 #include <chrono>
 #include <algorithm>
 
+#include "../core/raw_log_pyramid.h"
+
 SeizureAnalyzer::SeizureAnalyzer(QWidget *parent)
     : QMainWindow(parent)
     , centralWidget(nullptr)
@@ -471,20 +473,25 @@ bool SeizureAnalyzer::channelSelected(int channelIndex) const
 
 // --- Waveform dialog and raw loader ---
 
+// Intan 16-bit code to microvolts
+static float codeToUv(quint16 code) { return float(int(code) - 32768) * 0.195f; }
+
 class WaveformCanvas : public QWidget {
 public:
-    WaveformCanvas(const QVector<float>& data,
+    // buckets from RawLogPyramid::query; the seizure band is in ms from the
+    // window start, -1 for none
+    WaveformCanvas(const std::vector<RawLogLodBucket>& buckets,
                    int windowMs,
                    qint64 windowStartTickMs,
-                   int seizureStartIndex,
-                   int seizureEndIndex,
+                   qint64 seizureStartMs,
+                   qint64 seizureEndMs,
                    QWidget* parent = nullptr)
         : QWidget(parent)
-        , data_(data)
+        , buckets_(buckets)
         , windowMs_(windowMs)
         , windowStartTickMs_(windowStartTickMs)
-        , szStart_(seizureStartIndex)
-        , szEnd_(seizureEndIndex) {}
+        , szStartMs_(seizureStartMs)
+        , szEndMs_(seizureEndMs) {}
 
 protected:
     void paintEvent(QPaintEvent *) override {
@@ -492,11 +499,10 @@ protected:
         p.fillRect(rect(), Qt::white);
         p.setRenderHint(QPainter::Antialiasing);
 
-        if (data_.isEmpty()) return;
+        if (buckets_.empty() || windowMs_ <= 0) return;
 
         const int w = width();
         const int h = height();
-        const int n = data_.size();
 
         const int leftMargin = 40;
         const int rightMargin = 10;
@@ -515,34 +521,50 @@ protected:
                    plotRect.left(), plotRect.bottom());  // y-axis
 
         // Value range
-        float minv = data_.first();
-        float maxv = data_.first();
-        for (float v : data_) { minv = std::min(minv, v); maxv = std::max(maxv, v); }
+        float minv = codeToUv(buckets_.front().min);
+        float maxv = codeToUv(buckets_.front().max);
+        for (const RawLogLodBucket& b : buckets_) {
+            minv = std::min(minv, codeToUv(b.min));
+            maxv = std::max(maxv, codeToUv(b.max));
+        }
         if (maxv - minv < 1e-3f) { maxv = minv + 1.0f; }
 
         auto yscale = [&](float v) {
             return plotRect.bottom() - ((v - minv) / (maxv - minv)) * plotRect.height();
         };
+        // x of a tick (ms) in the window
+        auto xscale = [&](double tickMs) {
+            return plotRect.left() + ((tickMs - windowStartTickMs_) / windowMs_) * plotRect.width();
+        };
 
         // Shaded seizure region
-        if (szStart_ >= 0 && szEnd_ > szStart_ && szEnd_ < n) {
-            float x0 = plotRect.left() + (float(szStart_) / float(n - 1)) * plotRect.width();
-            float x1 = plotRect.left() + (float(szEnd_)   / float(n - 1)) * plotRect.width();
+        if (szStartMs_ >= 0 && szEndMs_ > szStartMs_ && szEndMs_ <= windowMs_) {
+            float x0 = xscale(windowStartTickMs_ + szStartMs_);
+            float x1 = xscale(windowStartTickMs_ + szEndMs_);
             QRectF szRect(QPointF(x0, plotRect.top()), QPointF(x1, plotRect.bottom()));
             QColor shade(255, 0, 0, 40);
             p.fillRect(szRect, shade);
         }
 
-        // Waveform
+        // Waveform: each bucket's min-max as a vertical stroke (an envelope
+        // when the level is decimated), its mean as the line through it
+        p.save();
+        p.setClipRect(plotRect);
+        p.setPen(QPen(QColor(120, 150, 230), 1.0));
         QPainterPath path;
-        path.moveTo(plotRect.left(), yscale(data_[0]));
-        for (int i = 1; i < n; ++i) {
-            float x = plotRect.left() + (float(i) / float(n - 1)) * plotRect.width();
-            path.lineTo(x, yscale(data_[i]));
+        for (size_t i = 0; i < buckets_.size(); ++i) {
+            const RawLogLodBucket& b = buckets_[i];
+            double x = xscale((double(b.firstTick) + double(b.lastTick)) / 2.0);
+            if (b.min != b.max) {
+                p.drawLine(QPointF(x, yscale(codeToUv(b.min))), QPointF(x, yscale(codeToUv(b.max))));
+            }
+            if (i == 0) path.moveTo(x, yscale(codeToUv(b.mean)));
+            else path.lineTo(x, yscale(codeToUv(b.mean)));
         }
 
         p.setPen(QPen(Qt::blue, 1.2));
         p.drawPath(path);
+        p.restore();
 
         // X-axis ticks (0, mid, end)
         p.setPen(Qt::black);
@@ -572,11 +594,9 @@ protected:
         drawYTick(maxv);
 
         // Label seizure start/end times near the top of the shaded region
-        if (szStart_ >= 0 && szEnd_ > szStart_ && szEnd_ < n) {
-            double msStart = (double(szStart_) / double(n)) * windowMs_;
-            double msEnd   = (double(szEnd_)   / double(n)) * windowMs_;
-            double absStart = windowStartTickMs_ + msStart;
-            double absEnd   = windowStartTickMs_ + msEnd;
+        if (szStartMs_ >= 0 && szEndMs_ > szStartMs_ && szEndMs_ <= windowMs_) {
+            double absStart = windowStartTickMs_ + szStartMs_;
+            double absEnd   = windowStartTickMs_ + szEndMs_;
             QString bandLabel = QString("%1 s → %2 s")
                                     .arg(absStart / 1000.0, 0, 'f', 3)
                                     .arg(absEnd / 1000.0,   0, 'f', 3);
@@ -593,57 +613,51 @@ protected:
     }
 
 private:
-    QVector<float> data_;
+    std::vector<RawLogLodBucket> buckets_;
     int windowMs_;
     qint64 windowStartTickMs_;
-    int szStart_;
-    int szEnd_;
+    qint64 szStartMs_;
+    qint64 szEndMs_;
 };
 
 class WaveformDialog : public QDialog {
 public:
-    WaveformDialog(const QVector<float>& data,
+    WaveformDialog(const std::vector<RawLogLodBucket>& buckets,
                    int windowMs,
                    qint64 windowStartTickMs,
-                   int seizureStartIndex,
-                   int seizureEndIndex,
+                   qint64 seizureStartMs,
+                   qint64 seizureEndMs,
                    QWidget* parent = nullptr)
         : QDialog(parent) {
         setModal(true);
         resize(800, 400);
         QVBoxLayout *layout = new QVBoxLayout(this);
         layout->setContentsMargins(8, 8, 8, 8);
-        layout->addWidget(new WaveformCanvas(data, windowMs, windowStartTickMs,
-                                             seizureStartIndex, seizureEndIndex, this));
+        layout->addWidget(new WaveformCanvas(buckets, windowMs, windowStartTickMs,
+                                             seizureStartMs, seizureEndMs, this));
     }
 };
 
+// Buckets of one channel for a windowMs window around detStart, at the
+// pyramid level that gives about one bucket per pixel (the raw samples
+// themselves for short windows)
 bool loadRawWindow(const QString& rawPath,
                    int channelIndex,
                    const QDateTime& detStart,
                    int windowMs,
-                   QVector<float>& out,
+                   int pixels,
+                   std::vector<RawLogLodBucket>& out,
                    qint64& windowStartMsOut,
                    QString& error)
 {
     out.clear();
-    QFile f(rawPath);
-    if (!f.open(QIODevice::ReadOnly)) {
-        error = QString("Cannot open raw file: %1").arg(rawPath);
-        return false;
-    }
-    QDataStream in(&f);
-    in.setByteOrder(QDataStream::LittleEndian);
-
-    char magic[8];
-    if (in.readRawData(magic, 8) != 8 || memcmp(magic, "HALOLOG", 7) != 0) {
-        error = "Bad magic in raw file";
+    RawLogPyramid pyramid;
+    if (!pyramid.open(rawPath.toStdString())) {
+        error = QString("Cannot open raw file: %1 (%2)").arg(rawPath, QString::fromStdString(pyramid.error()));
         return false;
     }
-    quint16 version, reserved;
-    quint32 channelCount, samplesPerRecord, sampleBits, tsBits;
-    in >> version >> reserved >> channelCount >> samplesPerRecord >> sampleBits >> tsBits;
-    if (channelIndex < 0 || channelIndex >= int(channelCount)) {
+    const RawLogFileHeader& header = pyramid.log().header();
+    if (channelIndex < 0 || channelIndex >= int(header.channel_count)) {
         error = "Channel out of range in raw file";
         return false;
     }
@@ -655,45 +669,8 @@ bool loadRawWindow(const QString& rawPath,
     qint64 endMs = startMs + windowMs;
     windowStartMsOut = startMs;
 
-    const quint64 recordSize = 8 /*ns*/ + 4 + 4 + 512 + (channelCount * samplesPerRecord * 2);
-    int firstRec = int(startMs / samplesPerRecord);
-    int lastRec = int(endMs / samplesPerRecord) + 1;
-
-    // skip to firstRec
-    quint64 headerSize = 8 + 2 + 2 + 4 + 4 + 4 + 4;
-    quint64 offset = headerSize + quint64(firstRec) * recordSize;
-    if (!f.seek(offset)) {
-        error = "Seek failed in raw file";
-        return false;
-    }
-
-    out.reserve((lastRec - firstRec) * int(samplesPerRecord));
-    for (int rec = firstRec; rec < lastRec; ++rec) {
-        quint64 ns; quint32 seq; quint32 payload;
-        in >> ns >> seq >> payload;
-        if (in.status() != QDataStream::Ok) break;
-
-        // ts
-        QVector<quint32> ts(samplesPerRecord);
-        for (quint32 i = 0; i < samplesPerRecord; ++i) in >> ts[i];
-        if (in.status() != QDataStream::Ok) break;
-
-        // wave
-        QVector<quint16> wave(channelCount * samplesPerRecord);
-        for (quint32 i = 0; i < channelCount * samplesPerRecord; ++i) in >> wave[i];
-        if (in.status() != QDataStream::Ok) break;
-
-        for (quint32 i = 0; i < samplesPerRecord; ++i) {
-            quint32 t = ts[i];
-            if (t < startMs || t > endMs) continue;
-            // Convert 16-bit Intan code to microvolts
-            int code = int(wave[channelIndex * samplesPerRecord + i]);
-            float uv = float(code - 32768) * 0.195f;
-            out.append(uv);
-        }
-    }
-
-    if (out.isEmpty()) {
+    pyramid.query(quint32(channelIndex), quint32(startMs), quint32(endMs), quint32(std::max(1, pixels)), out);
+    if (out.empty()) {
         error = "No samples found in window";
         return false;
     }
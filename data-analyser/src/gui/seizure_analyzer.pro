@@ -11,14 +11,27 @@ SOURCES += \
     ../core/hdf5_reader.cpp \
     ../core/fpga_logger.cpp \
     ../core/halo_response_decoder.cpp \
-    ../core/hdf5_writer.cpp
+    ../core/halo_reference_model.cpp \
+    ../core/hdf5_writer.cpp \
+    ../core/hourly_hdf5_sink.cpp \
+    ../core/raw_log_format.cpp \
+    ../core/log_time_index.cpp \
+    ../core/raw_log_codec.cpp \
+    ../core/raw_log_pyramid.cpp
 
 HEADERS += \
     seizure_analyzer.h \
     ../core/hdf5_reader.h \
     ../core/fpga_logger.h \
     ../core/halo_response_decoder.h \
-    ../core/hdf5_writer.h
+    ../core/halo_reference_model.h \
+    ../core/hdf5_writer.h \
+    ../core/hourly_hdf5_sink.h \
+    ../core/raw_log_format.h \
+    ../core/log_time_index.h \
+    ../core/raw_log_codec.h \
+    ../core/raw_log_pyramid.h \
+    ../core/raw_io_util.h
 
 # FORMS += \
 #     seizure_analyzer.ui
@@ -0,0 +1,87 @@
+#include "../src/core/halo_reference_model.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Checks every HALO reference model kernel against the scalar one over the
+// same frame stream, then reports frames/sec against the real-time rate.
+//
+//   make bench_halo_reference_model && ./data-analyser/tests/bench_halo_reference_model
+
+namespace {
+constexpr size_t kSamplesPerFrame = 128;
+// The model runs on the decimated ASIC stream, not the 30 kHz acquisition
+constexpr double kAsicSampleRate = 1000.0;
+constexpr int kFrames = 64;
+constexpr int kIterations = 200;
+
+std::vector<uint8_t> makeFrames(size_t lanes) {
+    std::vector<uint8_t> data(kFrames * kSamplesPerFrame * lanes);
+    for (size_t i = 0; i < data.size(); ++i) {
+        // Noise around mid-scale with occasional large excursions
+        int v = 128 + rand() % 17 - 8;
+        if (rand() % 50 == 0) {
+            v = rand() % 256;
+        }
+        data[i] = static_cast<uint8_t>(v);
+    }
+    return data;
+}
+
+bool sameResults(const HaloReferenceResult& a, const HaloReferenceResult& b) {
+    return a.detected == b.detected && a.firingChannels == b.firingChannels && a.gated == b.gated &&
+           a.channelPeak == b.channelPeak && a.channelFired == b.channelFired;
+}
+} // namespace
+
+int main() {
+    srand(1234);
+    int failures = 0;
+    HaloReferenceModel probe;
+    printf("HALO pipeline 6 reference model (dispatch picks: %s)\n", probe.kernelName());
+    printf("%-8s %6s %3s %16s %14s\n", "kernel", "lanes", "k", "frames/s", "x real time");
+
+    // 32 lanes = one RHD2132, 8 streams = 256 lanes; 36 exercises the scalar tail
+    for (size_t lanes : {32, 36, 256}) {
+        for (int k : {1, 2}) {
+            std::vector<uint8_t> frames = makeFrames(lanes);
+            const size_t frameBytes = kSamplesPerFrame * lanes;
+
+            for (HaloKernelIsa isa : {HaloKernelIsa::Scalar, HaloKernelIsa::AVX2, HaloKernelIsa::NEON}) {
+                HaloReferenceModel model;
+                HaloReferenceModel reference;
+                if (!model.useKernel(isa)) {
+                    continue;
+                }
+                reference.useKernel(HaloKernelIsa::Scalar);
+                model.configure(lanes, k);
+                reference.configure(lanes, k);
+
+                bool ok = true;
+                for (int f = 0; f < kFrames && ok; ++f) {
+                    const uint8_t* frame = frames.data() + f * frameBytes;
+                    ok = sameResults(model.process(frame, frameBytes), reference.process(frame, frameBytes));
+                }
+                if (!ok) {
+                    printf("%-8s %6zu %3d MISMATCH against scalar reference\n", model.kernelName(), lanes, k);
+                    ++failures;
+                    continue;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < kIterations; ++i) {
+                    for (int f = 0; f < kFrames; ++f) {
+                        model.process(frames.data() + f * frameBytes, frameBytes);
+                    }
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                double framesPerSecond = (double)kFrames * kIterations / seconds;
+                // Real time at 1 kHz is 1000 / 128 frames per second
+                printf("%-8s %6zu %3d %16.0f %14.0f\n", model.kernelName(), lanes, k, framesPerSecond,
+                       framesPerSecond / (kAsicSampleRate / kSamplesPerFrame));
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+#include "../src/core/hdf5_writer.h"
+#include <hdf5.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Writes the same frames with each Hdf5Writer compression setting, then
+// reads them back to check them and reports write throughput and
+// compression ratio (uncompressed codes + float32 bytes / file size).
+//
+// With a path, frames come from an existing log, e.g. one of FpgaLogger's
+// hourly files; without one, from a synthetic recording in the same 36-signal
+// layout (LFP-like random walk + noise + spikes on 32 channels, 4 metadata).
+//
+//   make bench_hdf5_compression && ./data-analyser/tests/bench_hdf5_compression [data-analyser/logs/.../hour_HH.h5]
+
+namespace {
+constexpr int kSyntheticFrames = 200000;
+constexpr size_t kSignals = 36;
+const char* kOutputPath = "/tmp/bench_hdf5_compression.h5";
+
+struct Frames {
+    size_t signals = 0;
+    size_t rows = 0;
+    std::vector<uint16_t> codes;
+    std::vector<float> microvolts;
+};
+
+struct Config {
+    const char* name;
+    Hdf5Compression codes;
+    Hdf5Compression uv;
+    bool storeMicrovolts;
+};
+
+// Same scaling as FpgaLogger: uint8 sample << 8, uV = sample * 8 - 1000
+Frames makeSynthetic() {
+    Frames f;
+    f.signals = kSignals;
+    f.rows = kSyntheticFrames;
+    f.codes.resize(f.rows * f.signals);
+    f.microvolts.resize(f.rows * f.signals);
+    std::vector<double> lfp(32, 0.0);
+    srand(1234);
+    for (size_t r = 0; r < f.rows; ++r) {
+        uint16_t* codes = &f.codes[r * f.signals];
+        float* uv = &f.microvolts[r * f.signals];
+        for (int ch = 0; ch < 32; ++ch) {
+            lfp[ch] = 0.98 * lfp[ch] + (rand() % 21 - 10);
+            double v = 128 + lfp[ch] / 4 + (rand() % 7 - 3) + (rand() % 500 == 0 ? 60 : 0);
+            uint8_t sample = static_cast<uint8_t>(std::max(0.0, std::min(255.0, v)));
+            codes[ch] = static_cast<uint16_t>(sample) << 8;
+            uv[ch] = sample * 8.0f - 1000.0f;
+        }
+        bool seizure = (r / 5000) % 10 == 7;
+        double confidence = seizure ? 0.8 : (rand() % 300) / 1000.0;
+        codes[32] = static_cast<uint16_t>(rand() % 256);
+        uv[32] = static_cast<float>(rand() % 1000) / 10.0f;
+        codes[33] = seizure ? 0 : 2;
+        uv[33] = static_cast<float>(r % 1000) / 1000.0f;
+        codes[34] = static_cast<uint16_t>(confidence * 65535);
+        uv[34] = static_cast<float>(confidence);
+        codes[35] = static_cast<uint16_t>(confidence * 1000);
+        uv[35] = static_cast<float>(confidence);
+    }
+    return f;
+}
+
+bool loadLog(const char* path, Frames& f) {
+    hid_t file = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (file < 0) return false;
+    hid_t dset = H5Dopen2(file, "/samples_codes", H5P_DEFAULT);
+    bool ok = dset >= 0;
+    if (ok) {
+        hid_t space = H5Dget_space(dset);
+        hsize_t dims[2] = {0, 0};
+        ok = H5Sget_simple_extent_ndims(space) == 2 && H5Sget_simple_extent_dims(space, dims, nullptr) >= 0 &&
+             dims[0] > 0;
+        H5Sclose(space);
+        f.rows = dims[0];
+        f.signals = dims[1];
+        f.codes.resize(f.rows * f.signals);
+        f.microvolts.resize(f.rows * f.signals);
+        ok = ok && H5Dread(dset, H5T_NATIVE_UINT16, H5S_ALL, H5S_ALL, H5P_DEFAULT, f.codes.data()) >= 0;
+        H5Dclose(dset);
+    }
+    hid_t dsetUv = ok && H5Lexists(file, "/samples_uV", H5P_DEFAULT) > 0 ? H5Dopen2(file, "/samples_uV", H5P_DEFAULT) : -1;
+    if (dsetUv >= 0) {
+        ok = H5Dread(dsetUv, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, f.microvolts.data()) >= 0;
+        H5Dclose(dsetUv);
+    } else {
+        for (size_t i = 0; i < f.codes.size(); ++i) {
+            f.microvolts[i] = (f.codes[i] >> 8) * 8.0f - 1000.0f;
+        }
+    }
+    H5Fclose(file);
+    return ok;
+}
+
+const char* filterName(Hdf5Filter filter) {
+    switch (filter) {
+        case Hdf5Filter::None: return "none";
+        case Hdf5Filter::ShuffleDeflate: return "shuffle+deflate";
+        case Hdf5Filter::Lz4: return "shuffle+lz4";
+    }
+    return "?";
+}
+
+// Codes read back must match bit for bit; microvolts too when stored, and
+// the neural channels' microvolts derived from the scale attributes otherwise
+bool verify(const Frames& f, bool storeMicrovolts) {
+    hid_t file = H5Fopen(kOutputPath, H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (file < 0) return false;
+    std::vector<uint16_t> codes(f.codes.size());
+    hid_t dset = H5Dopen2(file, "/samples_codes", H5P_DEFAULT);
+    bool ok = H5Dread(dset, H5T_NATIVE_UINT16, H5S_ALL, H5S_ALL, H5P_DEFAULT, codes.data()) >= 0 && codes == f.codes;
+    H5Dclose(dset);
+    if (ok && storeMicrovolts) {
+        std::vector<float> microvolts(f.microvolts.size());
+        hid_t dsetUv = H5Dopen2(file, "/samples_uV", H5P_DEFAULT);
+        ok = H5Dread(dsetUv, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, microvolts.data()) >= 0 &&
+             microvolts == f.microvolts;
+        H5Dclose(dsetUv);
+    } else if (ok) {
+        std::vector<float> scale(f.signals);
+        std::vector<float> offset(f.signals);
+        hid_t dsetC = H5Dopen2(file, "/samples_codes", H5P_DEFAULT);
+        hid_t attrScale = H5Aopen(dsetC, "uV_scale", H5P_DEFAULT);
+        hid_t attrOffset = H5Aopen(dsetC, "uV_offset", H5P_DEFAULT);
+        ok = H5Aread(attrScale, H5T_NATIVE_FLOAT, scale.data()) >= 0 &&
+             H5Aread(attrOffset, H5T_NATIVE_FLOAT, offset.data()) >= 0;
+        H5Aclose(attrScale);
+        H5Aclose(attrOffset);
+        H5Dclose(dsetC);
+        for (size_t i = 0; ok && i < codes.size(); ++i) {
+            size_t signal = i % f.signals;
+            ok = signal >= 32 || codes[i] * scale[signal] + offset[signal] == f.microvolts[i];
+        }
+    }
+    H5Fclose(file);
+    return ok;
+}
+
+bool run(const Config& config, const Frames& f) {
+    Hdf5WriterOptions options;
+    options.codesCompression = config.codes;
+    options.uvCompression = config.uv;
+    options.storeMicrovolts = config.storeMicrovolts;
+    if (!config.storeMicrovolts) {
+        options.uvScale = {8.0f / 256.0f};
+        options.uvOffset = {-1000.0f};
+    }
+    Hdf5Writer writer(options);
+    IntanHeaderInfo info = {0x464741, 1, static_cast<uint32_t>(f.signals), 1000};
+
+    std::vector<uint16_t> codes(f.signals);
+    std::vector<float> microvolts(f.signals);
+    auto start = std::chrono::steady_clock::now();
+    if (!writer.open(kOutputPath, info)) {
+        printf("%-28s open failed\n", config.name);
+        return false;
+    }
+    for (size_t r = 0; r < f.rows; ++r) {
+        codes.assign(f.codes.begin() + r * f.signals, f.codes.begin() + (r + 1) * f.signals);
+        microvolts.assign(f.microvolts.begin() + r * f.signals, f.microvolts.begin() + (r + 1) * f.signals);
+        if (!writer.appendFrame(codes, microvolts)) {
+            printf("%-28s append failed\n", config.name);
+            return false;
+        }
+    }
+    Hdf5Filter codesFilter = writer.codesFilter();
+    Hdf5Filter uvFilter = writer.uvFilter();
+    writer.close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double rawBytes = static_cast<double>(f.rows * f.signals) * (sizeof(uint16_t) + sizeof(float));
+    double fileBytes = static_cast<double>(std::filesystem::file_size(kOutputPath));
+    bool ok = verify(f, config.storeMicrovolts);
+    printf("%-28s %8.0f frames/s %7.1f MB/s  %8.2f MB  ratio %5.2fx  (codes %s, uV %s)  %s\n", config.name,
+           f.rows / seconds, rawBytes / seconds / 1e6, fileBytes / 1e6, rawBytes / fileBytes, filterName(codesFilter),
+           config.storeMicrovolts ? filterName(uvFilter) : "derived", ok ? "ok" : "MISMATCH");
+    return ok;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    Frames frames;
+    if (argc > 1) {
+        if (!loadLog(argv[1], frames)) {
+            fprintf(stderr, "Cannot read /samples_codes from %s\n", argv[1]);
+            return 1;
+        }
+        printf("Hdf5Writer compression, %zu frames x %zu signals from %s\n", frames.rows, frames.signals, argv[1]);
+    } else {
+        frames = makeSynthetic();
+        printf("Hdf5Writer compression, %zu synthetic frames x %zu signals\n", frames.rows, frames.signals);
+    }
+
+    const Hdf5Compression none;
+    const Hdf5Compression deflate1 = {Hdf5Filter::ShuffleDeflate, 1};
+    const Hdf5Compression deflate4 = {Hdf5Filter::ShuffleDeflate, 4};
+    const Hdf5Compression deflate9 = {Hdf5Filter::ShuffleDeflate, 9};
+    const Hdf5Compression lz4 = {Hdf5Filter::Lz4, 4};  // Level used only if the plugin is missing
+    const Config configs[] = {
+        {"uncompressed", none, none, true},
+        {"shuffle+deflate 1", deflate1, deflate1, true},
+        {"shuffle+deflate 4", deflate4, deflate4, true},
+        {"shuffle+deflate 9", deflate9, deflate9, true},
+        {"shuffle+lz4", lz4, lz4, true},
+        {"codes only", none, none, false},
+        {"codes only, deflate 4", deflate4, none, false},
+        {"codes only, lz4", lz4, none, false},
+    };
+    int failures = 0;
+    for (const Config& config : configs) {
+        failures += run(config, frames) ? 0 : 1;
+    }
+    std::filesystem::remove(kOutputPath);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+#include "../src/core/raw_log_codec.h"
+#include "../src/core/raw_log_format.h"
+#include "../src/core/raw_log_pyramid.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+// Encodes and decodes HALOLOG v2 records with each codec kernel set on a few
+// kinds of signal, checks every record round-trips exactly, and reports
+// throughput (in v1 bytes, i.e. raw data) and compression ratio against v1.
+// Then writes the same hour as v1 and v2 logs and checks that RawLogReader
+// returns identical records from both.
+//
+//   make bench_raw_log_codec && ./data-analyser/tests/bench_raw_log_codec [records]
+
+namespace {
+constexpr uint32_t kChannels = 32;
+constexpr uint32_t kSamples = kRawLogCodecSamples;
+constexpr size_t kV1RecordBytes = 16 + kSamples * 4 + kChannels * kSamples * 2;
+const char* kV1Path = "/tmp/bench_raw_log_codec_v1.log";
+const char* kV2Path = "/tmp/bench_raw_log_codec_v2.log";
+
+struct Block {
+    std::vector<uint32_t> timestamps;
+    std::vector<uint16_t> waveform;
+};
+
+// Amplifier codes around 32768 (0.195 uV per code): a slow 200 uV drift,
+// Gaussian noise and, optionally, a 150 uV spike in 5% of blocks, per channel
+std::vector<Block> neuralBlocks(size_t records, double noiseUv, bool spikes) {
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0.0, noiseUv / 0.195);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<Block> blocks(records);
+    std::vector<double> phase(kChannels);
+    for (uint32_t c = 0; c < kChannels; ++c) phase[c] = uniform(rng) * 6.283;
+    for (size_t r = 0; r < records; ++r) {
+        Block& block = blocks[r];
+        block.timestamps.resize(kSamples);
+        block.waveform.resize(kChannels * kSamples);
+        for (uint32_t i = 0; i < kSamples; ++i) block.timestamps[i] = static_cast<uint32_t>(r * kSamples + i);
+        for (uint32_t c = 0; c < kChannels; ++c) {
+            int spikeAt = spikes && uniform(rng) < 0.05 ? int(uniform(rng) * (kSamples - 8)) : -100;
+            for (uint32_t i = 0; i < kSamples; ++i) {
+                double t = double(r * kSamples + i) / 1000.0;
+                double code = 200.0 / 0.195 * std::sin(0.5 * t + phase[c]) + noise(rng);
+                int k = int(i) - spikeAt;
+                if (k >= 0 && k < 8) code -= 150.0 / 0.195 * std::sin(3.1416 * k / 8);
+                block.waveform[c * kSamples + i] = static_cast<uint16_t>(std::lround(32768.0 + code));
+            }
+        }
+    }
+    return blocks;
+}
+
+// White noise over the whole code range: the codec's worst case
+std::vector<Block> randomBlocks(size_t records) {
+    std::mt19937 rng(11);
+    std::vector<Block> blocks(records);
+    for (size_t r = 0; r < records; ++r) {
+        blocks[r].timestamps.resize(kSamples);
+        blocks[r].waveform.resize(kChannels * kSamples);
+        for (uint32_t i = 0; i < kSamples; ++i) blocks[r].timestamps[i] = rng();
+        for (uint16_t& sample : blocks[r].waveform) sample = static_cast<uint16_t>(rng());
+    }
+    return blocks;
+}
+
+bool runCodec(const char* signal, const std::vector<Block>& blocks, const RawLogCodecKernels& kernels) {
+    std::vector<uint8_t> encoded(blocks.size() * rawLogCodecMaxPayload(kChannels));
+    std::vector<size_t> sizes(blocks.size());
+
+    auto start = std::chrono::steady_clock::now();
+    size_t offset = 0;
+    for (size_t r = 0; r < blocks.size(); ++r) {
+        sizes[r] = rawLogEncodeRecord(blocks[r].timestamps.data(), blocks[r].waveform.data(), kChannels,
+                                      encoded.data() + offset, kernels);
+        offset += sizes[r];
+    }
+    double encodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<uint32_t> ts(kSamples);
+    std::vector<uint16_t> wf(kChannels * kSamples);
+    bool ok = true;
+    double decodeSeconds = 0;
+    offset = 0;
+    for (size_t r = 0; r < blocks.size(); ++r) {
+        ok = ok && rawLogValidatePayload(encoded.data() + offset, sizes[r], kChannels);
+        auto t0 = std::chrono::steady_clock::now();
+        rawLogDecodeRecord(encoded.data() + offset, kChannels, ts.data(), wf.data(), kernels);
+        decodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        ok = ok && ts == blocks[r].timestamps && wf == blocks[r].waveform;
+        offset += sizes[r];
+    }
+
+    double rawBytes = double(blocks.size()) * kV1RecordBytes;
+    double v2Bytes = double(offset) + 16.0 * blocks.size();
+    printf("%-14s %-7s encode %7.0f MB/s  decode %7.0f MB/s  %6.0f B/record  ratio %5.2fx  %s\n", signal, kernels.name,
+           rawBytes / encodeSeconds / 1e6, rawBytes / decodeSeconds / 1e6, v2Bytes / blocks.size(),
+           rawBytes / v2Bytes, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+bool writeLog(const char* path, uint16_t version, const std::vector<Block>& blocks) {
+    RawLogWriterOptions options;
+    options.version = version;
+    RawLogWriter writer(options);
+    if (!writer.open(path)) return false;
+    for (size_t r = 0; r < blocks.size(); ++r) {
+        if (!writer.append(1766188800000000000ULL + r * 128000000ULL, blocks[r].timestamps, blocks[r].waveform)) {
+            return false;
+        }
+    }
+    writer.close();
+    return true;
+}
+
+// Both logs through RawLogReader, record by record and by lookup
+bool compareLogs(const std::vector<Block>& blocks) {
+    RawLogReader v1, v2;
+    if (!v1.open(kV1Path) || !v2.open(kV2Path)) {
+        printf("open failed: %s%s\n", v1.error().c_str(), v2.error().c_str());
+        return false;
+    }
+    bool ok = v1.recordCount() == blocks.size() && v2.recordCount() == blocks.size() && v2.header().version == 2 &&
+              v2.timeIndex() != nullptr;
+    for (size_t r = 0; ok && r < blocks.size(); ++r) {
+        RawLogRecordView a = v1.record(r);
+        RawLogRecordView b = v2.record(r);
+        ok = a.unixTimeNs() == b.unixTimeNs() && a.sequenceIndex() == b.sequenceIndex() &&
+             std::memcmp(a.timestamps(), b.timestamps(), kSamples * 4) == 0 &&
+             std::memcmp(a.waveform(), b.waveform(), kChannels * kSamples * 2) == 0;
+    }
+    for (size_t i = 0; ok && i < 2000; ++i) {
+        uint32_t tick = static_cast<uint32_t>(rand()) % static_cast<uint32_t>(blocks.size() * kSamples);
+        uint64_t ns = 1766188800000000000ULL + uint64_t(tick) * 1000000ULL;
+        uint32_t seq = static_cast<uint32_t>(rand()) % static_cast<uint32_t>(blocks.size());
+        ok = v1.findByTick(tick) == v2.findByTick(tick) && v1.findByTime(ns) == v2.findByTime(ns) &&
+             v1.findBySequence(seq) == v2.findBySequence(seq);
+    }
+    return ok;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t records = argc > 1 ? static_cast<size_t>(std::max(1L, std::atol(argv[1]))) : 28125;  // One hour
+
+    printf("HALOLOG v2 codec, %zu records (%.1f MB as v1)\n", records, records * kV1RecordBytes / 1e6);
+    std::vector<Block> neural = neuralBlocks(records, 10.0, true);
+    std::vector<Block> quiet = neuralBlocks(records, 3.0, false);
+    std::vector<Block> random = randomBlocks(records / 4 + 1);
+    bool ok = true;
+    for (RawLogCodecIsa isa : {RawLogCodecIsa::Scalar, RawLogCodecIsa::SSE2, RawLogCodecIsa::NEON}) {
+        const RawLogCodecKernels* kernels = rawLogCodecKernelsFor(isa);
+        if (!kernels) continue;
+        ok = runCodec("neural 10 uV", neural, *kernels) && ok;
+        ok = runCodec("quiet 3 uV", quiet, *kernels) && ok;
+        ok = runCodec("white noise", random, *kernels) && ok;
+    }
+
+    bool written = writeLog(kV1Path, 1, neural) && writeLog(kV2Path, 2, neural);
+    bool same = written && compareLogs(neural);
+    if (written) {
+        double v1Bytes = double(std::filesystem::file_size(kV1Path));
+        double v2Bytes = double(std::filesystem::file_size(kV2Path));
+        printf("log files: v1 %.1f MB, v2 %.1f MB (%.2fx); RawLogReader v1 vs v2: %s\n", v1Bytes / 1e6, v2Bytes / 1e6,
+               v1Bytes / v2Bytes, same ? "ok" : "MISMATCH");
+    } else {
+        printf("writing the logs failed\n");
+    }
+    ok = ok && same;
+
+    for (const char* path : {kV1Path, kV2Path}) {
+        std::filesystem::remove(path);
+        std::filesystem::remove(timeIndexPath(path));
+        for (uint32_t factor : kRawLogLodFactors) std::filesystem::remove(rawLogLodPath(path, factor));
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+#include "../src/core/raw_log_pyramid.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+// Writes an hour of raw log (1 kHz ticks, with a dropout) with its LOD
+// pyramid, checks every level of a few channels against buckets rebuilt from
+// the log, then times pulling windows from one second to the whole hour at
+// 1000 pixels, at the level the query picks and from every sample.
+//
+//   make bench_raw_log_pyramid && ./data-analyser/tests/bench_raw_log_pyramid [records]
+
+namespace {
+constexpr uint32_t kSamples = 128;
+constexpr uint32_t kChannels = 32;
+constexpr uint32_t kPixels = 1000;
+const char* kPath = "/tmp/bench_raw_log_pyramid.log";
+
+void writeLog(size_t records) {
+    RawLogWriter writer;
+    writer.open(kPath);
+    std::vector<uint32_t> ts(kSamples);
+    std::vector<uint16_t> wf(kChannels * kSamples);
+    srand(3);
+    uint32_t tick = 0;
+    for (size_t r = 0; r < records; ++r) {
+        if (r == records / 2) tick += 5000 * kSamples;
+        for (uint32_t i = 0; i < kSamples; ++i) ts[i] = tick + i;
+        for (uint32_t c = 0; c < kChannels; ++c) {
+            for (uint32_t i = 0; i < kSamples; ++i) {
+                double slow = 2000.0 * std::sin((tick + i) * 0.0005 + c);
+                wf[c * kSamples + i] = static_cast<uint16_t>(32768 + int(slow) + rand() % 200 - 100);
+            }
+        }
+        writer.append(1766188800000000000ULL + uint64_t(tick) * 1000000ULL, ts, wf);
+        tick += kSamples;
+    }
+    writer.close();
+}
+
+// Buckets of one level rebuilt from the log's samples
+std::vector<RawLogLodBucket> expectedBuckets(const RawLogReader& log, uint32_t channel, uint32_t factor) {
+    std::vector<RawLogLodBucket> buckets;
+    uint32_t count = 0;
+    uint64_t sum = 0;
+    for (size_t rec = 0; rec < log.recordCount(); ++rec) {
+        RawLogRecordView view = log.record(rec);
+        for (uint32_t i = 0; i < kSamples; ++i) {
+            uint16_t v = view.channel(channel)[i];
+            if (count == 0) buckets.push_back({view.timestamps()[i], 0, v, v, 0});
+            RawLogLodBucket& b = buckets.back();
+            b.lastTick = view.timestamps()[i];
+            b.min = std::min(b.min, v);
+            b.max = std::max(b.max, v);
+            sum += v;
+            if (++count == factor) {
+                b.mean = static_cast<uint16_t>((sum + count / 2) / count);
+                count = 0;
+                sum = 0;
+            }
+        }
+    }
+    if (count > 0) buckets.back().mean = static_cast<uint16_t>((sum + count / 2) / count);
+    return buckets;
+}
+
+bool same(const RawLogLodBucket& a, const RawLogLodBucket& b) {
+    return a.firstTick == b.firstTick && a.lastTick == b.lastTick && a.min == b.min && a.max == b.max &&
+           a.mean == b.mean;
+}
+
+bool checkLevels(const RawLogPyramid& pyramid) {
+    std::vector<RawLogLodBucket> got;
+    for (uint32_t channel : {0u, 7u, 31u}) {
+        for (uint32_t factor : kRawLogLodFactors) {
+            std::vector<RawLogLodBucket> expected = expectedBuckets(pyramid.log(), channel, factor);
+            if (!pyramid.read(factor, channel, 0, UINT32_MAX, got) || got.size() != expected.size() ||
+                !std::equal(got.begin(), got.end(), expected.begin(), same)) {
+                printf("level %u of channel %u: %zu buckets, expected %zu\n", factor, channel, got.size(),
+                       expected.size());
+                return false;
+            }
+            // A sub-range returns exactly the buckets overlapping it
+            for (int i = 0; i < 200; ++i) {
+                uint32_t last = expected.back().lastTick;
+                uint32_t start = static_cast<uint32_t>(rand()) % (last + 1);
+                uint32_t end = start + static_cast<uint32_t>(rand()) % (last / 4 + 1);
+                pyramid.read(factor, channel, start, end, got);
+                std::vector<RawLogLodBucket> overlap;
+                for (const RawLogLodBucket& b : expected) {
+                    if (b.lastTick >= start && b.firstTick <= end) overlap.push_back(b);
+                }
+                if (got.size() != overlap.size() || !std::equal(got.begin(), got.end(), overlap.begin(), same)) {
+                    printf("level %u of channel %u: range [%u, %u] mismatch\n", factor, channel, start, end);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+template <typename F>
+double timeUs(int repeats, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; ++i) f();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t records = argc > 1 ? static_cast<size_t>(std::max(2L, std::atol(argv[1]))) : 28125;  // One hour
+    auto start = std::chrono::steady_clock::now();
+    writeLog(records);
+    double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    RawLogPyramid pyramid;
+    if (!pyramid.open(kPath)) {
+        printf("open failed: %s\n", pyramid.error().c_str());
+        return 1;
+    }
+    double logBytes = double(std::filesystem::file_size(kPath));
+    double lodBytes = 0;
+    for (uint32_t factor : kRawLogLodFactors) lodBytes += double(std::filesystem::file_size(rawLogLodPath(kPath, factor)));
+    printf("RawLogPyramid, %zu records (%.1f MB log, %.1f MB of levels), written in %.2f s\n", records, logBytes / 1e6,
+           lodBytes / 1e6, writeSeconds);
+
+    bool ok = pyramid.factors() == std::vector<uint32_t>{1, 16, 256, 4096};
+    ok = ok && checkLevels(pyramid);
+    printf("levels 16x/256x/4096x vs rebuilt from the log: %s\n", ok ? "ok" : "MISMATCH");
+
+    // Windows ending at the last sample, channel 7
+    uint32_t end = static_cast<uint32_t>((records + 5000) * kSamples - 1);
+    std::vector<RawLogLodBucket> buckets, raw;
+    for (uint32_t span : {1000u, 60000u, 600000u, 3600000u}) {
+        if (span > end) continue;
+        uint32_t from = end - span + 1;
+        uint32_t factor = 0;
+        double queryUs = timeUs(20, [&] { factor = pyramid.query(7, from, end, kPixels, buckets); });
+        double rawUs = timeUs(2, [&] { pyramid.read(1, 7, from, end, raw); });
+        // Bytes a reader has to touch: each bucket is 2 ticks + min/max/mean
+        double touched = factor == 1 ? double(raw.size()) * 2 : double(buckets.size()) * 14;
+        printf("%7u ms at %u px: %5ux, %6zu buckets, %9.1f us, ~%8.1f KB  (every sample: %9.1f us)\n", span, kPixels,
+               factor, buckets.size(), queryUs, touched / 1e3, rawUs);
+        ok = ok && buckets.size() >= std::min<size_t>(kPixels, raw.size());
+    }
+
+    pyramid.close();
+    std::filesystem::remove(kPath);
+    std::filesystem::remove(timeIndexPath(kPath));
+    for (uint32_t factor : kRawLogLodFactors) std::filesystem::remove(rawLogLodPath(kPath, factor));
+    return ok ? 0 : 1;
+}
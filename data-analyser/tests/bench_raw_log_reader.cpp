@@ -0,0 +1,171 @@
+#include "../src/core/raw_log_format.h"
+#include "../src/core/raw_log_pyramid.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// Writes an hour of raw log (1 kHz ticks, 128 per record) with a dropout in
+// the middle, then checks RawLogReader's lookups by sequence, time and tick
+// against a linear scan, with and without the .idx time index, and times
+// pulling one channel over a one-minute window, against a seek-and-stream
+// read like the GUI's old loadRawWindow.
+//
+//   make bench_raw_log_reader && ./data-analyser/tests/bench_raw_log_reader [records]
+
+namespace {
+constexpr uint32_t kSamples = 128;
+constexpr uint32_t kChannels = 32;
+constexpr uint64_t kStartNs = 1766188800000000000ULL;  // 2025-12-20 00:00 UTC
+constexpr uint64_t kNsPerTick = 1000000;
+const char* kPath = "/tmp/bench_raw_log_reader.log";
+
+struct Expected {
+    std::vector<uint32_t> firstTick;
+    std::vector<uint64_t> timeNs;
+};
+
+// Records are numbered consecutively, but a dropout leaves a gap in time
+Expected writeLog(size_t records) {
+    Expected expected;
+    RawLogWriter writer;
+    writer.open(kPath);
+    std::vector<uint32_t> ts(kSamples);
+    std::vector<uint16_t> wf(kChannels * kSamples);
+    uint32_t tick = 0;
+    for (size_t r = 0; r < records; ++r) {
+        if (r == records / 2) tick += 5000 * kSamples;
+        for (uint32_t i = 0; i < kSamples; ++i) ts[i] = tick + i;
+        for (uint32_t i = 0; i < wf.size(); ++i) wf[i] = static_cast<uint16_t>(32768 + (tick + i) % 1000);
+        expected.firstTick.push_back(tick);
+        expected.timeNs.push_back(kStartNs + uint64_t(tick) * kNsPerTick);
+        writer.append(expected.timeNs.back(), ts, wf);
+        tick += kSamples;
+    }
+    writer.close();
+    return expected;
+}
+
+template <typename T>
+size_t lastAtOrBefore(const std::vector<T>& keys, T target) {
+    auto it = std::upper_bound(keys.begin(), keys.end(), target);
+    return it == keys.begin() ? 0 : size_t(it - keys.begin()) - 1;
+}
+
+bool checkLookups(const RawLogReader& reader, const Expected& expected) {
+    if (reader.recordCount() != expected.firstTick.size()) return false;
+    srand(42);
+    uint32_t lastTick = expected.firstTick.back() + kSamples;
+    for (int i = 0; i < 20000; ++i) {
+        uint32_t tick = static_cast<uint32_t>(rand()) % (lastTick + 1000);
+        uint64_t ns = kStartNs - 1000 + uint64_t(rand()) * rand() % (uint64_t(lastTick) * kNsPerTick);
+        uint32_t seq = static_cast<uint32_t>(rand()) % (reader.recordCount() + 10);
+        size_t expectedSeq = seq < reader.recordCount() ? seq : reader.recordCount();
+        if (reader.findByTick(tick) != lastAtOrBefore(expected.firstTick, tick) ||
+            reader.findByTime(ns) != lastAtOrBefore(expected.timeNs, ns) ||
+            reader.findBySequence(seq) != expectedSeq) {
+            printf("lookup mismatch at tick %u, time %llu, sequence %u\n", tick, (unsigned long long)ns, seq);
+            return false;
+        }
+    }
+    return true;
+}
+
+// One channel's microvolts for ticks [start, end]
+void pullMapped(const RawLogReader& reader, uint32_t channel, uint32_t start, uint32_t end, std::vector<float>& out) {
+    out.clear();
+    for (size_t rec = reader.findByTick(start); rec < reader.recordCount(); ++rec) {
+        RawLogRecordView view = reader.record(rec);
+        const uint32_t* ts = view.timestamps();
+        if (ts[0] > end) break;
+        const uint16_t* wave = view.channel(channel);
+        for (uint32_t i = 0; i < kSamples; ++i) {
+            if (ts[i] < start || ts[i] > end) continue;
+            out.push_back(float(int(wave[i]) - 32768) * 0.195f);
+        }
+    }
+}
+
+// Seek to the record by position, then read value by value into per-record
+// temporaries, as the QDataStream version did
+void pullStreamed(uint32_t channel, uint32_t start, uint32_t end, std::vector<float>& out) {
+    out.clear();
+    std::ifstream in(kPath, std::ios::binary);
+    const size_t recordSize = 16 + kSamples * 4 + kChannels * kSamples * 2;
+    in.seekg(28 + std::streamoff(start / kSamples) * recordSize);
+    for (;;) {
+        uint64_t ns;
+        uint32_t seq, payload;
+        in.read(reinterpret_cast<char*>(&ns), 8);
+        in.read(reinterpret_cast<char*>(&seq), 4);
+        in.read(reinterpret_cast<char*>(&payload), 4);
+        std::vector<uint32_t> ts(kSamples);
+        for (uint32_t i = 0; i < kSamples; ++i) in.read(reinterpret_cast<char*>(&ts[i]), 4);
+        std::vector<uint16_t> wave(kChannels * kSamples);
+        for (size_t i = 0; i < wave.size(); ++i) in.read(reinterpret_cast<char*>(&wave[i]), 2);
+        if (!in || ts[0] > end) break;
+        for (uint32_t i = 0; i < kSamples; ++i) {
+            if (ts[i] < start || ts[i] > end) continue;
+            out.push_back(float(int(wave[channel * kSamples + i]) - 32768) * 0.195f);
+        }
+    }
+}
+
+template <typename F>
+double timeUs(int repeats, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; ++i) f();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t records = argc > 1 ? static_cast<size_t>(std::max(2L, std::atol(argv[1]))) : 28125;  // One hour
+    Expected expected = writeLog(records);
+
+    RawLogReader reader;
+    if (!reader.open(kPath)) {
+        printf("open failed: %s\n", reader.error().c_str());
+        return 1;
+    }
+    printf("RawLogReader, %zu records (%.1f MB)\n", reader.recordCount(), reader.recordCount() * 8720 / 1e6);
+    const TimeIndex* index = reader.timeIndex();
+    bool ok = index && index->header().record_count == records && index->header().min_time_ns == expected.timeNs.front() &&
+              index->header().max_time_ns == expected.timeNs.back();
+    printf("time index: %zu entries, range %s\n", index ? index->entries().size() : 0, ok ? "ok" : "MISMATCH");
+    ok = checkLookups(reader, expected) && ok;
+    printf("lookups by sequence/time/tick vs linear scan: %s\n", ok ? "ok" : "MISMATCH");
+
+    // One minute of channel 7, early in the hour (before the dropout, where
+    // the old position-based seek is still right)
+    const uint32_t start = 600000, end = start + 60000;
+    if (expected.firstTick[records / 2 - 1] < end) {
+        printf("window timing skipped: needs at least %u records\n", 2 * (end / kSamples + 1));
+    } else {
+        std::vector<float> mapped, streamed;
+        double lookupUs = timeUs(100000, [&] { volatile size_t r = reader.findByTick(start); (void)r; });
+        double mappedUs = timeUs(200, [&] { pullMapped(reader, 7, start, end, mapped); });
+        double streamedUs = timeUs(5, [&] { pullStreamed(7, start, end, streamed); });
+        bool same = mapped.size() == end - start + 1 && mapped == streamed;
+        ok = ok && same;
+        printf("findByTick                     %8.3f us\n", lookupUs);
+        printf("1 min window, mapped           %8.1f us  (%zu samples)\n", mappedUs, mapped.size());
+        printf("1 min window, seek + stream    %8.1f us  %s\n", streamedUs, same ? "ok" : "MISMATCH");
+    }
+
+    // Same lookups from the log alone
+    std::filesystem::remove(timeIndexPath(kPath));
+    reader.open(kPath);
+    bool unindexed = reader.timeIndex() == nullptr && checkLookups(reader, expected);
+    printf("lookups without the index: %s\n", unindexed ? "ok" : "MISMATCH");
+    ok = ok && unindexed;
+
+    reader.close();
+    std::filesystem::remove(kPath);
+    for (uint32_t factor : kRawLogLodFactors) std::filesystem::remove(rawLogLodPath(kPath, factor));
+    return ok ? 0 : 1;
+}
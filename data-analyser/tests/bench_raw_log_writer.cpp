@@ -0,0 +1,126 @@
+#include "../src/core/raw_log_format.h"
+#include "../src/core/raw_log_pyramid.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Writes the same records with the original byte-at-a-time ofstream writer
+// and with RawLogWriter in a few configurations, checks that every file is
+// byte-identical to the original's, and reports write throughput.
+//
+//   make bench_raw_log_writer && ./data-analyser/tests/bench_raw_log_writer [records]
+
+namespace {
+constexpr size_t kTimestamps = 128;
+constexpr size_t kSamples = 32 * 128;
+const char* kReferencePath = "/tmp/bench_raw_log_reference.log";
+const char* kOutputPath = "/tmp/bench_raw_log_writer.log";
+
+struct Config {
+    const char* name;
+    RawLogWriterOptions options;
+};
+
+// The previous RawLogWriter::append, kept as the baseline and the format reference
+template <typename T>
+void write_le(std::ofstream& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.put(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF));
+    }
+}
+
+double writeReference(size_t records, const std::vector<uint32_t>& timestamps, const std::vector<uint16_t>& waveform) {
+    auto start = std::chrono::steady_clock::now();
+    std::ofstream out(kReferencePath, std::ios::binary | std::ios::trunc);
+    RawLogFileHeader header;
+    out.write(header.magic, sizeof(header.magic));
+    write_le<uint16_t>(out, header.version);
+    write_le<uint16_t>(out, header.reserved);
+    write_le<uint32_t>(out, header.channel_count);
+    write_le<uint32_t>(out, header.samples_per_record);
+    write_le<uint32_t>(out, header.sample_bits);
+    write_le<uint32_t>(out, header.timestamp_bits);
+    for (size_t r = 0; r < records; ++r) {
+        write_le<uint64_t>(out, 1700000000000000000ULL + r * 4266666);
+        write_le<uint32_t>(out, static_cast<uint32_t>(r));
+        write_le<uint32_t>(out, 512 + 8192);
+        for (size_t i = 0; i < kTimestamps; ++i) write_le<uint32_t>(out, timestamps[i] + static_cast<uint32_t>(r * kTimestamps));
+        for (uint16_t sample : waveform) write_le<uint16_t>(out, static_cast<uint16_t>(sample + r));
+        out.flush();
+    }
+    out.close();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool sameFile(const char* a, const char* b) {
+    std::ifstream fa(a, std::ios::binary);
+    std::ifstream fb(b, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(fa), {}) ==
+           std::vector<char>(std::istreambuf_iterator<char>(fb), {});
+}
+
+bool run(const Config& config, size_t records, const std::vector<uint32_t>& timestamps,
+         const std::vector<uint16_t>& waveform) {
+    std::vector<uint32_t> ts(kTimestamps);
+    std::vector<uint16_t> wf(kSamples);
+    RawLogWriter writer(config.options);
+    auto start = std::chrono::steady_clock::now();
+    if (!writer.open(kOutputPath)) {
+        printf("%-30s open failed\n", config.name);
+        return false;
+    }
+    for (size_t r = 0; r < records; ++r) {
+        for (size_t i = 0; i < kTimestamps; ++i) ts[i] = timestamps[i] + static_cast<uint32_t>(r * kTimestamps);
+        for (size_t i = 0; i < kSamples; ++i) wf[i] = static_cast<uint16_t>(waveform[i] + r);
+        if (!writer.append(1700000000000000000ULL + r * 4266666, ts, wf)) {
+            printf("%-30s append failed\n", config.name);
+            return false;
+        }
+    }
+    writer.close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double bytes = static_cast<double>(std::filesystem::file_size(kOutputPath));
+    bool ok = sameFile(kOutputPath, kReferencePath);
+    printf("%-30s %8.1f MB/s  %9.0f records/s  %s\n", config.name, bytes / seconds / 1e6, records / seconds,
+           ok ? "ok" : "MISMATCH");
+    return ok;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t records = argc > 1 ? static_cast<size_t>(std::atol(argv[1])) : 20000;
+    std::vector<uint32_t> timestamps(kTimestamps);
+    std::vector<uint16_t> waveform(kSamples);
+    srand(1234);
+    for (size_t i = 0; i < kTimestamps; ++i) timestamps[i] = static_cast<uint32_t>(i);
+    for (uint16_t& sample : waveform) sample = static_cast<uint16_t>(rand());
+
+    printf("RawLogWriter, %zu records (%.1f MB)\n", records, records * 8720 / 1e6);
+    double seconds = writeReference(records, timestamps, waveform);
+    printf("%-30s %8.1f MB/s  %9.0f records/s\n", "ofstream, byte at a time", records * 8720 / seconds / 1e6,
+           records / seconds);
+
+    Config configs[4];
+    configs[0].name = "1 MiB buffer, sync on close";
+    configs[0].options.syncInterval = std::chrono::milliseconds(0);
+    configs[1].name = "1 MiB buffer, sync every 5 s";
+    configs[2].name = "4 MiB buffer, sync every 5 s";
+    configs[2].options.bufferBytes = 4 * 1024 * 1024;
+    configs[3].name = "1 MiB buffer, sync every 1000";
+    configs[3].options.syncEveryRecords = 1000;
+
+    int failures = 0;
+    for (const Config& config : configs) {
+        failures += run(config, records, timestamps, waveform) ? 0 : 1;
+    }
+    std::filesystem::remove(kOutputPath);
+    std::filesystem::remove(timeIndexPath(kOutputPath));
+    for (uint32_t factor : kRawLogLodFactors) std::filesystem::remove(rawLogLodPath(kOutputPath, factor));
+    std::filesystem::remove(kReferencePath);
+    return failures == 0 ? 0 : 1;
+}
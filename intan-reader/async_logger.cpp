@@ -0,0 +1,228 @@
+#include "async_logger.h"
+#include <chrono>
+#include <ctime>
+
+namespace {
+constexpr auto kIdleWait = std::chrono::milliseconds(2);
+
+const char* levelName(AsyncLogger::Level level) {
+    switch (level) {
+        case AsyncLogger::Debug: return "DEBUG";
+        case AsyncLogger::Info: return "INFO";
+        case AsyncLogger::Warn: return "WARN";
+        case AsyncLogger::Error: return "ERROR";
+    }
+    return "?";
+}
+
+int64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void appendWallTime(std::string& line, int64_t wallNs) {
+    time_t seconds = static_cast<time_t>(wallNs / 1000000000);
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    char buf[40];
+    size_t n = strftime(buf, sizeof(buf), "[%Y-%m-%d %H:%M:%S", &tm);
+    n += snprintf(buf + n, sizeof(buf) - n, ".%03d] ", static_cast<int>((wallNs / 1000000) % 1000));
+    line.append(buf, n);
+}
+} // namespace
+
+AsyncLogger& AsyncLogger::instance() {
+    static AsyncLogger logger;
+    return logger;
+}
+
+AsyncLogger::AsyncLogger()
+    : ring_(new Record[kCapacity]), enqueuePos_(0), drainedPos_(0), dropped_(0), reportedDrops_(0), stop_(false) {
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of two");
+    for (size_t i = 0; i < kCapacity; ++i) {
+        ring_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    drainThread_ = std::thread(&AsyncLogger::drainLoop, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    if (drainThread_.joinable()) {
+        drainThread_.join();
+    }
+    delete[] ring_;
+}
+
+AsyncLogger::Record* AsyncLogger::claim() {
+    uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    for (;;) {
+        Record* record = &ring_[pos & (kCapacity - 1)];
+        uint64_t sequence = record->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            // The slot is free for this turn; take it if no other producer did
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                record->wallNs = wallClockNs();
+                return record;
+            }
+        } else if (diff < 0) {
+            // Drain thread is a full ring behind; never wait on the hot path
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncLogger::publish(Record* record) {
+    uint64_t pos = record->sequence.load(std::memory_order_relaxed);
+    record->sequence.store(pos + 1, std::memory_order_release);
+}
+
+void AsyncLogger::captureString(Record& r, const char* data, size_t length) {
+    Arg& a = r.args[r.argCount++];
+    a.type = Arg::String;
+    size_t room = kStringBytes - r.stringBytes;
+    size_t n = length < room ? length : room;
+    a.stringOffset = r.stringBytes;
+    a.stringLength = static_cast<uint16_t>(n);
+    if (n > 0) {
+        std::memcpy(r.strings + r.stringBytes, data, n);
+    }
+    r.stringBytes = static_cast<uint16_t>(r.stringBytes + n);
+}
+
+void AsyncLogger::flush() {
+    const uint64_t target = enqueuePos_.load(std::memory_order_acquire);
+    wake_.notify_all();
+    while (drainedPos_.load(std::memory_order_acquire) < target && !stop_) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+void AsyncLogger::drainLoop() {
+    std::string out;
+    std::string err;
+    out.reserve(64 * 1024);
+    err.reserve(4 * 1024);
+    for (;;) {
+        bool stopping = stop_.load();
+        size_t drained = drain(out, err);
+        if (drained == 0) {
+            if (stopping) {
+                break;
+            }
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            wake_.wait_for(lock, kIdleWait);
+        }
+    }
+}
+
+size_t AsyncLogger::drain(std::string& out, std::string& err) {
+    size_t count = 0;
+    uint64_t pos = drainedPos_.load(std::memory_order_relaxed);
+    std::string line;
+    for (;;) {
+        Record& record = ring_[pos & (kCapacity - 1)];
+        if (record.sequence.load(std::memory_order_acquire) != pos + 1) {
+            break; // Not published yet (or still being filled)
+        }
+        line.clear();
+        format(record, line);
+        (record.level >= Warn ? err : out).append(line);
+
+        // Hand the slot back to producers for the next lap
+        record.sequence.store(pos + kCapacity, std::memory_order_release);
+        ++pos;
+        ++count;
+    }
+
+    uint64_t drops = dropped_.load(std::memory_order_relaxed);
+    if (drops != reportedDrops_) {
+        line.clear();
+        appendWallTime(line, wallClockNs());
+        line += "[WARN] [log] " + std::to_string(drops - reportedDrops_) + " messages dropped (ring full)\n";
+        err.append(line);
+        reportedDrops_ = drops;
+    }
+
+    // One write and one flush per batch instead of per line
+    if (!out.empty()) {
+        fwrite(out.data(), 1, out.size(), stdout);
+        fflush(stdout);
+        out.clear();
+    }
+    if (!err.empty()) {
+        fwrite(err.data(), 1, err.size(), stderr);
+        fflush(stderr);
+        err.clear();
+    }
+    drainedPos_.store(pos, std::memory_order_release);
+    return count;
+}
+
+void AsyncLogger::format(const Record& record, std::string& line) const {
+    appendWallTime(line, record.wallNs);
+    line += '[';
+    line += levelName(record.level);
+    line += "] [";
+    line += record.tag;
+    line += "] ";
+
+    // Replace each {} (or {:spec}) with the next argument
+    char buf[64];
+    int next = 0;
+    const char* p = record.format;
+    while (*p) {
+        if (p[0] != '{' || next >= record.argCount) {
+            line += *p++;
+            continue;
+        }
+        const char* close = std::strchr(p, '}');
+        if (!close) {
+            line += p;
+            break;
+        }
+        const Arg& a = record.args[next++];
+        int n = 0;
+        switch (a.type) {
+            case Arg::Signed:
+                n = snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(a.i));
+                break;
+            case Arg::Unsigned:
+                n = snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(a.u));
+                break;
+            case Arg::Floating: {
+                char spec[16] = "%g";
+                size_t specLength = static_cast<size_t>(close - p) - 1; // ":.2f" inside the braces
+                if (p[1] == ':' && specLength > 1 && specLength < sizeof(spec) - 1) {
+                    spec[0] = '%';
+                    std::memcpy(spec + 1, p + 2, specLength - 1);
+                    spec[specLength] = '\0';
+                }
+                n = snprintf(buf, sizeof(buf), spec, a.d);
+                break;
+            }
+            case Arg::Bool:
+                n = snprintf(buf, sizeof(buf), "%s", a.u ? "true" : "false");
+                break;
+            case Arg::Char:
+                buf[0] = static_cast<char>(a.i);
+                n = 1;
+                break;
+            case Arg::String:
+                line.append(record.strings + a.stringOffset, a.stringLength);
+                break;
+        }
+        if (n > 0) {
+            line.append(buf, static_cast<size_t>(n) < sizeof(buf) ? static_cast<size_t>(n) : sizeof(buf) - 1);
+        }
+        p = close + 1;
+    }
+    line += '\n';
+}
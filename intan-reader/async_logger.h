@@ -0,0 +1,192 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+// Asynchronous logger for the pipeline hot paths (USB read loop, ASIC
+// transfer threads, RHX shared-memory consumer).
+//
+// A call copies the format pointer, a wall-clock stamp and the raw argument
+// values into a preallocated ring slot and returns; no allocation, lock or
+// I/O happens on the calling thread. A drain thread formats the records and
+// writes them in batches (info/debug to stdout, warnings/errors to stderr),
+// one flush per batch. If the ring is full the message is dropped and
+// counted rather than blocking the caller.
+//
+// Formats use "{}" placeholders, and "{:.2f}"-style printf specs for
+// floating-point arguments. The format and tag must be string literals;
+// string arguments are copied into the slot (truncated if very long).
+//
+//   PLOG_INFO("asic", "transfers: {}, fill avg {:.2f}", batches, fill);
+//
+// Levels below PIPELINE_LOG_LEVEL compile to nothing: the call sits behind
+// if (false), so arguments are type-checked but never evaluated.
+// Build with -DPIPELINE_LOG_LEVEL=PIPELINE_LOG_LEVEL_DEBUG for per-frame
+// traces.
+
+#define PIPELINE_LOG_LEVEL_DEBUG 0
+#define PIPELINE_LOG_LEVEL_INFO 1
+#define PIPELINE_LOG_LEVEL_WARN 2
+#define PIPELINE_LOG_LEVEL_ERROR 3
+#define PIPELINE_LOG_LEVEL_OFF 4
+
+#ifndef PIPELINE_LOG_LEVEL
+#define PIPELINE_LOG_LEVEL PIPELINE_LOG_LEVEL_INFO
+#endif
+
+class AsyncLogger {
+public:
+    enum Level : uint8_t {
+        Debug = PIPELINE_LOG_LEVEL_DEBUG,
+        Info = PIPELINE_LOG_LEVEL_INFO,
+        Warn = PIPELINE_LOG_LEVEL_WARN,
+        Error = PIPELINE_LOG_LEVEL_ERROR
+    };
+
+    static const int kMaxArgs = 8;
+    static const size_t kStringBytes = 128;  // Per record, shared by all string arguments
+    static const size_t kCapacity = 4096;    // Records in the ring (power of two)
+
+    // Process-wide logger; the drain thread starts on first use and the
+    // ring is drained when the process exits
+    static AsyncLogger& instance();
+
+    template <typename... Args>
+    void log(Level level, const char* tag, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= kMaxArgs, "too many log arguments");
+        Record* record = claim();
+        if (!record) {
+            return;
+        }
+        record->level = level;
+        record->tag = tag;
+        record->format = format;
+        record->argCount = 0;
+        record->stringBytes = 0;
+        int expand[] = {0, (capture(*record, args), 0)...};
+        (void)expand;
+        publish(record);
+    }
+
+    // Block until everything logged before the call has been written
+    void flush();
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    ~AsyncLogger();
+
+private:
+    struct Arg {
+        enum Type : uint8_t { Signed, Unsigned, Floating, Bool, Char, String } type;
+        uint16_t stringOffset;
+        uint16_t stringLength;
+        union {
+            int64_t i;
+            uint64_t u;
+            double d;
+        };
+    };
+
+    struct Record {
+        std::atomic<uint64_t> sequence;  // Slot turn, as in a Vyukov bounded queue
+        int64_t wallNs;
+        const char* tag;
+        const char* format;
+        Level level;
+        uint8_t argCount;
+        uint16_t stringBytes;
+        Arg args[kMaxArgs];
+        char strings[kStringBytes];
+    };
+
+    AsyncLogger();
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    Record* claim();
+    void publish(Record* record);
+    void drainLoop();
+    size_t drain(std::string& out, std::string& err);
+    void format(const Record& record, std::string& line) const;
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    capture(Record& r, const T& value) {
+        Arg& a = r.args[r.argCount++];
+        a.type = Arg::Signed;
+        a.i = value;
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value &&
+                                   !std::is_same<T, bool>::value>::type
+    capture(Record& r, const T& value) {
+        Arg& a = r.args[r.argCount++];
+        a.type = Arg::Unsigned;
+        a.u = value;
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_enum<T>::value>::type capture(Record& r, const T& value) {
+        Arg& a = r.args[r.argCount++];
+        a.type = Arg::Signed;
+        a.i = static_cast<int64_t>(value);
+    }
+    static void capture(Record& r, bool value) {
+        Arg& a = r.args[r.argCount++];
+        a.type = Arg::Bool;
+        a.u = value ? 1 : 0;
+    }
+    static void capture(Record& r, char value) {
+        Arg& a = r.args[r.argCount++];
+        a.type = Arg::Char;
+        a.i = value;
+    }
+    static void capture(Record& r, double value) {
+        Arg& a = r.args[r.argCount++];
+        a.type = Arg::Floating;
+        a.d = value;
+    }
+    static void capture(Record& r, float value) { capture(r, static_cast<double>(value)); }
+    static void capture(Record& r, const char* value) { captureString(r, value, value ? std::strlen(value) : 0); }
+    static void capture(Record& r, const std::string& value) { captureString(r, value.data(), value.size()); }
+    static void captureString(Record& r, const char* data, size_t length);
+
+    Record* ring_;
+    std::atomic<uint64_t> enqueuePos_;
+    std::atomic<uint64_t> drainedPos_;   // Drain thread only writes; flush() reads
+    std::atomic<uint64_t> dropped_;
+    uint64_t reportedDrops_;             // Drain thread only
+    std::atomic<bool> stop_;
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::thread drainThread_;
+};
+
+#if PIPELINE_LOG_LEVEL <= PIPELINE_LOG_LEVEL_DEBUG
+#define PLOG_DEBUG(tag, ...) AsyncLogger::instance().log(AsyncLogger::Debug, tag, __VA_ARGS__)
+#else
+#define PLOG_DEBUG(tag, ...) do { if (false) AsyncLogger::instance().log(AsyncLogger::Debug, tag, __VA_ARGS__); } while (0)
+#endif
+#if PIPELINE_LOG_LEVEL <= PIPELINE_LOG_LEVEL_INFO
+#define PLOG_INFO(tag, ...) AsyncLogger::instance().log(AsyncLogger::Info, tag, __VA_ARGS__)
+#else
+#define PLOG_INFO(tag, ...) do { if (false) AsyncLogger::instance().log(AsyncLogger::Info, tag, __VA_ARGS__); } while (0)
+#endif
+#if PIPELINE_LOG_LEVEL <= PIPELINE_LOG_LEVEL_WARN
+#define PLOG_WARN(tag, ...) AsyncLogger::instance().log(AsyncLogger::Warn, tag, __VA_ARGS__)
+#else
+#define PLOG_WARN(tag, ...) do { if (false) AsyncLogger::instance().log(AsyncLogger::Warn, tag, __VA_ARGS__); } while (0)
+#endif
+#if PIPELINE_LOG_LEVEL <= PIPELINE_LOG_LEVEL_ERROR
+#define PLOG_ERROR(tag, ...) AsyncLogger::instance().log(AsyncLogger::Error, tag, __VA_ARGS__)
+#else
+#define PLOG_ERROR(tag, ...) do { if (false) AsyncLogger::instance().log(AsyncLogger::Error, tag, __VA_ARGS__); } while (0)
+#endif
+
+#endif // ASYNC_LOGGER_H
@@ -1,19 +1,65 @@
 #ifndef INTAN_DATA_TYPES_H
 #define INTAN_DATA_TYPES_H
 
+#include <cstdint>
+#include <atomic>
+
+// Shared memory segment layout (v3):
+//   [IntanDataHeader][slot 0][slot 1] ... [slot N-1]
+// Each slot is an IntanFrameSlot followed by one frame payload and padded to
+// header->slotStride bytes. Frame k lives in slot (k % slotCount); the writer
+// never waits for readers, it just overwrites the oldest slot.
+#define INTAN_SHM_NAME "/intan_rhx_shm_v1"
+#define INTAN_SHM_ASIC_NAME "/intan_rhx_shm_asic_v1" // Decimated stream for the HALO ASIC path
+#define INTAN_SHM_MAGIC 0x494E5441 // "INTA"
+#define INTAN_SHM_VERSION 3
+#define INTAN_SHM_DEFAULT_SLOTS 16
+
+// Frame payload encodings. Readers pick their decoder from header->encoding.
+// The uint16 encodings carry raw ADC codes; microvolts are
+// (code - header->sampleOffset) * header->sampleScale.
+enum IntanFrameEncoding : uint32_t {
+    IntanFrameFloatBlocks = 0,     // IntanDataBlock per sample, [sample][stream][channel]
+    IntanFrameU16SampleMajor = 1,  // uint16 codes, [sample][stream][channel] (time-contiguous)
+    IntanFrameU16ChannelMajor = 2  // uint16 codes, [stream][channel][sample] (channel-contiguous)
+};
+
 // Intan data structures for shared memory communication
-struct IntanDataHeader {
-    uint32_t magic;        // Magic number "INTA" (0x494E5441)
-    uint32_t timestamp;    // Timestamp
-    uint32_t dataSize;     // Total size
+struct alignas(64) IntanDataHeader {
+    uint32_t magic;        // Magic number "INTA" (0x494E5441), written last
+    uint32_t timestamp;    // Timestamp of the most recently published frame
+    uint32_t dataSize;     // Total segment size
     uint32_t streamCount;  // Number of streams
     uint32_t channelCount; // Number of channels
     uint32_t sampleRate;   // Sample rate
+    uint32_t version;         // Layout version (INTAN_SHM_VERSION)
+    uint32_t headerSize;      // Offset of slot 0 from the segment base
+    uint32_t samplesPerFrame; // Samples per channel in one frame
+    uint32_t slotCount;       // Number of frame slots in the ring
+    uint32_t slotStride;      // Bytes between consecutive slots
+    uint32_t frameBytes;      // Payload bytes per frame
+    uint32_t encoding;        // IntanFrameEncoding of every frame payload
+    float sampleScale;        // Microvolts per ADC code step
+    float sampleOffset;       // ADC code that maps to 0 uV
+    std::atomic<uint64_t> writeIndex; // Number of frames published so far
+    std::atomic<uint32_t> notifyWord; // Bumped after every publish; futex word for waiting readers
+};
+
+// Per-slot seqlock. While frame k is being written the sequence is 2k+1,
+// once it is published the sequence is 2k+2. The *Ns fields are
+// monotonicNowNs() stamps (latency_tracker.h) for end-to-end latency tracing.
+struct alignas(64) IntanFrameSlot {
+    std::atomic<uint64_t> sequence;
+    uint64_t frameIndex;
+    uint32_t timestamp;
+    uint32_t payloadBytes;
+    uint64_t acquiredNs;   // USB read that delivered the frame's newest sample returned
+    uint64_t publishedNs;  // Frame was published
 };
 
-struct IntanDataBlock { 
+struct IntanDataBlock {
     uint32_t streamId;
-    uint32_t channelId; 
+    uint32_t channelId;
     float value;
 };
 
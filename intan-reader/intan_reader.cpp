@@ -1,10 +1,77 @@
 #include "intan_reader.h"
+#include "async_logger.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+
+namespace {
+constexpr int kNumMisoLines = 2 * MAX_NUM_SPI_PORTS;  // Two MISO lines per SPI port
+constexpr int kNumCableDelays = 16;
+constexpr int kScanBlocksPerDelay = 2;
+
+// Intan chip IDs (ROM register 63) and the RHD2164 MISO A marker (register 59)
+constexpr int kChipRHD2132 = 1;
+constexpr int kChipRHD2216 = 2;
+constexpr int kChipRHD2164 = 4;
+constexpr int kRegister59MisoA = 53;
+
+const Rhd2000EvalBoardUsb3::BoardPort kPorts[MAX_NUM_SPI_PORTS] = {
+    Rhd2000EvalBoardUsb3::PortA, Rhd2000EvalBoardUsb3::PortB, Rhd2000EvalBoardUsb3::PortC, Rhd2000EvalBoardUsb3::PortD,
+    Rhd2000EvalBoardUsb3::PortE, Rhd2000EvalBoardUsb3::PortF, Rhd2000EvalBoardUsb3::PortG, Rhd2000EvalBoardUsb3::PortH
+};
+
+// Chip ID read back by the AuxCmd3 register-config sequence, or -1 if the
+// ROM does not spell "INTAN"/"RHD" (bad cable delay or nothing connected)
+int readChipId(const Rhd2000DataBlockUsb3& block, int stream, int& register59Value) {
+    const std::vector<int>& rom = block.auxiliaryData[stream][2];
+    bool intanChipPresent = (char)rom[32] == 'I' && (char)rom[33] == 'N' && (char)rom[34] == 'T' &&
+                            (char)rom[35] == 'A' && (char)rom[36] == 'N' &&
+                            (char)rom[24] == 'R' && (char)rom[25] == 'H' && (char)rom[26] == 'D';
+    if (!intanChipPresent) {
+        register59Value = -1;
+        return -1;
+    }
+    register59Value = rom[23];
+    return rom[19];
+}
+
+bool toSampleRateEnum(int hz, Rhd2000EvalBoardUsb3::AmplifierSampleRate& rate) {
+    switch (hz) {
+        case 1000: rate = Rhd2000EvalBoardUsb3::SampleRate1000Hz; return true;
+        case 1250: rate = Rhd2000EvalBoardUsb3::SampleRate1250Hz; return true;
+        case 1500: rate = Rhd2000EvalBoardUsb3::SampleRate1500Hz; return true;
+        case 2000: rate = Rhd2000EvalBoardUsb3::SampleRate2000Hz; return true;
+        case 2500: rate = Rhd2000EvalBoardUsb3::SampleRate2500Hz; return true;
+        case 3000: rate = Rhd2000EvalBoardUsb3::SampleRate3000Hz; return true;
+        case 3333: rate = Rhd2000EvalBoardUsb3::SampleRate3333Hz; return true;
+        case 4000: rate = Rhd2000EvalBoardUsb3::SampleRate4000Hz; return true;
+        case 5000: rate = Rhd2000EvalBoardUsb3::SampleRate5000Hz; return true;
+        case 6250: rate = Rhd2000EvalBoardUsb3::SampleRate6250Hz; return true;
+        case 8000: rate = Rhd2000EvalBoardUsb3::SampleRate8000Hz; return true;
+        case 10000: rate = Rhd2000EvalBoardUsb3::SampleRate10000Hz; return true;
+        case 12500: rate = Rhd2000EvalBoardUsb3::SampleRate12500Hz; return true;
+        case 15000: rate = Rhd2000EvalBoardUsb3::SampleRate15000Hz; return true;
+        case 20000: rate = Rhd2000EvalBoardUsb3::SampleRate20000Hz; return true;
+        case 25000: rate = Rhd2000EvalBoardUsb3::SampleRate25000Hz; return true;
+        case 30000: rate = Rhd2000EvalBoardUsb3::SampleRate30000Hz; return true;
+        default: return false;
+    }
+}
+
+const char* chipName(int chipId) {
+    switch (chipId) {
+        case kChipRHD2132: return "RHD2132";
+        case kChipRHD2216: return "RHD2216";
+        case kChipRHD2164: return "RHD2164";
+        default: return "unknown";
+    }
+}
+} // namespace
 
 IntanReader::IntanReader() 
-    : running_(false) {
+    : running_(false), sampleRateHz_(INTAN_DEFAULT_SAMPLE_RATE), maxBlocksPerRead_(MAX_NUM_BLOCKS),
+      asicFrameRows_(0), asicTimestamp_(0) {
 }
 
 IntanReader::~IntanReader() {
@@ -14,20 +81,17 @@ IntanReader::~IntanReader() {
     }
 }
 
-bool IntanReader::initialize() {
+bool IntanReader::initialize(int sampleRateHz) {
     std::cout << "Initializing Intan Reader..." << std::endl;
-    controller_ = std::make_unique<Rhd2000EvalBoardUsb3>();
-    
-    // Initialize shared memory writer with device parameters
-    sharedMemoryWriter_ = std::make_unique<SharedMemoryWriter>();
-    int numStreams = 1; // Will be set after device is opened
-    int numChannels = CHANNELS_PER_STREAM; // 32 channels per stream
-    int sampleRate = 1000; // 1kHz sample rate
     
-    if (!sharedMemoryWriter_->initialize(numStreams, numChannels, sampleRate)) {
-        std::cerr << "Failed to initialize shared memory writer." << std::endl;
+    Rhd2000EvalBoardUsb3::AmplifierSampleRate rateEnum;
+    if (!toSampleRateEnum(sampleRateHz, rateEnum) || sampleRateHz % INTAN_ASIC_SAMPLE_RATE != 0) {
+        std::cerr << "Unsupported sample rate " << sampleRateHz << " Hz (must be an amplifier rate that is a multiple of "
+                  << INTAN_ASIC_SAMPLE_RATE << " Hz)." << std::endl;
         return false;
     }
+    sampleRateHz_ = sampleRateHz;
+    controller_ = std::make_unique<Rhd2000EvalBoardUsb3>();
     
     if (!openDevice()) {
         return false;
@@ -41,6 +105,32 @@ bool IntanReader::initialize() {
         return false;
     }
     
+    // Size the shared memory frame to whatever the port scan enabled
+    sharedMemoryWriter_ = std::make_unique<SharedMemoryWriter>();
+    int numStreams = controller_->getNumEnabledDataStreams();
+    int numChannels = CHANNELS_PER_STREAM; // 32 channels per stream
+    int sampleRate = static_cast<int>(controller_->getSampleRate());
+    
+    if (!sharedMemoryWriter_->initialize(numStreams, numChannels, sampleRate)) {
+        std::cerr << "Failed to initialize shared memory writer." << std::endl;
+        return false;
+    }
+    
+    // Second channel at the rate the HALO ASIC pipeline expects
+    const int lanes = numStreams * numChannels;
+    const int factor = sampleRateHz_ / INTAN_ASIC_SAMPLE_RATE;
+    asicWriter_ = std::make_unique<SharedMemoryWriter>(INTAN_SHM_ASIC_NAME);
+    if (!asicWriter_->initialize(numStreams, numChannels, INTAN_ASIC_SAMPLE_RATE) || !decimator_.configure(lanes, factor)) {
+        std::cerr << "Failed to initialize decimated ASIC shared memory channel." << std::endl;
+        return false;
+    }
+    decimated_.assign(decimator_.maxOutputRows(SAMPLES_PER_DATA_BLOCK) * lanes, 0);
+    asicFrame_.assign(asicWriter_->samplesPerFrame() * lanes, 0);
+    asicFrameRows_ = 0;
+    asicTimestamp_ = 0;
+    std::cout << "ASIC channel: " << sampleRateHz_ << " Hz -> " << INTAN_ASIC_SAMPLE_RATE << " Hz (decimate by "
+              << factor << ", " << decimator_.numTaps() << " taps)" << std::endl;
+    
     std::cout << "Intan Reader initialized successfully!" << std::endl;
     return true;
 }
@@ -85,9 +175,9 @@ bool IntanReader::configureDevice() {
     // Initialize the controller
     controller_->initialize();
     
-    controller_->setSampleRate(Rhd2000EvalBoardUsb3::SampleRate1000Hz);
-    controller_->setCableLengthFeet(Rhd2000EvalBoardUsb3::PortA, 3.0);
-    controller_->enableDataStream(0, true);
+    Rhd2000EvalBoardUsb3::AmplifierSampleRate rateEnum = Rhd2000EvalBoardUsb3::SampleRate1000Hz;
+    toSampleRateEnum(sampleRateHz_, rateEnum);
+    controller_->setSampleRate(rateEnum);
 
     Rhd2000RegistersUsb3* chipRegisters = new Rhd2000RegistersUsb3(controller_->getSampleRate());
     
@@ -97,12 +187,14 @@ bool IntanReader::configureDevice() {
     // set amplifier bandwidths and DSP cutoff before building register lists
     double dspCutoffFreq = chipRegisters->setDspCutoffFreq(10.0);
     chipRegisters->setLowerBandwidth(1.0);
-    chipRegisters->setUpperBandwidth(500.0); // Reduced from 7500.0 to be within Nyquist limit (500 Hz for 1000 Hz sampling)
+    // 7500 Hz at 20/30 kHz; capped at Nyquist for low rates (500 Hz at 1 kHz)
+    double upperBandwidth = std::min(7500.0, 0.5 * sampleRateHz_);
+    chipRegisters->setUpperBandwidth(upperBandwidth);
     
     std::cout << "Amplifier configuration:" << std::endl;
     std::cout << "  DSP cutoff frequency: " << dspCutoffFreq << " Hz" << std::endl;
     std::cout << "  Lower bandwidth: 1.0 Hz" << std::endl;
-    std::cout << "  Upper bandwidth: 500.0 Hz" << std::endl;
+    std::cout << "  Upper bandwidth: " << upperBandwidth << " Hz" << std::endl;
     
     std::vector<int> commandList;
     int commandSequenceLength = 0;
@@ -114,7 +206,9 @@ bool IntanReader::configureDevice() {
     if (commandSequenceLength > 0) {
         controller_->uploadCommandList(commandList, Rhd2000EvalBoardUsb3::AuxCmd1, 0);
         controller_->selectAuxCommandLength(Rhd2000EvalBoardUsb3::AuxCmd1, 0, commandSequenceLength - 1);
-        controller_->selectAuxCommandBank(Rhd2000EvalBoardUsb3::PortA, Rhd2000EvalBoardUsb3::AuxCmd1, 0);
+        for (Rhd2000EvalBoardUsb3::BoardPort port : kPorts) {
+            controller_->selectAuxCommandBank(port, Rhd2000EvalBoardUsb3::AuxCmd1, 0);
+        }
     } else {
         std::cerr << "Warning: Failed to create AuxCmd1 command list" << std::endl;
     }
@@ -126,7 +220,9 @@ bool IntanReader::configureDevice() {
     if (commandSequenceLength > 0) {
         controller_->uploadCommandList(commandList, Rhd2000EvalBoardUsb3::AuxCmd2, 0);
         controller_->selectAuxCommandLength(Rhd2000EvalBoardUsb3::AuxCmd2, 0, commandSequenceLength - 1);
-        controller_->selectAuxCommandBank(Rhd2000EvalBoardUsb3::PortA, Rhd2000EvalBoardUsb3::AuxCmd2, 0);
+        for (Rhd2000EvalBoardUsb3::BoardPort port : kPorts) {
+            controller_->selectAuxCommandBank(port, Rhd2000EvalBoardUsb3::AuxCmd2, 0);
+        }
     } else {
         std::cerr << "Warning: Failed to create AuxCmd2 command list" << std::endl;
     }
@@ -140,10 +236,19 @@ bool IntanReader::configureDevice() {
     int lenCal = chipRegisters->createCommandListRegisterConfig(commandList, true);
     controller_->uploadCommandList(commandList, Rhd2000EvalBoardUsb3::AuxCmd3, 1);
     
+    // Find every connected chip and enable its streams
+    if (scanPorts(lenNoCal) == 0) {
+        std::cerr << "Warning: no Intan chips detected; falling back to PortA stream 0" << std::endl;
+        controller_->setCableLengthFeet(Rhd2000EvalBoardUsb3::PortA, 3.0);
+        controller_->enableDataStream(0, true);
+    }
+    
     // Run calibration once on bank 1
     controller_->selectAuxCommandLength(Rhd2000EvalBoardUsb3::AuxCmd3, 0, lenCal - 1);
-    controller_->selectAuxCommandBank(Rhd2000EvalBoardUsb3::PortA, Rhd2000EvalBoardUsb3::AuxCmd3, 1);
-    controller_->setMaxTimeStep(128);
+    for (Rhd2000EvalBoardUsb3::BoardPort port : kPorts) {
+        controller_->selectAuxCommandBank(port, Rhd2000EvalBoardUsb3::AuxCmd3, 1);
+    }
+    controller_->setMaxTimeStep(SAMPLES_PER_DATA_BLOCK);
     controller_->setContinuousRunMode(false);
     controller_->run();
     while (controller_->isRunning()) {}
@@ -154,13 +259,111 @@ bool IntanReader::configureDevice() {
     
     // Switch to bank 0 for normal acquisition
     controller_->selectAuxCommandLength(Rhd2000EvalBoardUsb3::AuxCmd3, 0, lenNoCal - 1);
-    controller_->selectAuxCommandBank(Rhd2000EvalBoardUsb3::PortA, Rhd2000EvalBoardUsb3::AuxCmd3, 0);
+    for (Rhd2000EvalBoardUsb3::BoardPort port : kPorts) {
+        controller_->selectAuxCommandBank(port, Rhd2000EvalBoardUsb3::AuxCmd3, 0);
+    }
     controller_->setContinuousRunMode(true);
     controller_->run();
     
     return true;
 }
 
+int IntanReader::scanPorts(int auxCmd3Length) {
+    // Same procedure as RHXController::findConnectedChips: enable the MISO A
+    // stream of every MISO line, run the register-config sequence at each of the
+    // 16 cable delays, and count the delays where a chip ID reads back cleanly.
+    std::cout << "Scanning " << MAX_NUM_SPI_PORTS << " ports for connected chips..." << std::endl;
+    
+    for (int stream = 0; stream < MAX_NUM_DATA_STREAMS; ++stream) {
+        controller_->enableDataStream(stream, stream % 2 == 0);
+    }
+    controller_->selectAuxCommandLength(Rhd2000EvalBoardUsb3::AuxCmd3, 0, auxCmd3Length - 1);
+    for (Rhd2000EvalBoardUsb3::BoardPort port : kPorts) {
+        controller_->selectAuxCommandBank(port, Rhd2000EvalBoardUsb3::AuxCmd3, 0);
+    }
+    
+    Rhd2000DataBlockUsb3 scanBlock(controller_->getNumEnabledDataStreams());
+    controller_->setMaxTimeStep(kScanBlocksPerDelay * SAMPLES_PER_DATA_BLOCK);
+    controller_->setContinuousRunMode(false);
+    
+    std::vector<std::vector<int>> goodDelays(kNumMisoLines, std::vector<int>(kNumCableDelays, 0));
+    std::vector<int> chipIds(kNumMisoLines, -1);
+    for (int delay = 0; delay < kNumCableDelays; ++delay) {
+        for (Rhd2000EvalBoardUsb3::BoardPort port : kPorts) {
+            controller_->setCableDelay(port, delay);
+        }
+        controller_->run();
+        while (controller_->isRunning()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        
+        for (int i = 0; i < kScanBlocksPerDelay; ++i) {
+            controller_->readDataBlock(&scanBlock);
+            // With only even streams enabled, block stream k is MISO line k
+            for (int miso = 0; miso < kNumMisoLines; ++miso) {
+                int register59Value;
+                int id = readChipId(scanBlock, miso, register59Value);
+                if (id == kChipRHD2132 || id == kChipRHD2216 ||
+                    (id == kChipRHD2164 && register59Value == kRegister59MisoA)) {
+                    goodDelays[miso][delay]++;
+                    chipIds[miso] = id;
+                }
+            }
+        }
+    }
+    
+    // Pick a delay per MISO line: the middle of the good window when there
+    // are 3 or more, the longer of two for RHD2164 DDR, otherwise the first
+    std::vector<int> optimumDelay(kNumMisoLines, 0);
+    for (int miso = 0; miso < kNumMisoLines; ++miso) {
+        if (chipIds[miso] < 0) {
+            continue;
+        }
+        const std::vector<int>& good = goodDelays[miso];
+        int bestCount = *std::max_element(good.begin(), good.end());
+        int numBest = (int)std::count(good.begin(), good.end(), bestCount);
+        int bestDelay = (int)(std::find(good.begin(), good.end(), bestCount) - good.begin());
+        if (numBest == 2 && chipIds[miso] == kChipRHD2164) {
+            bestDelay = (int)(std::find(good.rbegin(), good.rend(), bestCount).base() - good.begin()) - 1;
+        } else if (numBest > 2) {
+            bestDelay = (int)(std::find(good.begin() + bestDelay + 1, good.end(), bestCount) - good.begin());
+        }
+        optimumDelay[miso] = bestDelay;
+    }
+    for (int port = 0; port < MAX_NUM_SPI_PORTS; ++port) {
+        controller_->setCableDelay(kPorts[port], std::max(optimumDelay[2 * port], optimumDelay[2 * port + 1]));
+    }
+    
+    // Enable the streams each chip needs: one for RHD2132/RHD2216, two (MISO A
+    // plus the DDR stream) for RHD2164
+    connectedStreams_.clear();
+    for (int stream = 0; stream < MAX_NUM_DATA_STREAMS; ++stream) {
+        controller_->enableDataStream(stream, false);
+    }
+    for (int miso = 0; miso < kNumMisoLines; ++miso) {
+        if (chipIds[miso] < 0) {
+            continue;
+        }
+        int port = miso / 2;
+        controller_->enableDataStream(2 * miso, true);
+        connectedStreams_.push_back({2 * miso, port, chipIds[miso]});
+        if (chipIds[miso] == kChipRHD2164) {
+            controller_->enableDataStream(2 * miso + 1, true);
+            connectedStreams_.push_back({2 * miso + 1, port, chipIds[miso]});
+        }
+        std::cout << "  Port " << (char)('A' + port) << " MISO " << (miso % 2 == 0 ? "1" : "2")
+                  << ": " << chipName(chipIds[miso]) << " (cable delay " << optimumDelay[miso] << ")" << std::endl;
+    }
+    
+    std::cout << "Port scan enabled " << controller_->getNumEnabledDataStreams() << " data streams ("
+              << controller_->getNumEnabledDataStreams() * CHANNELS_PER_STREAM << " channels)" << std::endl;
+    return (int)connectedStreams_.size();
+}
+
+void IntanReader::setMaxBlocksPerRead(int blocks) {
+    maxBlocksPerRead_ = std::max(1, std::min(blocks, MAX_NUM_BLOCKS));
+}
+
 bool IntanReader::start() {
     if (running_) {
         std::cout << "Reader is already running." << std::endl;
@@ -197,55 +400,117 @@ void IntanReader::stop() {
     std::cout << "Data acquisition stopped." << std::endl;
 }
 
+void IntanReader::publishDecimated(const int* amplifierData, uint64_t acquiredNs) {
+    if (!asicWriter_) {
+        return;
+    }
+    
+    const size_t lanes = (size_t)decimator_.lanes();
+    const size_t frameRows = asicWriter_->samplesPerFrame();
+    size_t rows = decimator_.process(amplifierData, SAMPLES_PER_DATA_BLOCK, decimated_.data());
+    const int* src = decimated_.data();
+    while (rows > 0) {
+        size_t take = std::min(rows, frameRows - asicFrameRows_);
+        std::copy(src, src + take * lanes, asicFrame_.begin() + asicFrameRows_ * lanes);
+        asicFrameRows_ += take;
+        src += take * lanes;
+        rows -= take;
+        
+        if (asicFrameRows_ == frameRows) {
+            asicWriter_->writeDataBlock(asicTimestamp_, asicFrame_.data(), asicFrame_.size(), acquiredNs);
+            asicTimestamp_ += static_cast<uint32_t>(frameRows);
+            asicFrameRows_ = 0;
+        }
+    }
+}
+
 void IntanReader::readDataLoop() {
 
     const int streams = controller_->getNumEnabledDataStreams();
     Rhd2000DataBlockUsb3 block(streams);
     const unsigned int wordsPerBlock = Rhd2000DataBlockUsb3::calculateDataBlockSizeInWords(streams);
+    const size_t amplifierCount = (size_t)SAMPLES_PER_DATA_BLOCK * CHANNELS_PER_STREAM * streams;
+    const unsigned int fifoCapacity = Rhd2000EvalBoardUsb3::fifoCapacityInWords();
+    usbBuffer_.assign((size_t)maxBlocksPerRead_ * 2 * wordsPerBlock, 0);
     
-    std::cout << "HW publisher: wordsPerBlock=" << wordsPerBlock << " streams=" << streams << std::endl;
+    std::cout << "HW publisher: wordsPerBlock=" << wordsPerBlock << " streams=" << streams
+              << " maxBlocksPerRead=" << maxBlocksPerRead_ << std::endl;
     std::cout << "Reading waveform data continuously..." << std::endl;
     
     uint32_t timestamp = 0;
     
+    // The shared-memory transpose and decimation must finish well inside one block period
+    // (128 samples) or acquisition falls behind the FIFO; report it periodically
+    const double blockPeriodUs = 1.0e6 * SAMPLES_PER_DATA_BLOCK / controller_->getSampleRate();
+    double publishTotalUs = 0.0;
+    double publishMaxUs = 0.0;
+    uint64_t publishCount = 0;
+    // USB transfer metrics: blocks per read and FIFO fill seen before each read
+    uint64_t readCount = 0;
+    uint64_t readBlocksTotal = 0;
+    int readBlocksMax = 0;
+    unsigned int fifoPeakWords = 0;
+    auto lastReport = std::chrono::steady_clock::now();
+    
     while (running_) {
         unsigned int fifoWords = controller_->getNumWordsInFifo();
-        if (fifoWords < wordsPerBlock) { 
-            usleep(200); 
-            continue; 
+        fifoPeakWords = std::max(fifoPeakWords, fifoWords);
+        if (fifoWords < wordsPerBlock) {
+            // Sleep roughly until the missing part of a block has been sampled
+            double missing = 1.0 - (double)fifoWords / wordsPerBlock;
+            usleep(static_cast<useconds_t>(std::max(200.0, missing * blockPeriodUs)));
+            continue;
         }
         
-        while (controller_->getNumWordsInFifo() >= wordsPerBlock) {
-            if (!controller_->readDataBlock(&block)) break;
+        // Pull every whole block the FIFO holds in one USB transfer
+        int blocks = std::min((int)(fifoWords / wordsPerBlock), maxBlocksPerRead_);
+        if (controller_->readDataBlocksRaw(blocks, usbBuffer_.data()) <= 0) {
+            continue;
+        }
+        // Start of the latency trace for every frame completed by this read
+        const uint64_t acquiredNs = monotonicNowNs();
+        readCount++;
+        readBlocksTotal += blocks;
+        readBlocksMax = std::max(readBlocksMax, blocks);
+        
+        for (int i = 0; i < blocks; ++i) {
+            block.fillFromUsbBuffer(usbBuffer_.data(), i, streams);
             
             if (sharedMemoryWriter_) {
-                // Create a 3D array: [stream][channel][sample]
-                std::vector<std::vector<std::vector<int>>> amplifierData;
-                const int channelsPerStream = CHANNELS_PER_STREAM;
-                const int samplesPerBlock = SAMPLES_PER_DATA_BLOCK;
-                
-                amplifierData.resize(streams);
-                
-                // Use EXACT same loop structure and data access as working Decoupled version
-                auto computeIndex = [streams](int s, int ch, int t) { 
-                    return (t * streams * CHANNELS_PER_STREAM) + (ch * streams) + s; 
-                };
-                
-                for (int stream = 0; stream < streams; ++stream) {
-                    amplifierData[stream].resize(channelsPerStream);
-                    for (int ch = 0; ch < channelsPerStream; ++ch) {
-                        amplifierData[stream][ch].resize(samplesPerBlock);
-                        for (int t = 0; t < samplesPerBlock; ++t) {
-                            amplifierData[stream][ch][t] = block.amplifierDataFast[computeIndex(stream, ch, t)];
-                        }
-                    }
-                }
-                
-                sharedMemoryWriter_->writeDataBlock(timestamp, amplifierData);
+                // Hand the device buffer over as-is; the writer transposes it
+                // into the shared-memory slot in a single pass. The decimator
+                // reads the same buffer for the ASIC channel.
+                auto publishStart = std::chrono::steady_clock::now();
+                sharedMemoryWriter_->writeDataBlock(timestamp, block.amplifierDataFast, amplifierCount, acquiredNs);
+                publishDecimated(block.amplifierDataFast, acquiredNs);
+                double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - publishStart).count();
+                publishTotalUs += us;
+                publishMaxUs = std::max(publishMaxUs, us);
+                publishCount++;
             }
             
             timestamp += SAMPLES_PER_DATA_BLOCK;
         }
+        
+        auto now = std::chrono::steady_clock::now();
+        if (publishCount > 0 && now - lastReport >= std::chrono::seconds(10)) {
+            PLOG_INFO("reader", "HW publisher: {} channels, publish avg={:.1f}us max={:.1f}us (budget {:.1f}us per block)",
+                      streams * CHANNELS_PER_STREAM, publishTotalUs / publishCount, publishMaxUs, blockPeriodUs);
+            PLOG_INFO("reader", "HW publisher: {} USB reads, blocks/read avg={:.2f} max={}, FIFO peak={} words ({:.1f}% of capacity)",
+                      readCount, (double)readBlocksTotal / readCount, readBlocksMax, fifoPeakWords,
+                      100.0 * fifoPeakWords / fifoCapacity);
+            if (publishMaxUs > 0.5 * blockPeriodUs) {
+                PLOG_WARN("reader", "Shared memory publish is using more than half of the block period");
+            }
+            publishTotalUs = 0.0;
+            publishMaxUs = 0.0;
+            publishCount = 0;
+            readCount = 0;
+            readBlocksTotal = 0;
+            readBlocksMax = 0;
+            fifoPeakWords = 0;
+            lastReport = now;
+        }
     }
     
-}
\ No newline at end of file
+}
@@ -10,14 +10,20 @@
 #include "includes/rhd2000datablockusb3.h"
 #include "includes/rhd2000registersusb3.h"
 #include "shared_memory_writer.h"
+#include "polyphase_decimator.h"
+
+// Full-rate acquisition for the GUI and logs; the ASIC path gets a decimated copy
+#define INTAN_DEFAULT_SAMPLE_RATE 30000
+#define INTAN_ASIC_SAMPLE_RATE 1000
 
 class IntanReader {
 public:
     IntanReader();
     ~IntanReader();
     
-    // Initialize the reader with default settings
-    bool initialize();
+    // Initialize the reader. sampleRateHz must be a supported amplifier rate
+    // and a whole multiple of INTAN_ASIC_SAMPLE_RATE.
+    bool initialize(int sampleRateHz = INTAN_DEFAULT_SAMPLE_RATE);
     
     // Start continuous data acquisition
     bool start();
@@ -28,16 +34,42 @@ public:
     // Check if reader is running
     bool isRunning() const { return running_; }
     
+    // Upper bound on data blocks pulled from the USB FIFO per transfer.
+    // 1 restores one-block-per-read behaviour. Set before start().
+    void setMaxBlocksPerRead(int blocks);
+    
 
 private:
     std::unique_ptr<Rhd2000EvalBoardUsb3> controller_;
     std::atomic<bool> running_;
     std::unique_ptr<SharedMemoryWriter> sharedMemoryWriter_;
+    int sampleRateHz_;
+    int maxBlocksPerRead_;
+    std::vector<unsigned char> usbBuffer_;  // Raw bytes of one batched FIFO read
+    
+    // Decimated ASIC channel: filtered rows collect in asicFrame_ until a
+    // whole frame is ready to publish
+    std::unique_ptr<SharedMemoryWriter> asicWriter_;
+    PolyphaseDecimator decimator_;
+    std::vector<int> decimated_;
+    std::vector<int> asicFrame_;
+    size_t asicFrameRows_;
+    uint32_t asicTimestamp_;
+    
+    // Streams found by the port scan, in the order they appear in a data block
+    struct ConnectedStream {
+        int stream;   // Controller data stream index (0..MAX_NUM_DATA_STREAMS-1)
+        int port;     // Rhd2000EvalBoardUsb3::BoardPort
+        int chipId;   // Intan chip ID from ROM register 63
+    };
+    std::vector<ConnectedStream> connectedStreams_;
     
     // Internal methods
     bool openDevice();
     bool uploadBitfile();
     bool configureDevice();
+    int scanPorts(int auxCmd3Length);
+    void publishDecimated(const int* amplifierData, uint64_t acquiredNs);
     void readDataLoop();
 };
 
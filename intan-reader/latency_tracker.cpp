@@ -0,0 +1,124 @@
+#include "latency_tracker.h"
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+constexpr int kSubBucketBits = 4;
+constexpr uint64_t kSubBuckets = 1u << kSubBucketBits;
+
+const char* const kStageNames[LatencyTracker::kStageCount] = {
+    "acquire", "publish", "consume", "send", "fpga", "analyze", "total"
+};
+} // namespace
+
+LatencyTracker::LatencyTracker() {
+    for (Stage& stage : stages_) {
+        for (auto& bucket : stage.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        stage.maxNs.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyTracker::record(const LatencyTrace& trace) {
+    // Each stage is measured from the latest point before it that was stamped
+    int previous = -1;
+    for (int point = 0; point < LatencyPointCount; ++point) {
+        if (trace.ns[point] == 0) {
+            continue;
+        }
+        if (previous >= 0 && trace.ns[point] >= trace.ns[previous]) {
+            recordStage(point, trace.ns[point] - trace.ns[previous]);
+        }
+        previous = point;
+    }
+    if (trace.ns[LatencyAcquired] != 0 && previous > LatencyAcquired &&
+        trace.ns[previous] >= trace.ns[LatencyAcquired]) {
+        recordStage(kTotalStage, trace.ns[previous] - trace.ns[LatencyAcquired]);
+    }
+}
+
+void LatencyTracker::recordStage(int stage, uint64_t ns) {
+    if (stage < 0 || stage >= kStageCount) {
+        return;
+    }
+    Stage& s = stages_[stage];
+    s.buckets[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t seen = s.maxNs.load(std::memory_order_relaxed);
+    while (ns > seen && !s.maxNs.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+    }
+}
+
+std::vector<LatencyStageSummary> LatencyTracker::snapshot(bool reset) {
+    std::vector<LatencyStageSummary> summaries;
+    std::vector<uint64_t> counts(kBuckets);
+    for (int stage = 0; stage < kStageCount; ++stage) {
+        Stage& s = stages_[stage];
+        uint64_t total = 0;
+        for (size_t b = 0; b < kBuckets; ++b) {
+            counts[b] = reset ? s.buckets[b].exchange(0, std::memory_order_relaxed)
+                              : s.buckets[b].load(std::memory_order_relaxed);
+            total += counts[b];
+        }
+        uint64_t maxNs = reset ? s.maxNs.exchange(0, std::memory_order_relaxed)
+                               : s.maxNs.load(std::memory_order_relaxed);
+        if (total == 0) {
+            continue;
+        }
+
+        // Upper edge of the bucket holding the rank, capped at the true max
+        auto percentileUs = [&](double fraction) {
+            uint64_t rank = static_cast<uint64_t>(fraction * (total - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t b = 0; b < kBuckets; ++b) {
+                seen += counts[b];
+                if (seen >= rank) {
+                    return std::min(bucketUpperNs(b), maxNs) / 1000.0;
+                }
+            }
+            return maxNs / 1000.0;
+        };
+
+        LatencyStageSummary summary;
+        summary.name = kStageNames[stage];
+        summary.count = total;
+        summary.p50Us = percentileUs(0.50);
+        summary.p99Us = percentileUs(0.99);
+        summary.maxUs = maxNs / 1000.0;
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
+
+void LatencyTracker::report(std::ostream& out, const char* prefix, bool reset) {
+    for (const LatencyStageSummary& s : snapshot(reset)) {
+        out << prefix << " " << std::left << std::setw(8) << s.name << std::right
+            << " n=" << s.count << std::fixed << std::setprecision(1)
+            << " p50=" << s.p50Us << "us p99=" << s.p99Us << "us max=" << s.maxUs << "us"
+            << std::defaultfloat << std::endl;
+    }
+}
+
+const char* LatencyTracker::stageName(int stage) {
+    return stage >= 0 && stage < kStageCount ? kStageNames[stage] : "unknown";
+}
+
+size_t LatencyTracker::bucketFor(uint64_t ns) {
+    if (ns < kSubBuckets) {
+        return static_cast<size_t>(ns);
+    }
+    // Power-of-two group from the top bit, then 16 linear steps inside it
+    int msb = 63 - __builtin_clzll(ns);
+    size_t bucket = static_cast<size_t>(msb - kSubBucketBits + 1) * kSubBuckets +
+                    ((ns >> (msb - kSubBucketBits)) & (kSubBuckets - 1));
+    return std::min(bucket, kBuckets - 1);
+}
+
+uint64_t LatencyTracker::bucketUpperNs(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket + 1;
+    }
+    size_t group = bucket / kSubBuckets;
+    uint64_t sub = bucket % kSubBuckets;
+    return (kSubBuckets + sub + 1) << (group - 1);
+}
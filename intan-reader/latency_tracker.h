@@ -0,0 +1,81 @@
+#ifndef LATENCY_TRACKER_H
+#define LATENCY_TRACKER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Monotonic nanoseconds. steady_clock is CLOCK_MONOTONIC on Linux and the
+// mach absolute clock on macOS, both system-wide, so stamps taken in the
+// Intan reader and in another process reading shared memory are comparable.
+inline uint64_t monotonicNowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Points a frame passes on its way from the ADC to a seizure result
+enum LatencyPoint {
+    LatencyAcquired,   // USB read holding the frame's newest sample returned (IntanReader)
+    LatencyPublished,  // Frame published to shared memory (ShmFrameRing::endWrite)
+    LatencyConsumed,   // Frame copied out by the pipeline (SharedMemoryReader)
+    LatencySent,       // Pipe-in transfer carrying the frame completed (AsicSender)
+    LatencyResponded,  // Pipe-out transfer with its response completed (AsicSender)
+    LatencyAnalyzed,   // Result decoded and logged (FpgaLogger)
+    LatencyPointCount
+};
+
+// Monotonic stamps of one frame; 0 = the frame did not pass that point
+// (e.g. no Sent/Responded when pipeline 6 runs on the CPU)
+struct LatencyTrace {
+    uint64_t ns[LatencyPointCount] = {};
+
+    void stamp(LatencyPoint point) { ns[point] = monotonicNowNs(); }
+};
+
+struct LatencyStageSummary {
+    const char* name;
+    uint64_t count;
+    double p50Us;
+    double p99Us;
+    double maxUs;
+};
+
+// Lock-free per-stage latency histograms. Each stage runs from the previous
+// stamped point to the point it is named after, plus one end-to-end stage
+// from LatencyAcquired to the last stamped point. Buckets are log-linear
+// (16 per power of two), so percentiles are within ~6%; the max is exact.
+class LatencyTracker {
+public:
+    static const int kTotalStage = LatencyPointCount; // Index of the end-to-end stage
+    static const int kStageCount = LatencyPointCount + 1;
+
+    LatencyTracker();
+
+    // Safe to call from any thread
+    void record(const LatencyTrace& trace);
+    void recordStage(int stage, uint64_t ns);
+
+    // Stages with at least one sample since the last reset
+    std::vector<LatencyStageSummary> snapshot(bool reset);
+    // One line per stage: "<prefix> publish n=... p50=...us p99=...us max=...us"
+    void report(std::ostream& out, const char* prefix, bool reset = true);
+
+    static const char* stageName(int stage);
+
+private:
+    static const size_t kBuckets = 608; // Up to 2^40 ns (~18 min)
+
+    static size_t bucketFor(uint64_t ns);
+    static uint64_t bucketUpperNs(size_t bucket);
+
+    struct Stage {
+        std::atomic<uint64_t> buckets[kBuckets];
+        std::atomic<uint64_t> maxNs;
+    };
+    Stage stages_[kStageCount];
+};
+
+#endif // LATENCY_TRACKER_H
@@ -0,0 +1,123 @@
+#include "polyphase_decimator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+// Filtering runs on codes centred around zero so the float accumulators keep
+// their precision; the offset is added back on output
+constexpr float kCenterCode = 32768.0f;
+constexpr size_t kHistoryRows = 1024;  // Input rows buffered between compactions
+constexpr int kLaneBlock = 16;         // Accumulators held in registers per pass
+constexpr double kPi = 3.14159265358979323846;
+} // namespace
+
+PolyphaseDecimator::PolyphaseDecimator()
+    : lanes_(0), factor_(1), historyRows_(0), capacityRows_(0), nextOutputRow_(0),
+      convert_(&sampleConvertKernels()) {
+}
+
+bool PolyphaseDecimator::configure(int lanes, int factor, int tapsPerPhase, double cutoffFraction) {
+    if (lanes <= 0 || factor <= 0 || tapsPerPhase <= 0 || cutoffFraction <= 0.0 || cutoffFraction > 1.0) {
+        return false;
+    }
+    lanes_ = lanes;
+    factor_ = factor;
+
+    // Windowed-sinc low-pass. Cutoff in cycles per input sample.
+    const size_t numTaps = factor == 1 ? 1 : (size_t)tapsPerPhase * factor + 1;
+    const double cutoff = 0.5 * cutoffFraction / factor;
+    const double center = 0.5 * (numTaps - 1);
+    std::vector<double> h(numTaps, 1.0);
+    double sum = 0.0;
+    for (size_t n = 0; n < numTaps && numTaps > 1; ++n) {
+        double x = (double)n - center;
+        double sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * kPi * cutoff * x) / (kPi * x);
+        double window = 0.42 - 0.5 * std::cos(2.0 * kPi * n / (numTaps - 1)) + 0.08 * std::cos(4.0 * kPi * n / (numTaps - 1));
+        h[n] = sinc * window;
+    }
+    for (double v : h) {
+        sum += v;
+    }
+
+    // Unity DC gain; store reversed so taps_[k] pairs with the k-th oldest row
+    taps_.resize(numTaps);
+    for (size_t n = 0; n < numTaps; ++n) {
+        taps_[numTaps - 1 - n] = static_cast<float>(h[n] / sum);
+    }
+
+    capacityRows_ = (numTaps - 1) + kHistoryRows;
+    history_.assign(capacityRows_ * lanes_, 0.0f);
+    acc_.assign(lanes_, 0.0f);
+    reset();
+    return true;
+}
+
+void PolyphaseDecimator::reset() {
+    // Start from a flat (mid-scale) signal so the first outputs are not a step
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    historyRows_ = taps_.empty() ? 0 : taps_.size() - 1;
+    nextOutputRow_ = historyRows_;
+}
+
+void PolyphaseDecimator::compact() {
+    // Keep only the numTaps-1 rows the filter still needs
+    const size_t keep = taps_.size() - 1;
+    const size_t shift = historyRows_ - keep;
+    std::memmove(history_.data(), history_.data() + shift * lanes_, keep * lanes_ * sizeof(float));
+    historyRows_ = keep;
+    nextOutputRow_ -= shift;
+}
+
+size_t PolyphaseDecimator::process(const int* input, size_t rows, int* output) {
+    if (taps_.empty() || !input || !output) {
+        return 0;
+    }
+
+    const size_t numTaps = taps_.size();
+    const size_t lanes = (size_t)lanes_;
+    size_t produced = 0;
+    while (rows > 0) {
+        if (historyRows_ == capacityRows_) {
+            compact();
+        }
+        size_t chunk = std::min(rows, capacityRows_ - historyRows_);
+        convert_->codesToMicrovolts(input, history_.data() + historyRows_ * lanes, chunk * lanes, 1.0f, kCenterCode);
+        historyRows_ += chunk;
+        input += chunk * lanes;
+        rows -= chunk;
+
+        // Evaluate only the rows that survive decimation
+        for (; nextOutputRow_ < historyRows_; nextOutputRow_ += factor_) {
+            const float* window = history_.data() + (nextOutputRow_ + 1 - numTaps) * lanes;
+            const float* taps = taps_.data();
+            size_t lane = 0;
+            for (; lane + kLaneBlock <= lanes; lane += kLaneBlock) {
+                float sums[kLaneBlock] = {};
+                const float* column = window + lane;
+                for (size_t k = 0; k < numTaps; ++k) {
+                    const float tap = taps[k];
+                    const float* row = column + k * lanes;
+                    for (int j = 0; j < kLaneBlock; ++j) {
+                        sums[j] += tap * row[j];
+                    }
+                }
+                std::memcpy(acc_.data() + lane, sums, sizeof(sums));
+            }
+            for (; lane < lanes; ++lane) {
+                float sum = 0.0f;
+                for (size_t k = 0; k < numTaps; ++k) {
+                    sum += taps[k] * window[k * lanes + lane];
+                }
+                acc_[lane] = sum;
+            }
+
+            int* out = output + produced * lanes;
+            for (size_t l = 0; l < lanes; ++l) {
+                out[l] = (int)std::lrint(acc_[l] + kCenterCode);
+            }
+            ++produced;
+        }
+    }
+    return produced;
+}
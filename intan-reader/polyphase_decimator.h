@@ -0,0 +1,48 @@
+#ifndef POLYPHASE_DECIMATOR_H
+#define POLYPHASE_DECIMATOR_H
+
+#include <cstddef>
+#include <vector>
+
+#include "sample_convert.h"
+
+// Anti-alias FIR decimator for multi-channel sample rows.
+//
+// Input and output are rows of `lanes` int codes, one row per sample (the
+// device order of amplifierDataFast, or any other fixed lane order). Only
+// every factor-th output is computed, which is the polyphase form of
+// filter-then-downsample. The inner loop runs across lanes, so all channels
+// are filtered together with SIMD-friendly contiguous loads.
+class PolyphaseDecimator {
+public:
+    PolyphaseDecimator();
+
+    // Windowed-sinc (Blackman) low-pass with tapsPerPhase * factor + 1 taps and
+    // a cutoff of cutoffFraction * (output Nyquist). factor 1 is a passthrough.
+    bool configure(int lanes, int factor, int tapsPerPhase = 16, double cutoffFraction = 0.8);
+    void reset();
+
+    // Filter `rows` input rows and write the decimated rows to output, which
+    // must have room for maxOutputRows(rows) rows. Returns the rows written.
+    size_t process(const int* input, size_t rows, int* output);
+    size_t maxOutputRows(size_t inputRows) const { return inputRows / factor_ + 1; }
+
+    int lanes() const { return lanes_; }
+    int factor() const { return factor_; }
+    size_t numTaps() const { return taps_.size(); }
+
+private:
+    void compact();
+
+    int lanes_;
+    int factor_;
+    std::vector<float> taps_;     // Reversed impulse response: taps_[0] weights the oldest row
+    std::vector<float> history_;  // Sample-major float rows; the last numTaps-1 rows are filter state
+    std::vector<float> acc_;      // One output row being accumulated
+    size_t historyRows_;          // Valid rows in history_
+    size_t capacityRows_;
+    size_t nextOutputRow_;        // History row that completes the next output
+    const SampleConvertKernels* convert_;
+};
+
+#endif // POLYPHASE_DECIMATOR_H
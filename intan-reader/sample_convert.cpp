@@ -0,0 +1,336 @@
+#include "sample_convert.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SAMPLE_CONVERT_X86 1
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SAMPLE_CONVERT_NEON 1
+#endif
+
+namespace {
+constexpr float kByteOffsetMicrovolts = 1000.0f;
+constexpr float kMicrovoltsPerByteInv = 0.125f; // 1 / 8, exact
+
+// ---------------------------------------------------------------------------
+// Scalar kernels. These define the reference results; each float step is its
+// own statement so the compiler cannot contract them into an FMA.
+// ---------------------------------------------------------------------------
+
+inline uint8_t microvoltsToByte(float microvolts) {
+    float scaled = microvolts + kByteOffsetMicrovolts;
+    scaled = scaled * kMicrovoltsPerByteInv;
+    scaled = std::max(0.0f, std::min(255.0f, scaled));
+    return static_cast<uint8_t>(scaled);
+}
+
+void codesToU16Scalar(const int* codes, uint16_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<uint16_t>(std::min(std::max(codes[i], 0), 65535));
+    }
+}
+
+void codesToMicrovoltsScalar(const int* codes, float* out, size_t count, float scale, float offset) {
+    for (size_t i = 0; i < count; ++i) {
+        float centered = static_cast<float>(codes[i]) - offset;
+        out[i] = centered * scale;
+    }
+}
+
+void microvoltsToBytesScalar(const float* microvolts, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = microvoltsToByte(microvolts[i]);
+    }
+}
+
+void codesToBytesScalar(const uint16_t* codes, uint8_t* out, size_t count, float scale, float offset) {
+    for (size_t i = 0; i < count; ++i) {
+        float centered = static_cast<float>(codes[i]) - offset;
+        float microvolts = centered * scale;
+        out[i] = microvoltsToByte(microvolts);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// SSE2 kernels (baseline on x86_64)
+// ---------------------------------------------------------------------------
+#if defined(SAMPLE_CONVERT_X86) && defined(__SSE2__)
+
+// Four floats -> four clamped byte values in the low lanes of an epi32 vector
+inline __m128i bytesFromMicrovoltsSse2(__m128 microvolts) {
+    __m128 scaled = _mm_add_ps(microvolts, _mm_set1_ps(kByteOffsetMicrovolts));
+    scaled = _mm_mul_ps(scaled, _mm_set1_ps(kMicrovoltsPerByteInv));
+    scaled = _mm_max_ps(_mm_min_ps(scaled, _mm_set1_ps(255.0f)), _mm_setzero_ps());
+    return _mm_cvttps_epi32(scaled);
+}
+
+inline void storeBytesSse2(uint8_t* out, __m128i a, __m128i b, __m128i c, __m128i d) {
+    __m128i lo = _mm_packs_epi32(a, b);
+    __m128i hi = _mm_packs_epi32(c, d);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(lo, hi));
+}
+
+void codesToU16Sse2(const int* codes, uint16_t* out, size_t count) {
+    // SSE2 has no unsigned 32->16 pack, so bias into signed range, saturate,
+    // and flip the sign bit back. Negative codes are zeroed first so the bias
+    // cannot wrap.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi32(32768);
+    const __m128i flip = _mm_set1_epi16(static_cast<short>(0x8000));
+    auto biased = [&](const int* p) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        v = _mm_andnot_si128(_mm_cmplt_epi32(v, zero), v);
+        return _mm_sub_epi32(v, bias);
+    };
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i packed = _mm_xor_si128(_mm_packs_epi32(biased(codes + i), biased(codes + i + 4)), flip);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+    codesToU16Scalar(codes + i, out + i, count - i);
+}
+
+void codesToMicrovoltsSse2(const int* codes, float* out, size_t count, float scale, float offset) {
+    const __m128 vScale = _mm_set1_ps(scale);
+    const __m128 vOffset = _mm_set1_ps(offset);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + i)));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_sub_ps(v, vOffset), vScale));
+    }
+    codesToMicrovoltsScalar(codes + i, out + i, count - i, scale, offset);
+}
+
+void microvoltsToBytesSse2(const float* microvolts, uint8_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        storeBytesSse2(out + i,
+                       bytesFromMicrovoltsSse2(_mm_loadu_ps(microvolts + i)),
+                       bytesFromMicrovoltsSse2(_mm_loadu_ps(microvolts + i + 4)),
+                       bytesFromMicrovoltsSse2(_mm_loadu_ps(microvolts + i + 8)),
+                       bytesFromMicrovoltsSse2(_mm_loadu_ps(microvolts + i + 12)));
+    }
+    microvoltsToBytesScalar(microvolts + i, out + i, count - i);
+}
+
+void codesToBytesSse2(const uint16_t* codes, uint8_t* out, size_t count, float scale, float offset) {
+    const __m128 vScale = _mm_set1_ps(scale);
+    const __m128 vOffset = _mm_set1_ps(offset);
+    const __m128i zero = _mm_setzero_si128();
+    auto convert = [&](__m128i codes32) {
+        __m128 v = _mm_sub_ps(_mm_cvtepi32_ps(codes32), vOffset);
+        return bytesFromMicrovoltsSse2(_mm_mul_ps(v, vScale));
+    };
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + i));
+        __m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + i + 8));
+        storeBytesSse2(out + i,
+                       convert(_mm_unpacklo_epi16(c0, zero)), convert(_mm_unpackhi_epi16(c0, zero)),
+                       convert(_mm_unpacklo_epi16(c1, zero)), convert(_mm_unpackhi_epi16(c1, zero)));
+    }
+    codesToBytesScalar(codes + i, out + i, count - i, scale, offset);
+}
+
+const SampleConvertKernels kSse2Kernels = {
+    SampleConvertIsa::SSE2, "sse2",
+    codesToU16Sse2, codesToMicrovoltsSse2, microvoltsToBytesSse2, codesToBytesSse2
+};
+#endif
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels, compiled with a target attribute and only used when the CPU
+// reports AVX2 at runtime
+// ---------------------------------------------------------------------------
+#if defined(SAMPLE_CONVERT_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SAMPLE_CONVERT_AVX2 1
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET inline __m256i bytesFromMicrovoltsAvx2(__m256 microvolts) {
+    __m256 scaled = _mm256_add_ps(microvolts, _mm256_set1_ps(kByteOffsetMicrovolts));
+    scaled = _mm256_mul_ps(scaled, _mm256_set1_ps(kMicrovoltsPerByteInv));
+    scaled = _mm256_max_ps(_mm256_min_ps(scaled, _mm256_set1_ps(255.0f)), _mm256_setzero_ps());
+    return _mm256_cvttps_epi32(scaled);
+}
+
+// Sixteen epi32 byte values (two vectors) -> sixteen bytes, in order
+AVX2_TARGET inline void storeBytesAvx2(uint8_t* out, __m256i a, __m256i b) {
+    // packs works per 128-bit lane; permute restores element order
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+    __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+}
+
+AVX2_TARGET void codesToU16Avx2(const int* codes, uint16_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes + i + 8));
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    codesToU16Scalar(codes + i, out + i, count - i);
+}
+
+AVX2_TARGET void codesToMicrovoltsAvx2(const int* codes, float* out, size_t count, float scale, float offset) {
+    const __m256 vScale = _mm256_set1_ps(scale);
+    const __m256 vOffset = _mm256_set1_ps(offset);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 v = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_sub_ps(v, vOffset), vScale));
+    }
+    codesToMicrovoltsScalar(codes + i, out + i, count - i, scale, offset);
+}
+
+AVX2_TARGET void microvoltsToBytesAvx2(const float* microvolts, uint8_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        storeBytesAvx2(out + i,
+                       bytesFromMicrovoltsAvx2(_mm256_loadu_ps(microvolts + i)),
+                       bytesFromMicrovoltsAvx2(_mm256_loadu_ps(microvolts + i + 8)));
+    }
+    microvoltsToBytesScalar(microvolts + i, out + i, count - i);
+}
+
+AVX2_TARGET void codesToBytesAvx2(const uint16_t* codes, uint8_t* out, size_t count, float scale, float offset) {
+    const __m256 vScale = _mm256_set1_ps(scale);
+    const __m256 vOffset = _mm256_set1_ps(offset);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i c0 = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + i)));
+        __m256i c1 = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + i + 8)));
+        __m256 v0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(c0), vOffset), vScale);
+        __m256 v1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(c1), vOffset), vScale);
+        storeBytesAvx2(out + i, bytesFromMicrovoltsAvx2(v0), bytesFromMicrovoltsAvx2(v1));
+    }
+    codesToBytesScalar(codes + i, out + i, count - i, scale, offset);
+}
+
+const SampleConvertKernels kAvx2Kernels = {
+    SampleConvertIsa::AVX2, "avx2",
+    codesToU16Avx2, codesToMicrovoltsAvx2, microvoltsToBytesAvx2, codesToBytesAvx2
+};
+#endif
+
+// ---------------------------------------------------------------------------
+// NEON kernels (baseline on arm64, e.g. Apple Silicon)
+// ---------------------------------------------------------------------------
+#if defined(SAMPLE_CONVERT_NEON)
+
+inline uint16x4_t bytesFromMicrovoltsNeon(float32x4_t microvolts) {
+    float32x4_t scaled = vaddq_f32(microvolts, vdupq_n_f32(kByteOffsetMicrovolts));
+    scaled = vmulq_f32(scaled, vdupq_n_f32(kMicrovoltsPerByteInv));
+    scaled = vmaxq_f32(vminq_f32(scaled, vdupq_n_f32(255.0f)), vdupq_n_f32(0.0f));
+    return vmovn_u32(vcvtq_u32_f32(scaled));
+}
+
+inline void storeBytesNeon(uint8_t* out, uint16x4_t a, uint16x4_t b, uint16x4_t c, uint16x4_t d) {
+    vst1q_u8(out, vcombine_u8(vmovn_u16(vcombine_u16(a, b)), vmovn_u16(vcombine_u16(c, d))));
+}
+
+void codesToU16Neon(const int* codes, uint16_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x4_t lo = vqmovun_s32(vld1q_s32(codes + i));
+        uint16x4_t hi = vqmovun_s32(vld1q_s32(codes + i + 4));
+        vst1q_u16(out + i, vcombine_u16(lo, hi));
+    }
+    codesToU16Scalar(codes + i, out + i, count - i);
+}
+
+void codesToMicrovoltsNeon(const int* codes, float* out, size_t count, float scale, float offset) {
+    const float32x4_t vScale = vdupq_n_f32(scale);
+    const float32x4_t vOffset = vdupq_n_f32(offset);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t v = vcvtq_f32_s32(vld1q_s32(codes + i));
+        vst1q_f32(out + i, vmulq_f32(vsubq_f32(v, vOffset), vScale));
+    }
+    codesToMicrovoltsScalar(codes + i, out + i, count - i, scale, offset);
+}
+
+void microvoltsToBytesNeon(const float* microvolts, uint8_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        storeBytesNeon(out + i,
+                       bytesFromMicrovoltsNeon(vld1q_f32(microvolts + i)),
+                       bytesFromMicrovoltsNeon(vld1q_f32(microvolts + i + 4)),
+                       bytesFromMicrovoltsNeon(vld1q_f32(microvolts + i + 8)),
+                       bytesFromMicrovoltsNeon(vld1q_f32(microvolts + i + 12)));
+    }
+    microvoltsToBytesScalar(microvolts + i, out + i, count - i);
+}
+
+void codesToBytesNeon(const uint16_t* codes, uint8_t* out, size_t count, float scale, float offset) {
+    const float32x4_t vScale = vdupq_n_f32(scale);
+    const float32x4_t vOffset = vdupq_n_f32(offset);
+    auto convert = [&](uint16x4_t codes16) {
+        float32x4_t v = vsubq_f32(vcvtq_f32_u32(vmovl_u16(codes16)), vOffset);
+        return bytesFromMicrovoltsNeon(vmulq_f32(v, vScale));
+    };
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint16x8_t c0 = vld1q_u16(codes + i);
+        uint16x8_t c1 = vld1q_u16(codes + i + 8);
+        storeBytesNeon(out + i,
+                       convert(vget_low_u16(c0)), convert(vget_high_u16(c0)),
+                       convert(vget_low_u16(c1)), convert(vget_high_u16(c1)));
+    }
+    codesToBytesScalar(codes + i, out + i, count - i, scale, offset);
+}
+
+const SampleConvertKernels kNeonKernels = {
+    SampleConvertIsa::NEON, "neon",
+    codesToU16Neon, codesToMicrovoltsNeon, microvoltsToBytesNeon, codesToBytesNeon
+};
+#endif
+
+const SampleConvertKernels kScalarKernels = {
+    SampleConvertIsa::Scalar, "scalar",
+    codesToU16Scalar, codesToMicrovoltsScalar, microvoltsToBytesScalar, codesToBytesScalar
+};
+
+const SampleConvertKernels* selectKernels() {
+    const SampleConvertKernels* best = &kScalarKernels;
+    for (SampleConvertIsa isa : {SampleConvertIsa::SSE2, SampleConvertIsa::NEON, SampleConvertIsa::AVX2}) {
+        if (const SampleConvertKernels* k = sampleConvertKernelsFor(isa)) {
+            best = k;
+        }
+    }
+    return best;
+}
+} // namespace
+
+const SampleConvertKernels* sampleConvertKernelsFor(SampleConvertIsa isa) {
+    switch (isa) {
+        case SampleConvertIsa::Scalar:
+            return &kScalarKernels;
+        case SampleConvertIsa::SSE2:
+#if defined(SAMPLE_CONVERT_X86) && defined(__SSE2__)
+            return &kSse2Kernels;
+#else
+            return nullptr;
+#endif
+        case SampleConvertIsa::AVX2:
+#if defined(SAMPLE_CONVERT_AVX2)
+            return __builtin_cpu_supports("avx2") ? &kAvx2Kernels : nullptr;
+#else
+            return nullptr;
+#endif
+        case SampleConvertIsa::NEON:
+#if defined(SAMPLE_CONVERT_NEON)
+            return &kNeonKernels;
+#else
+            return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+const SampleConvertKernels& sampleConvertKernels() {
+    static const SampleConvertKernels* kernels = selectKernels();
+    return *kernels;
+}
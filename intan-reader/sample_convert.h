@@ -0,0 +1,39 @@
+#ifndef SAMPLE_CONVERT_H
+#define SAMPLE_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Bulk sample conversions used on the acquisition and ASIC paths.
+//
+//   codes -> uint16:   clamp raw int codes from amplifierDataFast to 0..65535
+//   codes -> uV:       uV = (code - offset) * scale
+//   uV -> uint8:       byte = clamp((uV + 1000) / 8, 0, 255), truncated
+//   uint16 -> uint8:   both steps fused, without materialising the floats
+//
+// Every kernel performs the same float operations in the same order, so all
+// of them produce bit-identical output to the scalar versions.
+
+enum class SampleConvertIsa {
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON
+};
+
+struct SampleConvertKernels {
+    SampleConvertIsa isa;
+    const char* name;
+    void (*codesToU16)(const int* codes, uint16_t* out, size_t count);
+    void (*codesToMicrovolts)(const int* codes, float* out, size_t count, float scale, float offset);
+    void (*microvoltsToBytes)(const float* microvolts, uint8_t* out, size_t count);
+    void (*codesToBytes)(const uint16_t* codes, uint8_t* out, size_t count, float scale, float offset);
+};
+
+// Best kernels for the running CPU, picked once on first use
+const SampleConvertKernels& sampleConvertKernels();
+
+// Kernels for one instruction set, or nullptr if this CPU/build lacks it
+const SampleConvertKernels* sampleConvertKernelsFor(SampleConvertIsa isa);
+
+#endif // SAMPLE_CONVERT_H
@@ -1,10 +1,12 @@
 #include "shared_memory_reader.h"
+#include "async_logger.h"
 #include <iostream>
 #include <cstring>
 
-SharedMemoryReader::SharedMemoryReader() 
-    : shmFd(-1), shmBase(nullptr), shmSize(0), shmName("/intan_rhx_shm_v1"), 
-      header(nullptr), shmInput(nullptr), lastTimestamp(0) {
+SharedMemoryReader::SharedMemoryReader(const char* name)
+    : shmFd(-1), shmBase(nullptr), shmSize(0), shmName(name), 
+      lastTimestamp(0), nextFrame_(0), framesRead_(0), framesSkipped_(0), framesDuplicated_(0),
+      convert_(&sampleConvertKernels()) {
 }
 
 SharedMemoryReader::~SharedMemoryReader() {
@@ -40,51 +42,175 @@ bool SharedMemoryReader::openSharedMemory() {
         return false;
     }
     
-    // Set up pointers
-    header = static_cast<IntanDataHeader*>(shmBase);
-    shmInput = reinterpret_cast<IntanDataBlock*>(static_cast<char*>(shmBase) + sizeof(IntanDataHeader));
+    // Bind to the slot ring laid out by the writer
+    if (!ring_.attach(shmBase, shmSize)) {
+        std::cerr << "Shared memory segment has an unsupported layout" << std::endl;
+        cleanup();
+        return false;
+    }
+    
+    // Negotiate the payload format from the header
+    const IntanDataHeader* header = ring_.header();
+    size_t samples = (size_t)header->streamCount * header->channelCount * header->samplesPerFrame;
+    size_t expectedBytes = 0;
+    switch (header->encoding) {
+        case IntanFrameFloatBlocks:
+            expectedBytes = samples * sizeof(IntanDataBlock);
+            break;
+        case IntanFrameU16SampleMajor:
+        case IntanFrameU16ChannelMajor:
+            expectedBytes = samples * sizeof(uint16_t);
+            break;
+        default:
+            std::cerr << "Shared memory frame encoding " << header->encoding << " is not supported" << std::endl;
+            cleanup();
+            return false;
+    }
+    if (header->frameBytes < expectedBytes) {
+        std::cerr << "Shared memory frame size does not match its geometry" << std::endl;
+        cleanup();
+        return false;
+    }
+    frameBuffer_.resize(header->frameBytes);
+    // Frame-exact reads start with the next frame published after attaching
+    nextFrame_ = ring_.publishedCount();
+    valueScratch_.resize(header->encoding == IntanFrameFloatBlocks ? samples : 0);
+    byteScratch_.resize(header->encoding == IntanFrameU16ChannelMajor ? samples : 0);
     
     std::cout << "Shared memory reader initialized successfully (size=" << shmSize << " bytes)" << std::endl;
     return true;
 }
 
 bool SharedMemoryReader::readLatestData(std::vector<uint8_t>& waveformData) {
-    if (!shmBase || !header || !shmInput) {
+    if (!ring_.isAttached()) {
         return false;
     }
     
-    lastTimestamp = header->timestamp;
+    // Copy out the newest published frame; if the writer laps us mid-copy,
+    // retry with whatever is newest now
+    bool haveFrame = false;
+    for (int attempt = 0; attempt < 4 && !haveFrame; ++attempt) {
+        uint64_t published = ring_.publishedCount();
+        if (published == 0) {
+            return false;
+        }
+        haveFrame = ring_.readFrame(published - 1, frameBuffer_.data(),
+                                    frameBuffer_.size(), &lastTimestamp, &trace_) == ShmFrameRing::FrameOk;
+        if (haveFrame) {
+            nextFrame_ = published;
+        }
+    }
+    if (!haveFrame) {
+        return false;
+    }
+    
+    convertFrame(waveformData);
+    trace_.stamp(LatencyConsumed);
+    return true;
+}
+
+bool SharedMemoryReader::readNextFrame(std::vector<uint8_t>& waveformData) {
+    if (!ring_.isAttached()) {
+        return false;
+    }
+    
+    const uint32_t slotCount = ring_.header()->slotCount;
+    uint32_t timestamp = 0;
+    for (;;) {
+        ShmFrameRing::ReadStatus status = ring_.readFrame(nextFrame_, frameBuffer_.data(),
+                                                          frameBuffer_.size(), &timestamp, &trace_);
+        if (status == ShmFrameRing::FrameOk) {
+            break;
+        }
+        if (status == ShmFrameRing::FrameNotReady) {
+            return false;
+        }
+        
+        // Lapped: resume at the oldest slot the writer is not about to reuse
+        uint64_t published = ring_.publishedCount();
+        uint64_t oldest = published > slotCount ? published - slotCount + 1 : 0;
+        if (oldest <= nextFrame_) {
+            oldest = nextFrame_ + 1;
+        }
+        framesSkipped_ += oldest - nextFrame_;
+        nextFrame_ = oldest;
+    }
     
-    // Calculate number of data blocks (all channels from all streams)
-    size_t dataSize = header->dataSize;
-    size_t numBlocks = dataSize / sizeof(IntanDataBlock);
+    countFrame(timestamp);
+    ++nextFrame_;
+    convertFrame(waveformData);
+    trace_.stamp(LatencyConsumed);
+    return true;
+}
+
+void SharedMemoryReader::countFrame(uint32_t timestamp) {
+    // The writer stamps frames with a running sample count, so a stamp that
+    // does not move forward means the same block was published twice
+    if (framesRead_ > 0 && static_cast<int32_t>(timestamp - lastTimestamp) <= 0) {
+        ++framesDuplicated_;
+    }
+    lastTimestamp = timestamp;
+    ++framesRead_;
+}
+
+void SharedMemoryReader::convertFrame(std::vector<uint8_t>& waveformData) {
+    const IntanDataHeader* header = ring_.header();
     
     // Verify we have the expected number of channels
     if (header->channelCount != 32) {
-        std::cerr << "[WARNING] Expected 32 channels, got " << header->channelCount << std::endl;
+        PLOG_WARN("shm", "Expected 32 channels, got {}", header->channelCount);
     }
     
-    // Convert neural data to waveform format for all channels
-    waveformData.clear();
-    waveformData.reserve(numBlocks); // Reserve space for all data blocks
+    // Convert neural data to waveform format for all channels, always in
+    // [sample][stream][channel] order whatever the shared memory layout is
+    const size_t streams = header->streamCount;
+    const size_t channels = header->channelCount;
+    const size_t samples = header->samplesPerFrame;
+    const size_t lanes = streams * channels;
+    waveformData.resize(lanes * samples);
     
-    for (size_t i = 0; i < numBlocks; ++i) {
-        IntanDataBlock& block = shmInput[i];
-        
-        // Convert float to uint8_t (scale from neural range to 0-255)
-        // Neural data is typically in microvolts, scale to reasonable range
-        float scaledValue = (block.value + 1000.0f) / 8.0f; // Scale to 0-255 range
-        scaledValue = std::max(0.0f, std::min(255.0f, scaledValue));
-        
-        uint8_t byteValue = static_cast<uint8_t>(scaledValue);
-        waveformData.push_back(byteValue);
+    // Scale to 0-255 for the ASIC: (uV + 1000) / 8, clamped
+    switch (header->encoding) {
+        case IntanFrameFloatBlocks: {
+            const IntanDataBlock* blocks = reinterpret_cast<const IntanDataBlock*>(frameBuffer_.data());
+            for (size_t i = 0; i < valueScratch_.size(); ++i) {
+                valueScratch_[i] = blocks[i].value;
+            }
+            convert_->microvoltsToBytes(valueScratch_.data(), waveformData.data(), waveformData.size());
+            break;
+        }
+        case IntanFrameU16SampleMajor: {
+            // Already in output order: codes go straight to bytes
+            const uint16_t* codes = reinterpret_cast<const uint16_t*>(frameBuffer_.data());
+            convert_->codesToBytes(codes, waveformData.data(), waveformData.size(),
+                                   header->sampleScale, header->sampleOffset);
+            break;
+        }
+        case IntanFrameU16ChannelMajor: {
+            const uint16_t* codes = reinterpret_cast<const uint16_t*>(frameBuffer_.data());
+            convert_->codesToBytes(codes, byteScratch_.data(), byteScratch_.size(),
+                                   header->sampleScale, header->sampleOffset);
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                const uint8_t* laneBytes = byteScratch_.data() + lane * samples;
+                for (size_t t = 0; t < samples; ++t) {
+                    waveformData[t * lanes + lane] = laneBytes[t];
+                }
+            }
+            break;
+        }
     }
-    
-    // Debug output removed for long-term stability
-    return true;
+}
+
+bool SharedMemoryReader::waitForData(int timeoutMs) {
+    if (!ring_.isAttached()) {
+        return false;
+    }
+    return ring_.waitForFrame(nextFrame_, timeoutMs);
 }
 
 void SharedMemoryReader::cleanup() {
+    ring_.detach();
+    
     if (shmBase && shmBase != MAP_FAILED) {
         munmap(shmBase, shmSize);
         shmBase = nullptr;
@@ -94,7 +220,4 @@ void SharedMemoryReader::cleanup() {
         close(shmFd);
         shmFd = -1;
     }
-    
-    header = nullptr;
-    shmInput = nullptr;
 }
@@ -10,28 +10,53 @@
 #include <chrono>
 
 #include "intan_data_types.h"
+#include "shm_frame_ring.h"
+#include "sample_convert.h"
 
 class SharedMemoryReader {
 public:
-    SharedMemoryReader();
+    explicit SharedMemoryReader(const char* name = INTAN_SHM_NAME);
     ~SharedMemoryReader();
     
     bool initialize();
     bool readLatestData(std::vector<uint8_t>& waveformData);
+    // Frame-exact consumption: copy out frame nextFrameIndex() and advance by
+    // one. Returns false if it is not published yet. Frames the writer
+    // overwrote before they were read are skipped and counted.
+    bool readNextFrame(std::vector<uint8_t>& waveformData);
+    // Block until a frame newer than the last one read is published
+    bool waitForData(int timeoutMs);
     void cleanup();
+    
+    uint64_t nextFrameIndex() const { return nextFrame_; }
+    uint64_t framesRead() const { return framesRead_; }
+    uint64_t framesSkipped() const { return framesSkipped_; }        // Lost to ring overrun
+    uint64_t framesDuplicated() const { return framesDuplicated_; }  // Timestamp did not advance
+    // Acquired/Published/Consumed stamps of the frame returned last
+    const LatencyTrace& lastTrace() const { return trace_; }
 
 private:
     bool openSharedMemory();
+    void convertFrame(std::vector<uint8_t>& waveformData);
+    void countFrame(uint32_t timestamp);
     
     int shmFd;
     void* shmBase;
     size_t shmSize;
     const char* shmName;
     
-    // Direct memory access pointers
-    IntanDataHeader* header;
-    IntanDataBlock* shmInput;
+    // Ring of frame slots inside the segment
+    ShmFrameRing ring_;
+    std::vector<uint8_t> frameBuffer_;
+    std::vector<float> valueScratch_;   // Microvolts gathered from float frames
+    std::vector<uint8_t> byteScratch_;  // Channel-major bytes before interleaving
     uint32_t lastTimestamp;
+    uint64_t nextFrame_;
+    uint64_t framesRead_;
+    uint64_t framesSkipped_;
+    uint64_t framesDuplicated_;
+    LatencyTrace trace_;
+    const SampleConvertKernels* convert_;
 };
 
 #endif // SHARED_MEMORY_READER_H
@@ -1,32 +1,52 @@
 #include "shared_memory_writer.h"
+#include "async_logger.h"
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
-SharedMemoryWriter::SharedMemoryWriter() 
-    : shmFd(-1), shmBase(nullptr), shmSize(0), shmName("/intan_rhx_shm_v1"), frameCounter(0),
-      header(nullptr), shmOutput(nullptr), numStreams_(0), numChannels_(0), samplesPerBlock_(128) {
+namespace {
+// RHD2000 amplifier codes: 0.195 uV per step, 32768 at 0 uV
+constexpr float kMicrovoltsPerCode = 0.195f;
+constexpr float kZeroCode = 32768.0f;
+
+inline uint16_t clampCode(int code) {
+    return static_cast<uint16_t>(std::min(std::max(code, 0), 65535));
+}
+} // namespace
+
+SharedMemoryWriter::SharedMemoryWriter(const char* name)
+    : shmFd(-1), shmBase(nullptr), shmSize(0), shmName(name), frameCounter(0),
+      header(nullptr), numStreams_(0), numChannels_(0), samplesPerBlock_(128), slotCount_(INTAN_SHM_DEFAULT_SLOTS),
+      encoding_(IntanFrameU16SampleMajor), convert_(&sampleConvertKernels()) {
 }
 
 SharedMemoryWriter::~SharedMemoryWriter() {
     cleanup();
 }
 
-bool SharedMemoryWriter::initialize(int numStreams, int numChannels, int sampleRate) {
+bool SharedMemoryWriter::initialize(int numStreams, int numChannels, int sampleRate, int slotCount,
+                                    IntanFrameEncoding encoding) {
     std::cout << "Initializing Shared Memory Writer..." << std::endl;
     
     numStreams_ = numStreams;
     numChannels_ = numChannels;
+    slotCount_ = slotCount > 0 ? slotCount : INTAN_SHM_DEFAULT_SLOTS;
+    encoding_ = encoding;
+    rowScratch_.assign((size_t)numStreams_ * numChannels_, 0.0f);
     
     if (!createSharedMemory()) {
         return false;
     }
     
-    // Set up direct memory access pointers
+    // Lay out the slot ring; the header is filled in once at startup
+    uint32_t frameBytes = static_cast<uint32_t>(frameBytesFor(encoding_));
     header = reinterpret_cast<IntanDataHeader*>(shmBase);
-    shmOutput = reinterpret_cast<IntanDataBlock*>((uint8_t*)shmBase + sizeof(IntanDataHeader));
-    
-    // Initialize header once at startup
     initializeHeader(numStreams, numChannels, sampleRate);
+    if (!ring_.format(shmBase, shmSize, frameBytes, static_cast<uint32_t>(slotCount_))) {
+        std::cerr << "Failed to format shared memory ring" << std::endl;
+        cleanup();
+        return false;
+    }
     
     std::cout << "Shared memory initialized successfully (size=" << shmSize << " bytes)" << std::endl;
     return true;
@@ -36,13 +56,14 @@ bool SharedMemoryWriter::createSharedMemory() {
     // Remove existing shared memory if it exists
     shm_unlink(shmName);
     
-    // Calculate size: header + (streams * channels * samples * sizeof(IntanDataBlock))
-    size_t blocks = (size_t)numStreams_ * numChannels_ * samplesPerBlock_;
-    shmSize = sizeof(IntanDataHeader) + blocks * sizeof(IntanDataBlock);
+    // Calculate size: header + slotCount * (slot header + one encoded frame)
+    shmSize = ShmFrameRing::segmentSize(static_cast<uint32_t>(frameBytesFor(encoding_)), static_cast<uint32_t>(slotCount_));
     
     std::cout << "Setting up shared memory: streams=" << numStreams_ 
               << " channels=" << numChannels_ 
               << " samples=" << samplesPerBlock_ 
+              << " slots=" << slotCount_
+              << " encoding=" << encoding_
               << " size=" << shmSize << " bytes" << std::endl;
     
     // Create shared memory segment
@@ -72,52 +93,120 @@ bool SharedMemoryWriter::createSharedMemory() {
     return true;
 }
 
-void SharedMemoryWriter::writeDataBlock(uint32_t timestamp, const std::vector<std::vector<std::vector<int>>>& amplifierData) {
+void SharedMemoryWriter::writeDataBlock(uint32_t timestamp, const int* amplifierData, size_t count, uint64_t acquiredNs) {
     std::lock_guard<std::mutex> lock(writeMutex);
     
-    if (!shmOutput || amplifierData.empty() || amplifierData[0].empty()) {
-        std::cerr << "SharedMemoryWriter: Invalid data or no shared memory" << std::endl;
+    const size_t expected = (size_t)numStreams_ * numChannels_ * samplesPerBlock_;
+    if (!ring_.isAttached() || !amplifierData || count < expected) {
+        PLOG_ERROR("shm", "SharedMemoryWriter: Invalid data or no shared memory");
         return;
     }
     
-    // Write data blocks 
-    writeDataBlocks(amplifierData);
-    
-    // Update timestamp
-    header->timestamp = timestamp;
+    // Encode straight into the next slot, then publish it
+    uint8_t* payload = ring_.beginWrite();
+    switch (encoding_) {
+        case IntanFrameFloatBlocks:
+            writeDataBlocks(reinterpret_cast<IntanDataBlock*>(payload), amplifierData);
+            break;
+        case IntanFrameU16SampleMajor:
+            writeCodesSampleMajor(reinterpret_cast<uint16_t*>(payload), amplifierData);
+            break;
+        case IntanFrameU16ChannelMajor:
+            writeCodesChannelMajor(reinterpret_cast<uint16_t*>(payload), amplifierData);
+            break;
+    }
+    ring_.endWrite(timestamp, acquiredNs);
     
     frameCounter++;
 }
 
 void SharedMemoryWriter::initializeHeader(int numStreams, int numChannels, int sampleRate) {
-    // Initialize header
-    header->magic = 0x494E5441;  // "INTA"
+    // Stream geometry; the ring fills in the slot layout and publishes the magic
     header->streamCount = numStreams;
     header->channelCount = numChannels;
     header->sampleRate = sampleRate;
-    header->dataSize = static_cast<uint32_t>(shmSize);
-    header->timestamp = 0;
+    header->samplesPerFrame = samplesPerBlock_;
+    header->encoding = encoding_;
+    header->sampleScale = kMicrovoltsPerCode;
+    header->sampleOffset = kZeroCode;
 }
 
-void SharedMemoryWriter::writeDataBlocks(const std::vector<std::vector<std::vector<int>>>& amplifierData) {
-    if (!shmOutput || amplifierData.empty() || amplifierData[0].empty()) {
+size_t SharedMemoryWriter::frameBytesFor(IntanFrameEncoding encoding) const {
+    size_t samples = (size_t)numStreams_ * numChannels_ * samplesPerBlock_;
+    return samples * (encoding == IntanFrameFloatBlocks ? sizeof(IntanDataBlock) : sizeof(uint16_t));
+}
+
+// The source is the device order [sample][channel][stream]; each writer
+// walks its output contiguously and gathers from the source.
+
+void SharedMemoryWriter::writeDataBlocks(IntanDataBlock* shmOutput, const int* amplifierData) {
+    if (!shmOutput) {
         return;
     }
     
+    const int streams = numStreams_;
+    const int channels = numChannels_;
+    const size_t rowLength = (size_t)channels * streams;
+    float* row = rowScratch_.data();
     size_t w = 0;
+    for (int t = 0; t < samplesPerBlock_; ++t) {
+        // Convert one sample row to microvolts in bulk, then interleave
+        convert_->codesToMicrovolts(amplifierData + t * rowLength, row, rowLength, kMicrovoltsPerCode, kZeroCode);
+        for (int s = 0; s < streams; ++s) {
+            for (int ch = 0; ch < channels; ++ch) {
+                shmOutput[w++] = { (uint32_t)s, (uint32_t)ch, row[ch * streams + s] };
+            }
+        }
+    }
+}
+
+void SharedMemoryWriter::writeCodesSampleMajor(uint16_t* shmOutput, const int* amplifierData) {
+    if (!shmOutput) {
+        return;
+    }
     
+    // [sample][stream][channel]: one time step of every channel is contiguous
+    const int streams = numStreams_;
+    const int channels = numChannels_;
+    if (streams == 1) {
+        // Single stream: the device order already matches, a straight narrowing copy
+        convert_->codesToU16(amplifierData, shmOutput, (size_t)channels * samplesPerBlock_);
+        return;
+    }
+    size_t w = 0;
     for (int t = 0; t < samplesPerBlock_; ++t) {
-        for (int s = 0; s < numStreams_; ++s) {
-            for (int ch = 0; ch < numChannels_; ++ch) {
-                int code = amplifierData[s][ch][t];
-                float uV = (float)((code - 32768) * 0.195f);  // Convert to microvolts (EXACTLY like working Decoupled version)
-                shmOutput[w++] = { (uint32_t)s, (uint32_t)ch, uV };
+        const int* sample = amplifierData + (size_t)t * channels * streams;
+        for (int s = 0; s < streams; ++s) {
+            for (int ch = 0; ch < channels; ++ch) {
+                shmOutput[w++] = clampCode(sample[ch * streams + s]);
+            }
+        }
+    }
+}
+
+void SharedMemoryWriter::writeCodesChannelMajor(uint16_t* shmOutput, const int* amplifierData) {
+    if (!shmOutput) {
+        return;
+    }
+    
+    // [stream][channel][sample]: each channel's block of samples is contiguous
+    const int streams = numStreams_;
+    const int channels = numChannels_;
+    const size_t sampleStride = (size_t)channels * streams;
+    size_t w = 0;
+    for (int s = 0; s < streams; ++s) {
+        for (int ch = 0; ch < channels; ++ch) {
+            const int* lane = amplifierData + (size_t)ch * streams + s;
+            for (int t = 0; t < samplesPerBlock_; ++t) {
+                shmOutput[w++] = clampCode(lane[t * sampleStride]);
             }
         }
     }
 }
 
 void SharedMemoryWriter::cleanup() {
+    ring_.detach();
+    header = nullptr;
     if (shmBase && shmBase != MAP_FAILED) {
         munmap(shmBase, shmSize);
         shmBase = nullptr;
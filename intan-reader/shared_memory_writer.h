@@ -10,20 +10,32 @@
 #include <chrono>
 
 #include "intan_data_types.h"
+#include "shm_frame_ring.h"
+#include "sample_convert.h"
 
 class SharedMemoryWriter {
 public:
-    SharedMemoryWriter();
+    explicit SharedMemoryWriter(const char* name = INTAN_SHM_NAME);
     ~SharedMemoryWriter();
     
-    bool initialize(int numStreams, int numChannels, int sampleRate);
-    void writeDataBlock(uint32_t timestamp, const std::vector<std::vector<std::vector<int>>>& amplifierData);
+    bool initialize(int numStreams, int numChannels, int sampleRate, int slotCount = INTAN_SHM_DEFAULT_SLOTS,
+                    IntanFrameEncoding encoding = IntanFrameU16SampleMajor);
+    // Publish one block. amplifierData is the flat device layout of
+    // Rhd2000DataBlockUsb3::amplifierDataFast, [sample][channel][stream],
+    // and must hold samplesPerFrame() * numChannels * numStreams codes.
+    // Encodes straight into the next slot without allocating. acquiredNs is
+    // the monotonicNowNs() of the USB read that delivered the block.
+    void writeDataBlock(uint32_t timestamp, const int* amplifierData, size_t count, uint64_t acquiredNs = 0);
+    size_t samplesPerFrame() const { return (size_t)samplesPerBlock_; }
     void cleanup();
 
 private:
     bool createSharedMemory();
     void initializeHeader(int numStreams, int numChannels, int sampleRate);
-    void writeDataBlocks(const std::vector<std::vector<std::vector<int>>>& amplifierData);
+    size_t frameBytesFor(IntanFrameEncoding encoding) const;
+    void writeDataBlocks(IntanDataBlock* shmOutput, const int* amplifierData);
+    void writeCodesSampleMajor(uint16_t* shmOutput, const int* amplifierData);
+    void writeCodesChannelMajor(uint16_t* shmOutput, const int* amplifierData);
     
     int shmFd;
     void* shmBase;
@@ -32,12 +44,16 @@ private:
     std::mutex writeMutex;
     uint32_t frameCounter;
     
-    // Direct memory access pointers
+    // Ring of frame slots inside the segment
+    ShmFrameRing ring_;
     IntanDataHeader* header;
-    IntanDataBlock* shmOutput;
     int numStreams_;
     int numChannels_;
     int samplesPerBlock_;
+    int slotCount_;
+    IntanFrameEncoding encoding_;
+    const SampleConvertKernels* convert_;
+    std::vector<float> rowScratch_;  // One sample row in microvolts (float encoding)
 };
 
-#endif // SHARED_MEMORY_WRITER_H
\ No newline at end of file
+#endif // SHARED_MEMORY_WRITER_H
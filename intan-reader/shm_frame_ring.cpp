@@ -0,0 +1,288 @@
+#include "shm_frame_ring.h"
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#elif defined(__APPLE__)
+// Public address wait API, macOS 14.4+. Older SDKs and systems use
+// __ulock, Darwin's private futex equivalent (libSystem, macOS 10.12+) that
+// libc++ uses for std::atomic::wait.
+#if __has_include(<os/os_sync_wait_on_address.h>)
+#include <os/os_sync_wait_on_address.h>
+#include <os/clock.h>
+#define HAVE_OS_SYNC_WAIT 1
+#endif
+extern "C" int __ulock_wait(uint32_t operation, void* addr, uint64_t value, uint32_t timeoutUs);
+extern "C" int __ulock_wake(uint32_t operation, void* addr, uint64_t wakeValue);
+#define UL_COMPARE_AND_WAIT_SHARED 3
+#define ULF_WAKE_ALL 0x00000100
+#endif
+
+namespace {
+constexpr size_t kCacheLine = 64;
+// Longest single sleep when no wait primitive is usable
+constexpr int64_t kPollUs = 200;
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Set once the kernel wait has failed for a reason other than timeout,
+// interrupt or a changed word; from then on waiters sleep-poll
+std::atomic<bool> waitUnavailable{false};
+
+void pollWait(int64_t timeoutUs) {
+    std::this_thread::sleep_for(std::chrono::microseconds(timeoutUs < kPollUs ? timeoutUs : kPollUs));
+}
+
+void markWaitUnavailable(int error) {
+    if (!waitUnavailable.exchange(true)) {
+        std::cerr << "[WARN] Shared memory wait failed (" << std::strerror(error)
+                  << "), polling every " << kPollUs << " us instead" << std::endl;
+    }
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+// Expected outcomes of a wait; anything else means the primitive is unusable
+bool normalWaitError(int error) {
+    return error == ETIMEDOUT || error == EINTR || error == EAGAIN;
+}
+#endif
+
+// Sleep while *word == expected, for at most timeoutUs. Spurious wakeups are
+// fine, callers re-check their condition. The word lives in a MAP_SHARED
+// mapping, so the process-shared (non-private) variants are used.
+void waitOnWord(const std::atomic<uint32_t>* word, uint32_t expected, int64_t timeoutUs) {
+    if (waitUnavailable.load(std::memory_order_relaxed)) {
+        pollWait(timeoutUs);
+        return;
+    }
+    void* addr = const_cast<std::atomic<uint32_t>*>(word);
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec = timeoutUs / 1000000;
+    ts.tv_nsec = (timeoutUs % 1000000) * 1000;
+    if (syscall(SYS_futex, addr, FUTEX_WAIT, expected, &ts, nullptr, 0) < 0 && !normalWaitError(errno)) {
+        markWaitUnavailable(errno);
+        pollWait(timeoutUs);
+    }
+#elif defined(__APPLE__)
+    int rc;
+#if HAVE_OS_SYNC_WAIT
+    if (__builtin_available(macOS 14.4, *)) {
+        rc = os_sync_wait_on_address_with_timeout(addr, expected, sizeof(uint32_t),
+                                                  OS_SYNC_WAIT_ON_ADDRESS_SHARED, OS_CLOCK_MACH_ABSOLUTE_TIME,
+                                                  static_cast<uint64_t>(timeoutUs) * 1000);
+    } else
+#endif
+    {
+        rc = __ulock_wait(UL_COMPARE_AND_WAIT_SHARED, addr, expected, static_cast<uint32_t>(timeoutUs));
+    }
+    if (rc < 0 && !normalWaitError(errno)) {
+        markWaitUnavailable(errno);
+        pollWait(timeoutUs);
+    }
+#else
+    // No cross-process wait primitive; fall back to a short poll
+    (void)addr;
+    (void)expected;
+    pollWait(timeoutUs);
+#endif
+}
+
+// A failed wake only delays waiters until their timeout, so it is not
+// retried here; a broken primitive shows up on the wait side
+void wakeAllOnWord(std::atomic<uint32_t>* word) {
+#if defined(__linux__)
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#elif defined(__APPLE__)
+#if HAVE_OS_SYNC_WAIT
+    if (__builtin_available(macOS 14.4, *)) {
+        // ENOENT just means nobody was waiting
+        os_sync_wake_by_address_all(word, sizeof(uint32_t), OS_SYNC_WAKE_BY_ADDRESS_SHARED);
+        return;
+    }
+#endif
+    __ulock_wake(UL_COMPARE_AND_WAIT_SHARED | ULF_WAKE_ALL, word, 0);
+#else
+    (void)word;
+#endif
+}
+} // namespace
+
+ShmFrameRing::ShmFrameRing()
+    : header_(nullptr), slots_(nullptr), mappedSize_(0), pendingIndex_(0) {
+}
+
+size_t ShmFrameRing::segmentSize(uint32_t frameBytes, uint32_t slotCount) {
+    size_t stride = alignUp(sizeof(IntanFrameSlot) + frameBytes, kCacheLine);
+    return sizeof(IntanDataHeader) + stride * slotCount;
+}
+
+bool ShmFrameRing::format(void* base, size_t mappedSize, uint32_t frameBytes, uint32_t slotCount) {
+    if (!base || slotCount == 0 || mappedSize < segmentSize(frameBytes, slotCount)) {
+        return false;
+    }
+
+    header_ = static_cast<IntanDataHeader*>(base);
+    slots_ = static_cast<uint8_t*>(base) + sizeof(IntanDataHeader);
+    mappedSize_ = mappedSize;
+    pendingIndex_ = 0;
+
+    header_->timestamp = 0;
+    header_->dataSize = static_cast<uint32_t>(mappedSize);
+    header_->version = INTAN_SHM_VERSION;
+    header_->headerSize = sizeof(IntanDataHeader);
+    header_->slotCount = slotCount;
+    header_->slotStride = static_cast<uint32_t>(alignUp(sizeof(IntanFrameSlot) + frameBytes, kCacheLine));
+    header_->frameBytes = frameBytes;
+    header_->writeIndex.store(0, std::memory_order_relaxed);
+    header_->notifyWord.store(0, std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < slotCount; ++i) {
+        IntanFrameSlot* slot = reinterpret_cast<IntanFrameSlot*>(slots_ + (size_t)i * header_->slotStride);
+        slot->sequence.store(0, std::memory_order_relaxed);
+        slot->frameIndex = 0;
+        slot->timestamp = 0;
+        slot->payloadBytes = frameBytes;
+        slot->acquiredNs = 0;
+        slot->publishedNs = 0;
+    }
+
+    // Readers key off the magic, so publish it only after the layout is complete
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = INTAN_SHM_MAGIC;
+    return true;
+}
+
+bool ShmFrameRing::attach(const void* base, size_t mappedSize) {
+    detach();
+    if (!base || mappedSize < sizeof(IntanDataHeader)) {
+        return false;
+    }
+
+    const IntanDataHeader* hdr = static_cast<const IntanDataHeader*>(base);
+    if (hdr->magic != INTAN_SHM_MAGIC || hdr->version != INTAN_SHM_VERSION) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (hdr->headerSize < sizeof(IntanDataHeader) || hdr->slotCount == 0 ||
+        hdr->slotStride < sizeof(IntanFrameSlot) + hdr->frameBytes) {
+        return false;
+    }
+    if ((size_t)hdr->headerSize + (size_t)hdr->slotStride * hdr->slotCount > mappedSize) {
+        return false;
+    }
+
+    // Readers never write through these pointers; the cast only lets the
+    // writer and reader share one type.
+    header_ = const_cast<IntanDataHeader*>(hdr);
+    slots_ = const_cast<uint8_t*>(static_cast<const uint8_t*>(base)) + hdr->headerSize;
+    mappedSize_ = mappedSize;
+    return true;
+}
+
+void ShmFrameRing::detach() {
+    header_ = nullptr;
+    slots_ = nullptr;
+    mappedSize_ = 0;
+    pendingIndex_ = 0;
+}
+
+IntanFrameSlot* ShmFrameRing::slotFor(uint64_t frameIndex) const {
+    return reinterpret_cast<IntanFrameSlot*>(slots_ + (size_t)(frameIndex % header_->slotCount) * header_->slotStride);
+}
+
+const uint8_t* ShmFrameRing::payloadOf(const IntanFrameSlot* slot) const {
+    return reinterpret_cast<const uint8_t*>(slot) + sizeof(IntanFrameSlot);
+}
+
+uint8_t* ShmFrameRing::beginWrite() {
+    if (!header_) return nullptr;
+
+    pendingIndex_ = header_->writeIndex.load(std::memory_order_relaxed);
+    IntanFrameSlot* slot = slotFor(pendingIndex_);
+
+    // Mark the slot as being written before touching the payload
+    slot->sequence.store(2 * pendingIndex_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return const_cast<uint8_t*>(payloadOf(slot));
+}
+
+void ShmFrameRing::endWrite(uint32_t timestamp, uint64_t acquiredNs) {
+    if (!header_) return;
+
+    IntanFrameSlot* slot = slotFor(pendingIndex_);
+    slot->frameIndex = pendingIndex_;
+    slot->timestamp = timestamp;
+    slot->publishedNs = monotonicNowNs();
+    slot->acquiredNs = acquiredNs ? acquiredNs : slot->publishedNs;
+    slot->sequence.store(2 * pendingIndex_ + 2, std::memory_order_release);
+
+    header_->timestamp = timestamp;
+    header_->writeIndex.store(pendingIndex_ + 1, std::memory_order_release);
+
+    // Wake everyone blocked in waitForFrame(). Readers map the segment
+    // read-only and cannot register themselves, so the wake is unconditional;
+    // at one call per 128-sample block it is cheap.
+    header_->notifyWord.fetch_add(1, std::memory_order_release);
+    wakeAllOnWord(&header_->notifyWord);
+}
+
+uint64_t ShmFrameRing::publishedCount() const {
+    if (!header_) return 0;
+    return header_->writeIndex.load(std::memory_order_acquire);
+}
+
+ShmFrameRing::ReadStatus ShmFrameRing::readFrame(uint64_t frameIndex, void* dst, size_t dstBytes, uint32_t* timestamp,
+                                                 LatencyTrace* trace) const {
+    if (!header_) return FrameNotReady;
+
+    const IntanFrameSlot* slot = slotFor(frameIndex);
+    const uint64_t expected = 2 * frameIndex + 2;
+
+    uint64_t before = slot->sequence.load(std::memory_order_acquire);
+    if (before < expected) return FrameNotReady;
+    if (before > expected) return FrameOverwritten;
+
+    uint32_t ts = slot->timestamp;
+    uint64_t acquiredNs = slot->acquiredNs;
+    uint64_t publishedNs = slot->publishedNs;
+    size_t bytes = header_->frameBytes < dstBytes ? header_->frameBytes : dstBytes;
+    std::memcpy(dst, payloadOf(slot), bytes);
+
+    // If the writer touched the slot while we copied, the copy is torn
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = slot->sequence.load(std::memory_order_relaxed);
+    if (after != before) return FrameOverwritten;
+
+    if (timestamp) *timestamp = ts;
+    if (trace) {
+        trace->ns[LatencyAcquired] = acquiredNs;
+        trace->ns[LatencyPublished] = publishedNs;
+    }
+    return FrameOk;
+}
+
+bool ShmFrameRing::waitForFrame(uint64_t frameIndex, int timeoutMs) const {
+    if (!header_) return false;
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        // Sample the notify word before checking, so a publish in between
+        // changes the word and the wait below returns immediately
+        uint32_t seen = header_->notifyWord.load(std::memory_order_acquire);
+        if (publishedCount() > frameIndex) return true;
+
+        auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) return false;
+        waitOnWord(&header_->notifyWord, seen, remaining);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef SHM_FRAME_RING_H
+#define SHM_FRAME_RING_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "intan_data_types.h"
+#include "latency_tracker.h"
+
+// Seqlock-protected ring of frames on top of a mapped v3 segment.
+// One writer publishes frames with beginWrite()/endWrite(); any number of
+// readers (in any process) copy frames out with readFrame() and detect
+// torn or overwritten slots from the slot sequence counter.
+class ShmFrameRing {
+public:
+    enum ReadStatus {
+        FrameOk,          // Frame copied out intact
+        FrameNotReady,    // Frame has not been published yet
+        FrameOverwritten  // Writer lapped the reader, frame is gone
+    };
+
+    ShmFrameRing();
+
+    // Total segment size for a ring of slotCount frames of frameBytes each
+    static size_t segmentSize(uint32_t frameBytes, uint32_t slotCount);
+
+    // Writer: lay out a fresh header and empty slots in a zeroed mapping
+    bool format(void* base, size_t mappedSize, uint32_t frameBytes, uint32_t slotCount);
+
+    // Reader: bind to a segment formatted by the writer
+    bool attach(const void* base, size_t mappedSize);
+    void detach();
+    bool isAttached() const { return header_ != nullptr; }
+
+    const IntanDataHeader* header() const { return header_; }
+
+    // Writer side. beginWrite() returns the payload of the next slot; the
+    // caller fills it in place and then calls endWrite() to publish it.
+    // acquiredNs is when the frame's data reached the host (0 = now).
+    uint8_t* beginWrite();
+    void endWrite(uint32_t timestamp, uint64_t acquiredNs = 0);
+
+    // Reader side. trace, if given, receives the Acquired/Published stamps.
+    uint64_t publishedCount() const;
+    ReadStatus readFrame(uint64_t frameIndex, void* dst, size_t dstBytes, uint32_t* timestamp = nullptr,
+                         LatencyTrace* trace = nullptr) const;
+
+    // Block until frame frameIndex has been published or timeoutMs elapses.
+    // Works across processes: the writer wakes sleepers on every publish.
+    bool waitForFrame(uint64_t frameIndex, int timeoutMs) const;
+
+private:
+    IntanFrameSlot* slotFor(uint64_t frameIndex) const;
+    const uint8_t* payloadOf(const IntanFrameSlot* slot) const;
+
+    IntanDataHeader* header_;
+    uint8_t* slots_;
+    size_t mappedSize_;
+    uint64_t pendingIndex_;
+};
+
+#endif // SHM_FRAME_RING_H
@@ -0,0 +1,87 @@
+#include "../sample_convert.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Micro-benchmark for the sample conversion kernels. Checks every kernel
+// against the scalar reference, then reports samples/sec for each.
+//
+//   make bench_sample_convert && ./intan-reader/tests/bench_sample_convert
+
+namespace {
+constexpr float kScale = 0.195f;
+constexpr float kOffset = 32768.0f;
+constexpr size_t kSamples = 128 * 32 * 8;  // 8 streams of one 128-sample block
+constexpr int kIterations = 4000;
+
+template <typename Fn>
+double samplesPerSecond(Fn fn) {
+    fn();  // warm up
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        fn();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (double)kSamples * kIterations / seconds;
+}
+} // namespace
+
+int main() {
+    std::vector<int> codes(kSamples);
+    std::vector<uint16_t> codes16(kSamples);
+    std::vector<float> microvolts(kSamples);
+    // Cover the full code range plus out-of-range values for the clamps
+    srand(1234);
+    for (size_t i = 0; i < kSamples; ++i) {
+        codes[i] = (rand() % 70000) - 2000;
+        codes16[i] = static_cast<uint16_t>(rand() % 65536);
+    }
+
+    const SampleConvertKernels& ref = *sampleConvertKernelsFor(SampleConvertIsa::Scalar);
+    std::vector<uint16_t> refU16(kSamples), outU16(kSamples);
+    std::vector<float> refUv(kSamples), outUv(kSamples);
+    std::vector<uint8_t> refBytes(kSamples), outBytes(kSamples);
+    ref.codesToU16(codes.data(), refU16.data(), kSamples);
+    ref.codesToMicrovolts(codes.data(), refUv.data(), kSamples, kScale, kOffset);
+    ref.codesToBytes(codes16.data(), refBytes.data(), kSamples, kScale, kOffset);
+    ref.codesToMicrovolts(codes.data(), microvolts.data(), kSamples, kScale, kOffset);
+
+    printf("Sample conversion kernels, %zu samples per call (dispatch picks: %s)\n",
+           kSamples, sampleConvertKernels().name);
+    printf("%-8s %16s %16s %16s %16s\n", "kernel", "codes->u16", "codes->uV", "uV->u8", "u16->u8 fused");
+
+    int failures = 0;
+    for (SampleConvertIsa isa : {SampleConvertIsa::Scalar, SampleConvertIsa::SSE2,
+                                 SampleConvertIsa::AVX2, SampleConvertIsa::NEON}) {
+        const SampleConvertKernels* k = sampleConvertKernelsFor(isa);
+        if (!k) {
+            continue;
+        }
+
+        k->codesToU16(codes.data(), outU16.data(), kSamples);
+        k->codesToMicrovolts(codes.data(), outUv.data(), kSamples, kScale, kOffset);
+        k->codesToBytes(codes16.data(), outBytes.data(), kSamples, kScale, kOffset);
+        bool ok = outU16 == refU16 &&
+                  memcmp(outUv.data(), refUv.data(), kSamples * sizeof(float)) == 0 &&
+                  outBytes == refBytes;
+        k->microvoltsToBytes(microvolts.data(), outBytes.data(), kSamples);
+        std::vector<uint8_t> refFromUv(kSamples);
+        ref.microvoltsToBytes(microvolts.data(), refFromUv.data(), kSamples);
+        ok = ok && outBytes == refFromUv;
+        if (!ok) {
+            printf("%-8s MISMATCH against scalar reference\n", k->name);
+            ++failures;
+            continue;
+        }
+
+        double u16 = samplesPerSecond([&] { k->codesToU16(codes.data(), outU16.data(), kSamples); });
+        double uv = samplesPerSecond([&] { k->codesToMicrovolts(codes.data(), outUv.data(), kSamples, kScale, kOffset); });
+        double u8 = samplesPerSecond([&] { k->microvoltsToBytes(microvolts.data(), outBytes.data(), kSamples); });
+        double fused = samplesPerSecond([&] { k->codesToBytes(codes16.data(), outBytes.data(), kSamples, kScale, kOffset); });
+        printf("%-8s %13.1f M/s %13.1f M/s %13.1f M/s %13.1f M/s\n", k->name, u16 / 1e6, uv / 1e6, u8 / 1e6, fused / 1e6);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -14,6 +14,7 @@
 #include <iostream>
 #include <memory>
 #include <thread>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <cstdlib>
@@ -21,6 +22,8 @@
 
 #include "intan-reader/intan_reader.h"
 #include "intan-reader/shared_memory_reader.h"
+#include "intan-reader/latency_tracker.h"
+#include "intan-reader/async_logger.h"
 #include "asic-sender/asic_sender.h"
 #include "data-analyser/src/core/fpga_logger.h"
 #include "data-analyser/src/core/halo_response_decoder.h"
@@ -30,9 +33,11 @@ int main(int /* argc */, char* /* argv */[]) {
     std::cout << "Starting Intan RHX Device Reader..." << std::endl;
     
     try {
-        // Create and initialize the reader
+        // Create and initialize the reader (INTAN_SAMPLE_RATE overrides the acquisition rate)
         IntanReader reader;
-        if (!reader.initialize()) {
+        const char* rateEnv = std::getenv("INTAN_SAMPLE_RATE");
+        int sampleRate = rateEnv ? std::atoi(rateEnv) : INTAN_DEFAULT_SAMPLE_RATE;
+        if (!reader.initialize(sampleRate)) {
             std::cerr << "Failed to initialize Intan Reader." << std::endl;
             return -1;
         }
@@ -44,20 +49,26 @@ int main(int /* argc */, char* /* argv */[]) {
             std::cerr << "Warning: ASIC Sender not available, continuing without FPGA processing." << std::endl;
         }
         
-        // Create shared memory reader for real Intan data
-        SharedMemoryReader sharedMemoryReader;
+        // Create shared memory reader for real Intan data, on the decimated ASIC channel
+        SharedMemoryReader sharedMemoryReader(INTAN_SHM_ASIC_NAME);
         if (!sharedMemoryReader.initialize()) {
             std::cerr << "ERROR: Failed to initialize shared memory reader for real Intan data!" << std::endl;
             std::cerr << "Pipeline cannot proceed without real neural data. Exiting." << std::endl;
             return -1;
         }
         
-        // Create and initialize the FPGA logger only if ASIC is available
-        std::unique_ptr<FpgaLogger> fpgaLogger;
+        // Create the FPGA logger; without the ASIC it runs pipeline 6 on the CPU
+        auto fpgaLogger = std::make_unique<FpgaLogger>();
+        fpgaLogger->setHaloPipeline(HaloPipeline::PIPELINE_6);
+        fpgaLogger->setThresholds(0.3, 0.7);
+        
+        // Per-hop latency from the USB read to the logged result, reported with the frame counters
+        LatencyTracker latency;
+        
         if (asicInitialized) {
-            fpgaLogger = std::make_unique<FpgaLogger>();
             // Connect the FPGA logger to the ASIC sender
             asicSender.setDataAnalyzer(fpgaLogger.get());
+            asicSender.setLatencyTracker(&latency);
             
             // Configure FPGA for real analysis (instead of test)
             std::cout << "Configuring FPGA for seizure detection analysis..." << std::endl;
@@ -82,11 +93,9 @@ int main(int /* argc */, char* /* argv */[]) {
                 std::cerr << "Warning: Failed to set FPGA thresholds" << std::endl;
             }
             
-            // Configure the decoder to match FPGA pipeline
-            fpgaLogger->setHaloPipeline(HaloPipeline::PIPELINE_6);
-            fpgaLogger->setThresholds(0.3, 0.7);
-            
             std::cout << "FPGA configured for real-time seizure detection analysis" << std::endl;
+        } else {
+            std::cout << "Running seizure detection on the CPU reference model" << std::endl;
         }
         
         // Start data acquisition
@@ -95,43 +104,80 @@ int main(int /* argc */, char* /* argv */[]) {
             return -1;
         }
         
-        // Start ASIC sender only if initialized
-        std::thread asicThread;
+        // Start ASIC sender only if initialized; otherwise frames go to the CPU model
+        std::atomic<bool> analysisRunning(true);
         if (asicInitialized) {
             asicSender.startSending();
+        }
+        auto isConsuming = [&]() {
+            return asicInitialized ? asicSender.isRunning() : analysisRunning.load();
+        };
+        auto stopConsuming = [&]() {
+            if (asicInitialized) {
+                asicSender.stopSending();
+            }
+            analysisRunning = false;
+        };
+        
+        // Create the frame consumer thread
+        std::thread asicThread([&]() {
+            std::vector<uint8_t> waveformData;
+            bool hasReceivedData = false;
+            int noDataCount = 0;
+            const int MAX_NO_DATA_COUNT = 50; // 5 seconds at 100ms intervals
+            const char* target = asicInitialized ? "ASIC" : "CPU reference model";
             
-            // Create ASIC sender thread
-            asicThread = std::thread([&asicSender, &sharedMemoryReader]() {
-                std::vector<uint8_t> waveformData;
-                bool hasReceivedData = false;
-                int noDataCount = 0;
-                const int MAX_NO_DATA_COUNT = 50; // 5 seconds at 100ms intervals
-                
-                while (asicSender.isRunning()) {
-                    // Try to read real data from Intan device
-                    if (sharedMemoryReader.readLatestData(waveformData)) {
+            auto lastReport = std::chrono::steady_clock::now();
+            
+            while (isConsuming()) {
+                // Sleep until the Intan reader publishes the next block (or 100ms pass),
+                // then process every block published since, each exactly once
+                bool sentAny = false;
+                if (sharedMemoryReader.waitForData(100)) {
+                    while (sharedMemoryReader.readNextFrame(waveformData)) {
                         if (!hasReceivedData) {
-                            std::cout << "Now sending REAL neural data from Intan device to ASIC!" << std::endl;
+                            std::cout << "Now sending REAL neural data from Intan device to " << target << "!" << std::endl;
                             hasReceivedData = true;
                         }
-                        asicSender.sendWaveformData(waveformData);
-                        noDataCount = 0; // Reset counter
-                    } else {
-                        noDataCount++;
-                        
-                        // If we've been waiting too long for data, halt the pipeline
-                        if (noDataCount >= MAX_NO_DATA_COUNT) {
-                            std::cerr << "ERROR: No real neural data received from Intan device for 5 seconds!" << std::endl;
-                            std::cerr << "Pipeline cannot proceed without real data. Halting." << std::endl;
-                            asicSender.stopSending();
-                            return;
+                        if (asicInitialized) {
+                            asicSender.sendWaveformData(waveformData, sharedMemoryReader.lastTrace());
+                        } else {
+                            LatencyTrace trace = sharedMemoryReader.lastTrace();
+                            fpgaLogger->analyzeOnCpu(waveformData);
+                            trace.stamp(LatencyAnalyzed);
+                            latency.record(trace);
                         }
+                        sentAny = true;
+                    }
+                }
+                
+                auto now = std::chrono::steady_clock::now();
+                if (now - lastReport >= std::chrono::seconds(10)) {
+                    PLOG_INFO(asicInitialized ? "asic" : "cpu", "frames sent: {}, skipped: {}, duplicated: {}",
+                              sharedMemoryReader.framesRead(), sharedMemoryReader.framesSkipped(),
+                              sharedMemoryReader.framesDuplicated());
+                    for (const LatencyStageSummary& stage : latency.snapshot(true)) {
+                        PLOG_INFO("latency", "{} n={} p50={:.1f}us p99={:.1f}us max={:.1f}us",
+                                  stage.name, stage.count, stage.p50Us, stage.p99Us, stage.maxUs);
                     }
+                    lastReport = now;
+                }
+                
+                if (sentAny) {
+                    noDataCount = 0; // Reset counter
+                } else {
+                    noDataCount++;
                     
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Check every 100ms
+                    // If we've been waiting too long for data, halt the pipeline
+                    if (noDataCount >= MAX_NO_DATA_COUNT) {
+                        std::cerr << "ERROR: No real neural data received from Intan device for 5 seconds!" << std::endl;
+                        std::cerr << "Pipeline cannot proceed without real data. Halting." << std::endl;
+                        stopConsuming();
+                        return;
+                    }
                 }
-            });
-        }
+            }
+        });
         
         // Main loop - wait for reader to finish
         while (reader.isRunning()) {
@@ -139,9 +185,7 @@ int main(int /* argc */, char* /* argv */[]) {
         }
         
         // Stop ASIC sender and wait for thread
-        if (asicInitialized) {
-            asicSender.stopSending();
-        }
+        stopConsuming();
         if (asicThread.joinable()) {
             asicThread.join();
         }
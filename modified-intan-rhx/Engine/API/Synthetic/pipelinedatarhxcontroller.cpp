@@ -33,6 +33,7 @@
 #include <cmath>
 #include <algorithm>
 #include "pipelinedatarhxcontroller.h"
+#include "async_logger.h"
 
 PipelineDataRHXController::PipelineDataRHXController(ControllerType type_, AmplifierSampleRate sampleRate_) :
     AbstractRHXController(type_, sampleRate_),
@@ -428,7 +429,7 @@ unsigned int PipelineDataRHXController::numWordsInFifo()
 bool PipelineDataRHXController::connectToSharedMemory()
 {
     if (shmConnected) return true;
-    // Layout: [Header | IntanDataBlock repeated ...], producer updates header->dataSize and posts sem
+    // Layout: [Header | slot ring of frames], see intan_data_types.h
     shmFd = shm_open(shmName, O_RDWR, 0666);
     if (shmFd < 0) return false;
     struct stat st;
@@ -448,12 +449,21 @@ bool PipelineDataRHXController::connectToSharedMemory()
         shmFd = -1;
         return false;
     }
+    // The producer may still be laying out the segment; retry later in that case
+    if (!shmRing.attach(shmBase, shmSize)) {
+        disconnectFromSharedMemory();
+        return false;
+    }
+    // Start from the newest frame rather than replaying the whole ring
+    uint64_t published = shmRing.publishedCount();
+    nextShmFrame = published > 0 ? published - 1 : 0;
     shmConnected = true;
     return true;
 }
 
 void PipelineDataRHXController::disconnectFromSharedMemory()
 {
+    shmRing.detach();
     if (shmBase && shmBase != MAP_FAILED) {
         munmap(shmBase, shmSize);
         shmBase = nullptr;
@@ -468,108 +478,161 @@ void PipelineDataRHXController::disconnectFromSharedMemory()
 
 void PipelineDataRHXController::tcpThreadFunction()
 {
-    std::cout << "TCP thread started" << std::endl;
+    PLOG_INFO("rhx", "TCP thread started");
     
-    // If shared memory is connected, poll header for new frames (timestamp change)
+    // If shared memory is connected, consume every frame published to the slot ring
     std::vector<uint8_t> frameBuf;
     frameBuf.reserve(1 << 20);
     while (tcpThreadRunning) {
         // Retry SHM connection if not connected yet
         if (!shmConnected) {
             if (connectToSharedMemory()) {
-                std::cout << "Connected to Shared Memory supplier" << std::endl;
+                PLOG_INFO("rhx", "Connected to Shared Memory supplier");
             } else {
                 std::this_thread::sleep_for(std::chrono::milliseconds(200));
                 continue;
             }
         }
 
-        if (shmBase && shmSize >= sizeof(IntanDataHeader)) {
-            const char* base = reinterpret_cast<const char*>(shmBase);
-            const IntanDataHeader* hdr = reinterpret_cast<const IntanDataHeader*>(base);
-            if (hdr->dataSize >= sizeof(IntanDataHeader) && hdr->dataSize <= shmSize) {
-                if (hdr->timestamp != lastShmTimestamp) {
-                    lastShmTimestamp = hdr->timestamp;
-                    // Update pacing to producer's advertised sample rate so our consumer rate matches
-                    if (hdr->sampleRate > 0) {
-                        producerSampleRateHz = static_cast<double>(hdr->sampleRate);
-                        dataBlockPeriodNs = 1.0e9 * ((double)RHXDataBlock::samplesPerDataBlock(type)) / producerSampleRateHz;
-                    }
-                    if (convertTCPDataToRHXBlock(base, hdr->dataSize)) {
-                        hasTCPData = true;
-                        lastTCPDataTime = std::chrono::steady_clock::now();
-                    }
-                }
+        const IntanDataHeader* hdr = shmRing.header();
+        frameBuf.resize(hdr->frameBytes);
+        uint64_t published = shmRing.publishedCount();
+
+        // If the producer lapped us, skip ahead to the oldest frame still in the ring
+        if (published > nextShmFrame + hdr->slotCount) {
+            shmFramesDropped += published - hdr->slotCount - nextShmFrame;
+            nextShmFrame = published - hdr->slotCount;
+        }
+
+        while (nextShmFrame < published) {
+            ShmFrameRing::ReadStatus status = shmRing.readFrame(nextShmFrame, frameBuf.data(), frameBuf.size());
+            if (status == ShmFrameRing::FrameNotReady) break;
+            ++nextShmFrame;
+            if (status == ShmFrameRing::FrameOverwritten) {
+                ++shmFramesDropped;
+                continue;
+            }
+            // Update pacing to producer's advertised sample rate so our consumer rate matches
+            if (hdr->sampleRate > 0) {
+                producerSampleRateHz = static_cast<double>(hdr->sampleRate);
+                dataBlockPeriodNs = 1.0e9 * ((double)RHXDataBlock::samplesPerDataBlock(type)) / producerSampleRateHz;
+            }
+            if (convertTCPDataToRHXBlock(hdr, reinterpret_cast<const char*>(frameBuf.data()), frameBuf.size())) {
+                hasTCPData = true;
+                lastTCPDataTime = std::chrono::steady_clock::now();
             }
         }
-        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        // Sleep until the producer publishes the next frame; the timeout keeps
+        // shutdown responsive
+        shmRing.waitForFrame(nextShmFrame, 50);
     }
     
-    std::cout << "TCP thread stopped" << std::endl;
+    PLOG_INFO("rhx", "TCP thread stopped");
 }
 
-bool PipelineDataRHXController::convertTCPDataToRHXBlock(const char* tcpData, size_t dataSize)
+bool PipelineDataRHXController::convertTCPDataToRHXBlock(const IntanDataHeader* header, const char* frameData, size_t frameBytes)
 {
-    if (dataSize < sizeof(IntanDataHeader)) {
+    if (!header || !frameData) {
         return false;
     }
-    
-    // Parse the header
-    const IntanDataHeader* header = reinterpret_cast<const IntanDataHeader*>(tcpData);
 
     // Check magic number
     if (header->magic != 0x494E5441) { // "INTA"
-        std::cout << "Invalid magic number in TCP data" << std::endl;
+        PLOG_WARN("rhx", "Invalid magic number in TCP data");
         return false;
     }
     
-    std::cout << "Processing TCP data: streams=" << header->streamCount 
-              << " channels=" << header->channelCount 
-              << " sampleRate=" << header->sampleRate << std::endl;
+    PLOG_DEBUG("rhx", "Processing TCP data: streams={} channels={} sampleRate={}",
+               header->streamCount, header->channelCount, header->sampleRate);
+
+    const uint32_t streams = header->streamCount;
+    const uint32_t channels = header->channelCount;
+    const uint64_t channelsPerFrame = static_cast<uint64_t>(streams) * channels;
+    if (channelsPerFrame == 0) return false;
+
+    // Work out how many samples the frame holds for the advertised encoding
+    uint64_t samplesPerFrame = 0;
+    switch (header->encoding) {
+    case IntanFrameFloatBlocks:
+        samplesPerFrame = (frameBytes / sizeof(IntanDataBlock)) / channelsPerFrame;
+        break;
+    case IntanFrameU16SampleMajor:
+    case IntanFrameU16ChannelMajor:
+        samplesPerFrame = (frameBytes / sizeof(uint16_t)) / channelsPerFrame;
+        break;
+    default:
+        PLOG_WARN("rhx", "Unsupported shared memory frame encoding {}", header->encoding);
+        return false;
+    }
+    if (header->samplesPerFrame > 0 && header->samplesPerFrame < samplesPerFrame) {
+        samplesPerFrame = header->samplesPerFrame;
+    }
+
+    std::lock_guard<std::mutex> lock(tcpDataMutex);
 
     // Update TCP data storage size if needed
-    if (header->streamCount > 0 && header->channelCount > 0) {
-        std::lock_guard<std::mutex> lock(tcpDataMutex);
-        tcpChannelData.resize(header->streamCount);
-        for (size_t i = 0; i < header->streamCount; ++i) {
-            tcpChannelData[i].resize(header->channelCount, 0);
-        }
-        tcpChannelFifo.resize(header->streamCount);
-        tcpLastValue.resize(header->streamCount);
-        for (size_t i = 0; i < header->streamCount; ++i) {
-            tcpChannelFifo[i].resize(header->channelCount);
-            tcpLastValue[i].resize(header->channelCount, 0);
-        }
+    tcpChannelData.resize(streams);
+    tcpChannelFifo.resize(streams);
+    tcpLastValue.resize(streams);
+    for (size_t i = 0; i < streams; ++i) {
+        tcpChannelData[i].resize(channels, 0);
+        tcpChannelFifo[i].resize(channels);
+        tcpLastValue[i].resize(channels, 0);
     }
 
-    // Parse data blocks and store the values (sample-major layout)
-    size_t offset = sizeof(IntanDataHeader);
-    const uint64_t blocksAvailable = (dataSize - sizeof(IntanDataHeader)) / sizeof(IntanDataBlock);
-    const uint64_t channelsPerFrame = static_cast<uint64_t>(header->streamCount) * header->channelCount;
-    if (channelsPerFrame == 0) return false;
-    const uint64_t samplesPerFrame = blocksAvailable / channelsPerFrame;
-    for (uint64_t sample = 0; sample < samplesPerFrame && offset + sizeof(IntanDataBlock) <= dataSize; ++sample) {
-        for (uint32_t stream = 0; stream < header->streamCount && offset + sizeof(IntanDataBlock) <= dataSize; ++stream) {
-            for (uint32_t channel = 0; channel < header->channelCount && offset + sizeof(IntanDataBlock) <= dataSize; ++channel) {
-                const IntanDataBlock* block = reinterpret_cast<const IntanDataBlock*>(tcpData + offset);
-                offset += sizeof(IntanDataBlock);
-                if (stream < tcpChannelData.size() && channel < tcpChannelData[stream].size()) {
+    auto storeCode = [this](uint32_t stream, uint32_t channel, uint16_t code) {
+        tcpChannelData[stream][channel] = code; // keep last
+        tcpLastValue[stream][channel] = code;
+        auto& q = tcpChannelFifo[stream][channel];
+        if (q.size() >= tcpFifoMaxDepth) q.pop_front();
+        q.push_back(code);
+    };
+
+    switch (header->encoding) {
+    case IntanFrameFloatBlocks: {
+        // Legacy layout: microvolt floats, sample-major
+        const IntanDataBlock* blocks = reinterpret_cast<const IntanDataBlock*>(frameData);
+        for (uint64_t sample = 0; sample < samplesPerFrame; ++sample) {
+            for (uint32_t stream = 0; stream < streams; ++stream) {
+                for (uint32_t channel = 0; channel < channels; ++channel) {
                     // Convert float value to Intan format (microvolts to 16-bit)
-                    double electrodeValue = static_cast<double>(block->value);
+                    double electrodeValue = static_cast<double>(blocks->value);
+                    ++blocks;
                     int result = round(electrodeValue / 0.195) + 32768;
                     if (result < 0) result = 0;
                     else if (result > 65535) result = 65535;
-                    
-                    std::lock_guard<std::mutex> lock(tcpDataMutex);
-                    uint16_t code = static_cast<uint16_t>(result);
-                    tcpChannelData[stream][channel] = code; // keep last
-                    tcpLastValue[stream][channel] = code;
-                    auto& q = tcpChannelFifo[stream][channel];
-                    if (q.size() >= tcpFifoMaxDepth) q.pop_front();
-                    q.push_back(code);
+                    storeCode(stream, channel, static_cast<uint16_t>(result));
                 }
             }
         }
+        break;
+    }
+    case IntanFrameU16SampleMajor: {
+        // Raw ADC codes, [sample][stream][channel]; no conversion needed
+        const uint16_t* codes = reinterpret_cast<const uint16_t*>(frameData);
+        for (uint64_t sample = 0; sample < samplesPerFrame; ++sample) {
+            for (uint32_t stream = 0; stream < streams; ++stream) {
+                for (uint32_t channel = 0; channel < channels; ++channel) {
+                    storeCode(stream, channel, *codes++);
+                }
+            }
+        }
+        break;
+    }
+    case IntanFrameU16ChannelMajor: {
+        // Raw ADC codes, [stream][channel][sample]
+        const uint16_t* codes = reinterpret_cast<const uint16_t*>(frameData);
+        const uint64_t stride = header->samplesPerFrame > 0 ? header->samplesPerFrame : samplesPerFrame;
+        for (uint32_t stream = 0; stream < streams; ++stream) {
+            for (uint32_t channel = 0; channel < channels; ++channel) {
+                const uint16_t* laneCodes = codes + (static_cast<uint64_t>(stream) * channels + channel) * stride;
+                for (uint64_t sample = 0; sample < samplesPerFrame; ++sample) {
+                    storeCode(stream, channel, laneCodes[sample]);
+                }
+            }
+        }
+        break;
+    }
     }
 
     // Update freshness on successful parse
@@ -581,8 +644,8 @@ void PipelineDataRHXController::injectTCPDataIntoGenerator()
 {
     if (hasTCPData && dataGenerator) {
         std::lock_guard<std::mutex> lock(tcpDataMutex);
-        std::cout << "TCP data available: " << tcpChannelData.size() << " streams, "
-                  << (tcpChannelData.empty() ? 0 : tcpChannelData[0].size()) << " channels" << std::endl;
+        PLOG_DEBUG("rhx", "TCP data available: {} streams, {} channels",
+                   tcpChannelData.size(), tcpChannelData.empty() ? 0 : tcpChannelData[0].size());
     }
 }
 
@@ -43,21 +43,9 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 
-// Intan data structures for TCP communication
-struct IntanDataHeader {
-    uint32_t magic;        // Magic number "INTA" (0x494E5441)
-    uint32_t timestamp;    // Timestamp
-    uint32_t dataSize;     // Total size
-    uint32_t streamCount;  // Number of streams
-    uint32_t channelCount; // Number of channels
-    uint32_t sampleRate;   // Sample rate
-};
-
-struct IntanDataBlock {
-    uint32_t streamId;
-    uint32_t channelId;
-    float value;
-};
+// Shared memory layout and slot ring, shared with the pipeline's intan-reader
+#include "intan_data_types.h"
+#include "shm_frame_ring.h"
 
 class PipelineDataRHXController : public AbstractRHXController
 {
@@ -140,7 +128,7 @@ public:
     bool connectToSharedMemory();
     void disconnectFromSharedMemory();
     void processTCPData();
-    bool convertTCPDataToRHXBlock(const char* tcpData, size_t dataSize);
+    bool convertTCPDataToRHXBlock(const IntanDataHeader* header, const char* frameData, size_t frameBytes);
     void injectTCPDataIntoGenerator();
     void tcpThreadFunction();
 
@@ -158,8 +146,10 @@ private:
     int shmFd = -1;
     void* shmBase = nullptr;
     size_t shmSize = 0;
-    const char* shmName = "/intan_rhx_shm_v1";
-    uint32_t lastShmTimestamp = 0;
+    const char* shmName = INTAN_SHM_NAME;
+    ShmFrameRing shmRing;
+    uint64_t nextShmFrame = 0; // next frame index to consume from the ring
+    uint64_t shmFramesDropped = 0; // frames overwritten before we got to them
     bool hasTCPData;
     std::thread tcpThread;
     bool tcpThreadRunning;
@@ -23,6 +23,7 @@ INCLUDEPATH += $$PWD/Engine/API/Hardware/
 INCLUDEPATH += $$PWD/GUI/Dialogs/
 INCLUDEPATH += $$PWD/GUI/Widgets/
 INCLUDEPATH += $$PWD/GUI/Windows/
+INCLUDEPATH += $$PWD/../intan-reader/
 
 
 SOURCES += main.cpp \
@@ -31,6 +32,8 @@ SOURCES += main.cpp \
     Engine/API/Synthetic/synthdatablockgenerator.cpp \
     Engine/API/Synthetic/syntheticrhxcontroller.cpp \
     Engine/API/Synthetic/pipelinedatarhxcontroller.cpp \
+    ../intan-reader/shm_frame_ring.cpp \
+    ../intan-reader/async_logger.cpp \
     Engine/API/Abstract/abstractrhxcontroller.cpp \
     Engine/API/Hardware/rhxcontroller.cpp \
     Engine/API/Hardware/rhxdatablock.cpp \